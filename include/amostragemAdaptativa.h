@@ -0,0 +1,25 @@
+#ifndef AMOSTRAGEMADAPTATIVA_H
+#define AMOSTRAGEMADAPTATIVA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Estado da escolha do período de leitura dos sensores, atualizado a cada
+ * leitura processada pela task OutputControl. Com os dois limites iguais o
+ * período é fixo. */
+typedef struct _amostragem {
+    uint32_t periodoMinimoMs;
+    uint32_t periodoMaximoMs;
+    uint32_t periodoMs;         /* Período até a próxima leitura            */
+    float inclinacao;           /* Variação da temperatura filtrada em °C/s */
+    float temperaturaAnterior;  /* Estimativa na leitura anterior em °C     */
+    int64_t instanteAnterior;   /* Instante da leitura anterior em us       */
+    bool inicializado;
+} amostragem_t;
+
+extern void amostragem_init(amostragem_t *amostragem, uint32_t periodoMinimoMs, uint32_t periodoMaximoMs);
+extern float amostragem_intervalo(const amostragem_t *amostragem, int64_t instante);
+extern uint32_t amostragem_atualiza(amostragem_t *amostragem, int64_t instante, float temperatura,
+                                    uint32_t temperaturaAlvo);
+
+#endif /* AMOSTRAGEMADAPTATIVA_H */
@@ -4,13 +4,20 @@
 /* Inclusão de elementos-chave do FreeRTOS: */
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/timers.h"
 #include "freertos/queue.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "monitorPrazos.h"
+#include "indicadoresCozimento.h"
 
 extern void controle_init();
 extern void IRAM_ATTR bt_modo_isr_handler( void * pvParameter);
 extern void IRAM_ATTR bt_ponto_isr_handler( void * pvParameter);
 extern void IRAM_ATTR bt_start_isr_handler( void * pvParameter);
+extern void IRAM_ATTR sensor_porta_isr_handler( void * pvParameter);
+extern void controle_estendeCozimento(int32_t extensaoMs);
+extern uint32_t controle_tempoRestanteMs();
+extern const monitorPrazos_t *controle_monitorPrazos();
+extern bool controle_indicadores(uint32_t indice, registroIndicadores_t *registro);
 
 #endif /* CONTROLEFORNO_H */
\ No newline at end of file
@@ -0,0 +1,23 @@
+#ifndef CONTROLETEMPERATURA_H
+#define CONTROLETEMPERATURA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "definitions.h"
+#include "fusaoSensores.h"
+
+/* Estado do controle liga/desliga da resistência, atualizado a cada leitura
+ * recebida pela task OutputControl. */
+typedef struct _controleTemperatura {
+    fusao_t fusao;
+    bool resistenciaLigada;     /* Decisão tomada na última leitura     */
+    float temperaturaLm35;      /* Última leitura do LM35 em °C         */
+    float temperaturaAtual;     /* Última estimativa de temperatura °C  */
+    float periodo;              /* Intervalo entre as leituras em s     */
+} controleTemperatura_t;
+
+extern void controleTemperatura_init(controleTemperatura_t *controle);
+extern bool controleTemperatura_atualiza(controleTemperatura_t *controle, const leitura_t *leitura,
+                                         uint32_t temperaturaAlvo, bool pausado);
+
+#endif /* CONTROLETEMPERATURA_H */
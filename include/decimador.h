@@ -0,0 +1,37 @@
+#ifndef DECIMADOR_H
+#define DECIMADOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Ordem do filtro CIC e número de coeficientes do FIR de compensação */
+#define CIC_ORDEM               3
+#define FIR_COMPENSACAO_TAPS    3
+
+/* Resolução da saída do decimador em bits, para uma entrada de 12 bits */
+#define DECIMADOR_BITS_ENTRADA  12
+#define DECIMADOR_BITS_SAIDA    16
+
+/* Razões de decimação 2^log2Fator aceitas: o ganho do CIC deve dar pelo menos
+ * a resolução de saída e caber nos acumuladores de 32 bits */
+#define DECIMADOR_FATOR_VALIDO(log2Fator) \
+    (DECIMADOR_BITS_ENTRADA + CIC_ORDEM * (log2Fator) >= DECIMADOR_BITS_SAIDA && \
+     DECIMADOR_BITS_ENTRADA + CIC_ORDEM * (log2Fator) <= 32)
+
+/* Estado do decimador. Os acumuladores são sem sinal de propósito: a aritmética
+ * módulo 2^32 faz com que o transbordo dos integradores seja desfeito pelos
+ * pentes, desde que o ganho total do CIC caiba em 32 bits. */
+typedef struct _decimador {
+    uint32_t integradores[CIC_ORDEM];
+    uint32_t atrasosPente[CIC_ORDEM];
+    uint32_t historicoFir[FIR_COMPENSACAO_TAPS];
+    uint32_t log2Fator;         /* Razão de decimação R = 2^log2Fator        */
+    uint32_t deslocamento;      /* Normalização do ganho R^N para a saída    */
+    uint32_t contador;          /* Amostras de entrada desde a última saída  */
+    uint32_t saidasDescartadas; /* Saídas restantes até o filtro estabilizar */
+} decimador_t;
+
+extern void decimador_init(decimador_t *decimador, uint32_t log2Fator);
+extern bool decimador_adiciona(decimador_t *decimador, uint32_t amostra, uint16_t *saida);
+
+#endif /* DECIMADOR_H */
@@ -1,13 +1,58 @@
 #ifndef DEFINITIONS_H
 #define DEFINITIONS_H
 
+#include <stdint.h>
+#include <stdbool.h>
+#ifdef ESP_PLATFORM
 #include "driver/adc.h"
+#endif
 
 /* Definições gerais:                                           */
+/* Comente a linha abaixo para desativar a inicialização rápida,
+ * que configura as GPIOs em lote e não imprime os banners:     */
+#define FAST_BOOT                   1
+/* Descomente a linha abaixo para gravar um traço das leituras,
+ * botões e decisões da saída em ARQUIVO_TRACO, o que exige uma
+ * partição SPIFFS na tabela de partições:                      */
+/* #define CAPTURA_TRACO               1 */
+#define ARQUIVO_TRACO               "/spiffs/traco.bin"
+/* Buffer em RAM do traço em bytes, intervalo em ms entre as
+ * escritas do buffer no arquivo, e quantos traços de boots
+ * anteriores são guardados (ARQUIVO_TRACO.1, .2, ...):         */
+#define TRACO_BUFFER                8192
+#define TRACO_PERIODO_MS            200
+#define TRACO_GERACOES              3
 /* Flag default usada para instalação das interrupções externas:*/
 #define ESP_INTR_FLAG_DEFAULT       0
-/* Número de amostras na filtragem de medidas do ADC:           */
-#define NUMBER_OF_SAMPLES           40
+/* Razão de decimação das leituras do ADC (decimador.c) em log2.
+ * Cada leitura do LM35 consome 2^ADC_DECIMACAO_LOG2 amostras
+ * brutas de 12 bits, e valores válidos vão de 2 a 6:           */
+#define ADC_DECIMACAO_LOG2          5
+#define NUMBER_OF_SAMPLES           (1 << ADC_DECIMACAO_LOG2)
+/* Período nominal de leitura dos sensores em ms, que define a
+ * taxa de saída do decimador quando a amostragem é fixa:       */
+#define PERIODO_LEITURA_MS          100
+/* Leituras que cabem na fila entre as tasks adcRead e
+ * OutputControl, também usada na reprodução dos traços:        */
+#define TAMANHO_FILA_ADC            20
+/* Amostragem adaptativa (amostragemAdaptativa.c): durante o
+ * cozimento o período de leitura varia entre os limites abaixo,
+ * em ms, de acordo com a dinâmica da temperatura. Com os dois
+ * limites iguais o período é fixo:                             */
+#define AMOSTRAGEM_PERIODO_MIN_MS   50
+#define AMOSTRAGEM_PERIODO_MAX_MS   500
+/* Período máximo em ms com um alvo de temperatura, durante um
+ * lote ou o preaquecimento. O histórico do decimador cobre
+ * cerca de 4 rajadas, que com ele somam no máximo 1 s:          */
+#define AMOSTRAGEM_PERIODO_MAX_COZIMENTO_MS 250
+/* Variação máxima da temperatura entre duas leituras em °C, e
+ * fração do tempo até o alvo usada como período na aproximação: */
+#define AMOSTRAGEM_VARIACAO_C       2.0f
+#define AMOSTRAGEM_FRACAO_ALVO      0.25f
+/* Constante de tempo do filtro da velocidade da temperatura em s,
+ * e resolução do período em ms, que é a de um tick do FreeRTOS: */
+#define AMOSTRAGEM_CONSTANTE_S      0.3f
+#define AMOSTRAGEM_RESOLUCAO_MS     10
 /* Tempo para cada modo de funcionamento em °C:                 */
 #define TEMPERATURA_ASSAR           145
 #define TEMPERATURA_GRATINAR        275
@@ -17,16 +62,99 @@
 #define TEMPO_AO_PONTO              30000
 #define TEMPO_BEM_PASSADO           40000
 
+/* Escalonador de potência (escalonadorPotencia.c): potência de
+ * cada resistência e orçamento somado em W, quantas resistências
+ * podem ser ligadas em um mesmo período de leitura, e por quanto
+ * tempo em ms uma resistência fica ligada antes de ceder a vez,
+ * que não depende da duração variável dos períodos:             */
+#define POTENCIA_RESISTENCIA_W      2000
+#define ORCAMENTO_POTENCIA_W        2000
+#define ESCALONADOR_LIGAMENTOS_SLOT 1
+#define ESCALONADOR_TEMPO_MINIMO_MS 500
+/* Número máximo de lotes à espera na fila de produção:        */
+#define FILA_LOTES_MAX              8
+/* UART dos comandos de lotes pela serial, que é a mesma do
+ * console, e tamanho máximo de uma linha de comando:           */
+#define SERIAL_UART                 0
+#define SERIAL_TAMANHO_LINHA        32
+/* Salvamento do cozimento (salvamentoCozimento.c): intervalo em
+ * ms entre as gravações na memória RTC, e intervalo em ms entre
+ * as gravações na flash durante um lote em curso:              */
+#define SALVAMENTO_PERIODO_MS       1000
+#define SALVAMENTO_PERIODO_FLASH_MS 10000
+/* Indicadores de qualidade (indicadoresCozimento.c): distância
+ * máxima do alvo em °C para que a temperatura conte como dentro
+ * da faixa, e número de cozimentos guardados para consulta:    */
+#define INDICADORES_FAIXA_C         5.0f
+#define INDICADORES_HISTORICO       8
+/* Display SSD1306 de 128x64 (display.c) no lugar dos leds
+ * indicativos. Comente a linha abaixo para voltar aos leds:    */
+#define USA_DISPLAY                 1
+/* Intervalo em ms entre as atualizações do display e clock do
+ * seu barramento SPI em Hz:                                    */
+#define DISPLAY_PERIODO_MS          200
+#define DISPLAY_SPI_HZ              8000000
+/* Rastreio das tasks (rastreioTarefas.c), ativado pelo ambiente
+ * rastreio do platformio.ini: número de eventos guardados, UART,
+ * GPIO e velocidade da transmissão, tamanho do buffer de envio
+ * da UART e intervalo em ms entre as transmissões:             */
+#define RASTREIO_EVENTOS            1024
+#define RASTREIO_UART               2
+#define RASTREIO_PINO_TX            17
+#define RASTREIO_BAUDS              921600
+#define RASTREIO_BUFFER_UART        4096
+#define RASTREIO_PERIODO_MS         50
+
+/* Monitor de prazos das tasks de controle (monitorPrazos.c).
+ * Cada ciclo de adcRead e OutputControl deve terminar em até
+ * MONITOR_PRAZO_MS após o anterior com o período nominal, e com
+ * a mesma folga sobre o período escolhido pela amostragem
+ * adaptativa. Um atraso maior que
+ * MONITOR_TOLERANCIA_MS desliga a resistência, e o monitor é
+ * verificado a cada MONITOR_PERIODO_MS:                        */
+#define MONITOR_PRAZO_MS            150
+#define MONITOR_TOLERANCIA_MS       100
+#define MONITOR_PERIODO_MS          20
+/* Parâmetros do estimador de temperatura (fusaoSensores.c).   */
+/* Variâncias de medida de cada sensor em °C²:                  */
+#define FUSAO_RUIDO_LM35            1.0f
+#define FUSAO_RUIDO_TERMOPAR        0.25f
+/* Variância do modelo térmico por segundo em °C²/s:            */
+#define FUSAO_RUIDO_PROCESSO        0.05f
+/* Modelo térmico: aquecimento em °C/s com a resistência ligada,
+ * perda para o ambiente em 1/s e temperatura ambiente em °C:   */
+#define FUSAO_TAXA_AQUECIMENTO      1.5f
+#define FUSAO_COEFICIENTE_PERDA     0.003f
+#define FUSAO_TEMPERATURA_AMBIENTE  25.0f
+/* Diferença máxima entre os sensores em °C, e por quanto tempo
+ * em ms ela deve persistir para ser sinalizada, qualquer que
+ * seja o período das leituras:                                 */
+#define FUSAO_LIMITE_DIVERGENCIA    15.0f
+#define FUSAO_TEMPO_DIVERGENCIA_MS  1000
+
 /* Definições de tipos: */
 typedef enum {ASSAR = 0, GRATINAR, GRELHAR} modo_t;
 typedef enum {MAL_PASSADO = 0, AO_PONTO, BEM_PASSADO} ponto_t;
-typedef enum {AGUARDANDO_ACAO = 0, ACAO_INICIADA} status_t;
+/* PREAQUECENDO: entre dois lotes da fila (filaLotes.c), com a
+ * temperatura mantida para o próximo lote até que ele seja carregado */
+typedef enum {AGUARDANDO_ACAO = 0, ACAO_INICIADA, PREAQUECENDO} status_t;
+
+/* A struct _leitura agrupa as medidas dos dois sensores de temperatura feitas
+ * em um mesmo período pela task adcRead, e é o elemento da fila adc_queue. */
+typedef struct _leitura {
+    uint32_t lm35;          /* Saída de 16 bits do decimador do LM35      */
+    float termopar;         /* Temperatura do termopar em °C              */
+    bool termoparValido;    /* false se a leitura do termopar falhou      */
+    int64_t instante;       /* Instante da leitura em us                  */
+} leitura_t;
 
 /* Definições das GPIOs que serão utilizadas no projeto */
 /* GPIO dos botões:                                     */
 #define BT_SELECIONA_MODO       32
 #define BT_SELECIONA_PONTO      33
 #define BT_START                25
+/* GPIO do sensor de porta aberta:                      */
+#define SENSOR_PORTA            4
 /* GPIO dos LEDS indicativos:                           */
 #define LED_MODO_GRELHAR        12
 #define LED_MODO_ASSAR          13
@@ -36,6 +164,15 @@ typedef enum {AGUARDANDO_ACAO = 0, ACAO_INICIADA} status_t;
 #define LED_PONTO_BEM_PASSADO   19
 /* GPIO onde o LM35será conectado:                      */
 #define LM35                    ADC1_CHANNEL_7
+/* GPIO do barramento SPI do amplificador de termopar:  */
+#define TERMOPAR_MISO           23
+#define TERMOPAR_SCLK           26
+#define TERMOPAR_CS             27
+/* GPIO do barramento SPI do display:                   */
+#define DISPLAY_MOSI            21
+#define DISPLAY_SCLK            22
+#define DISPLAY_CS              15
+#define DISPLAY_DC              16
 /* GPIO Pino de saída que controlará a resistência      */
 #define PIN_OUTPUT              2
 
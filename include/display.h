@@ -0,0 +1,22 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "framebuffer.h"
+
+/* Bytes de comando enviados antes dos dados de cada região */
+#define DISPLAY_BYTES_COMANDO   6
+
+extern void display_init();
+extern uint32_t display_comandosRegiao(const regiaoFramebuffer_t *regiao, uint8_t *comandos);
+extern uint32_t display_envia(framebuffer_t *framebuffer);
+
+#ifndef ESP_PLATFORM
+/* No build para host o display é simulado: */
+extern const uint8_t (*display_simulaMemoria())[FRAMEBUFFER_LARGURA];
+extern bool display_gravaImagem(FILE *arquivo);
+#endif
+
+#endif /* DISPLAY_H */
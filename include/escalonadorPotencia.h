@@ -0,0 +1,42 @@
+#ifndef ESCALONADORPOTENCIA_H
+#define ESCALONADORPOTENCIA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Número máximo de resistências controladas por um escalonador */
+#define ESCALONADOR_MAX_SAIDAS      32
+
+/* Uma resistência sob o orçamento de potência */
+typedef struct _saidaPotencia {
+    const char *nome;
+    float potencia;             /* Potência da resistência em W                 */
+    bool pedido;                /* O controle de temperatura pede a resistência */
+    bool ligada;                /* Nível concedido no slot atual                */
+    uint32_t espera;            /* Slots seguidos com o pedido negado           */
+    uint32_t tempoLigadaMs;     /* Tempo seguido com a resistência ligada       */
+    uint32_t negados;           /* Total de slots com o pedido negado           */
+} saidaPotencia_t;
+
+typedef struct _escalonador {
+    saidaPotencia_t saidas[ESCALONADOR_MAX_SAIDAS];
+    uint32_t numeroDeSaidas;
+    float orcamento;            /* Potência máxima somada em W                  */
+    uint32_t ligamentosPorSlot; /* Resistências que podem ligar no mesmo slot   */
+    uint32_t tempoMinimoMs;     /* Tempo ligada antes de ceder a vez            */
+    float potenciaAtual;        /* Potência concedida no slot atual em W        */
+    float picoPotencia;         /* Maior potência concedida em W                */
+    double energia;             /* Potência × duração de todos os slots em W.ms */
+    double tempoMs;             /* Duração somada de todos os slots             */
+    uint32_t slots;             /* Slots executados                             */
+} escalonador_t;
+
+extern void escalonador_init(escalonador_t *escalonador, float orcamento, uint32_t ligamentosPorSlot,
+                             uint32_t tempoMinimoMs);
+extern int32_t escalonador_adicionaSaida(escalonador_t *escalonador, const char *nome, float potencia);
+extern void escalonador_pede(escalonador_t *escalonador, uint32_t saida, bool ligar);
+extern void escalonador_executa(escalonador_t *escalonador, uint32_t duracaoMs);
+extern bool escalonador_ligada(const escalonador_t *escalonador, uint32_t saida);
+extern float escalonador_potenciaMedia(const escalonador_t *escalonador);
+
+#endif /* ESCALONADORPOTENCIA_H */
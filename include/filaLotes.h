@@ -0,0 +1,27 @@
+#ifndef FILALOTES_H
+#define FILALOTES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "definitions.h"
+
+/* Um cozimento à espera na fila de lotes */
+typedef struct _lote {
+    modo_t modo;
+    ponto_t ponto;
+} lote_t;
+
+/* Fila circular de lotes, com capacidade para FILA_LOTES_MAX (definitions.h) */
+typedef struct _filaLotes {
+    lote_t lotes[FILA_LOTES_MAX];
+    uint32_t inicio;            /* Posição do próximo lote a ser retirado   */
+    uint32_t tamanho;           /* Lotes na fila                            */
+} filaLotes_t;
+
+extern void filaLotes_init(filaLotes_t *fila);
+extern bool filaLotes_adiciona(filaLotes_t *fila, const lote_t *lote);
+extern bool filaLotes_proximo(const filaLotes_t *fila, lote_t *lote);
+extern bool filaLotes_retira(filaLotes_t *fila, lote_t *lote);
+extern bool filaLotes_interpretaComando(const char *linha, lote_t *lote);
+
+#endif /* FILALOTES_H */
@@ -0,0 +1,66 @@
+#ifndef FORNO_H
+#define FORNO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "definitions.h"
+#include "decimador.h"
+#include "controleTemperatura.h"
+#include "sessaoCozimento.h"
+#include "filaLotes.h"
+#include "amostragemAdaptativa.h"
+#include "indicadoresCozimento.h"
+
+/* Acesso ao hardware de um forno. No ESP32 as funções chamam os drivers
+ * (controleForno.c), e no host um modelo simulado do forno. O contexto é
+ * passado de volta em todas as chamadas, e identifica o forno simulado. */
+typedef struct _halForno {
+    void *contexto;
+    int64_t (*agora)(void *contexto);                                       /* Instante atual em us             */
+    void (*leAdc)(void *contexto, uint16_t *amostras, uint32_t n);          /* n amostras brutas do LM35        */
+    bool (*leTermopar)(void *contexto, uint16_t *quadro);                   /* Quadro do MAX6675                */
+    void (*resistencia)(void *contexto, bool nivel);                        /* Saída da resistência             */
+    void (*ledsModo)(void *contexto, modo_t modo);
+    void (*ledsPonto)(void *contexto, ponto_t ponto);
+} halForno_t;
+
+/* Estado completo de um forno. Nenhuma função de forno.c guarda estado fora
+ * desta struct, então quantos fornos forem necessários podem existir no mesmo
+ * processo, cada um com o seu halForno_t. */
+typedef struct _forno {
+    halForno_t hal;
+    modo_t modo;                    /* Modo selecionado                             */
+    ponto_t ponto;                  /* Ponto selecionado                            */
+    status_t status;                /* Cozimento em andamento, entre lotes ou parado*/
+    modo_t proximoModo;             /* Modo escolhido no próximo toque do botão     */
+    ponto_t proximoPonto;           /* Ponto escolhido no próximo toque do botão    */
+    sessao_t sessao;
+    decimador_t decimador;
+    int64_t ultimaRajada;           /* Instante da última rajada de amostras        */
+    controleTemperatura_t controle;
+    amostragem_t amostragem;        /* Período das leituras                         */
+    filaLotes_t fila;               /* Lotes à espera                               */
+    indicadores_t indicadores;      /* Qualidade dos cozimentos                     */
+    bool portaAberta;
+    bool carregado;                 /* O próximo lote já está dentro do forno       */
+    uint32_t lotesConcluidos;
+} forno_t;
+
+extern void forno_init(forno_t *forno, const halForno_t *hal);
+extern bool forno_selecionaModo(forno_t *forno);
+extern bool forno_selecionaPonto(forno_t *forno);
+extern int64_t forno_inicia(forno_t *forno);
+extern bool forno_adicionaLote(forno_t *forno, modo_t modo, ponto_t ponto);
+extern int64_t forno_iniciaProximo(forno_t *forno);
+extern uint32_t forno_temperaturaAlvo(const forno_t *forno);
+extern bool forno_leSensores(forno_t *forno, leitura_t *leitura);
+extern bool forno_controla(forno_t *forno, const leitura_t *leitura, bool corte);
+extern void forno_confirmaResistencia(forno_t *forno, bool nivel);
+extern void forno_desligaResistencia(forno_t *forno);
+extern bool forno_porta(forno_t *forno, bool aberta);
+extern void forno_estende(forno_t *forno, int64_t extensao);
+extern int64_t forno_restante(const forno_t *forno);
+extern int64_t forno_verificaFim(forno_t *forno);
+extern uint32_t forno_periodoLeituraMs(const forno_t *forno);
+
+#endif /* FORNO_H */
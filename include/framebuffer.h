@@ -0,0 +1,45 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Dimensões do display em pixels. A memória é organizada como a do SSD1306:
+ * páginas de 8 linhas, e cada byte é uma coluna de uma página, com a linha
+ * de cima no bit 0. */
+#define FRAMEBUFFER_LARGURA     128
+#define FRAMEBUFFER_ALTURA      64
+#define FRAMEBUFFER_PAGINAS     (FRAMEBUFFER_ALTURA / 8)
+/* Cada caractere ocupa 6x8 pixels na escala 1, com o espaçamento */
+#define FRAMEBUFFER_LARGURA_CARACTERE   6
+#define FRAMEBUFFER_ALTURA_CARACTERE    8
+
+/* Imagem do display em RAM. O retângulo sujo de cada página vai das colunas
+ * sujoInicio até sujoFim - 1, e está vazio se sujoInicio >= sujoFim. */
+typedef struct _framebuffer {
+    uint8_t pixels[FRAMEBUFFER_PAGINAS][FRAMEBUFFER_LARGURA];
+    uint8_t sujoInicio[FRAMEBUFFER_PAGINAS];
+    uint8_t sujoFim[FRAMEBUFFER_PAGINAS];
+} framebuffer_t;
+
+/* Um retângulo sujo a ser enviado ao display: as colunas inicio até fim - 1
+ * de uma página */
+typedef struct _regiaoFramebuffer {
+    uint8_t pagina;
+    uint8_t inicio;
+    uint8_t fim;
+    const uint8_t *dados;
+} regiaoFramebuffer_t;
+
+extern void framebuffer_init(framebuffer_t *framebuffer);
+extern void framebuffer_pixel(framebuffer_t *framebuffer, uint32_t x, uint32_t y, bool aceso);
+extern void framebuffer_retangulo(framebuffer_t *framebuffer, uint32_t x, uint32_t y, uint32_t largura,
+                                  uint32_t altura, bool aceso);
+extern uint32_t framebuffer_texto(framebuffer_t *framebuffer, uint32_t x, uint32_t y, const char *texto,
+                                  uint32_t escala);
+extern bool framebuffer_sujo(const framebuffer_t *framebuffer);
+extern bool framebuffer_proximaRegiao(framebuffer_t *framebuffer, regiaoFramebuffer_t *regiao);
+extern bool framebuffer_gravaPbm(const uint8_t pixels[FRAMEBUFFER_PAGINAS][FRAMEBUFFER_LARGURA], FILE *arquivo);
+
+#endif /* FRAMEBUFFER_H */
@@ -0,0 +1,30 @@
+#ifndef FUSAOSENSORES_H
+#define FUSAOSENSORES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Estado do estimador de temperatura que combina o LM35 e o termopar.
+ * Os parâmetros do modelo térmico e dos ruídos são preenchidos com os
+ * valores default de definitions.h por fusao_init, e podem ser ajustados
+ * diretamente na struct antes da primeira chamada a fusao_atualiza. */
+typedef struct _fusao {
+    float estimativa;               /* Temperatura estimada em °C                       */
+    float variancia;                /* Variância da estimativa em °C²                   */
+    float ruidoProcesso;            /* Variância do modelo por segundo em °C²/s         */
+    float ruidoLm35;                /* Variância de medida do LM35 em °C²               */
+    float ruidoTermopar;            /* Variância de medida do termopar em °C²           */
+    float taxaAquecimento;          /* Taxa de aquecimento com a resistência ligada °C/s*/
+    float coeficientePerda;         /* Perda térmica para o ambiente em 1/s             */
+    float temperaturaAmbiente;      /* Temperatura ambiente em °C                       */
+    float limiteDivergencia;        /* Diferença máxima aceita entre os sensores em °C  */
+    uint32_t divergenteMs;          /* Tempo seguido acima do limite em ms              */
+    bool divergencia;               /* Sinaliza que os sensores discordam entre si      */
+    bool inicializado;
+} fusao_t;
+
+extern void fusao_init(fusao_t *fusao);
+extern float fusao_atualiza(fusao_t *fusao, float lm35, float termopar, bool termoparValido,
+                            bool resistenciaLigada, float dt);
+
+#endif /* FUSAOSENSORES_H */
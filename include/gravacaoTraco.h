@@ -0,0 +1,69 @@
+#ifndef GRAVACAOTRACO_H
+#define GRAVACAOTRACO_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "definitions.h"
+
+/* Número máximo de amostras brutas do ADC em um único evento */
+#define TRACO_MAX_AMOSTRAS      255
+
+typedef enum {
+    TRACO_AMOSTRAS = 1,         /* Rajada de leituras brutas de 12 bits do LM35  */
+    TRACO_TERMOPAR,             /* Quadro bruto do MAX6675                       */
+    TRACO_BOTAO,                /* Botão pressionado ou mudança da porta         */
+    TRACO_INICIO,               /* Início de um cozimento, com modo e ponto      */
+    TRACO_RELE,                 /* Decisão da saída da resistência e o corte     */
+    TRACO_FIM,                  /* Fim de um cozimento                           */
+    TRACO_LOTE                  /* Lote adicionado à fila pela serial            */
+} tipoEventoTraco_t;
+
+typedef enum {BOTAO_MODO = 0, BOTAO_PONTO, BOTAO_START, BOTAO_PORTA_ABERTA, BOTAO_PORTA_FECHADA} botaoTraco_t;
+
+/* Evento lido de um traço. Somente os campos do tipo do evento são válidos. */
+typedef struct _eventoTraco {
+    tipoEventoTraco_t tipo;
+    int64_t instante;                           /* Microssegundos          */
+    uint32_t numeroDeAmostras;
+    uint16_t amostras[TRACO_MAX_AMOSTRAS];
+    uint16_t quadro;
+    bool quadroValido;
+    botaoTraco_t botao;
+    modo_t modo;
+    ponto_t ponto;
+    bool nivel;
+    bool corte;                                 /* Corte do monitor de prazos */
+} eventoTraco_t;
+
+/* Estado de quem grava ou lê um traço. Os instantes são gravados como a
+ * diferença para o evento anterior, então os dois lados precisam dele. Com um
+ * buffer (traco_usaBuffer) os eventos são codificados nele, e só chegam ao
+ * arquivo por traco_retira. */
+typedef struct _traco {
+    FILE *arquivo;
+    int64_t ultimoInstante;
+    uint32_t bytes;
+    uint8_t *buffer;            /* Buffer circular, ou NULL para gravar direto  */
+    uint32_t capacidade;
+    uint32_t inicio;
+    uint32_t tamanho;
+    uint32_t perdidos;          /* Eventos descartados com o buffer cheio       */
+} traco_t;
+
+extern bool traco_inicia(traco_t *traco, FILE *arquivo);
+extern void traco_gravaAmostras(traco_t *traco, int64_t instante, const uint16_t *amostras, uint32_t n);
+extern void traco_gravaTermopar(traco_t *traco, int64_t instante, uint16_t quadro, bool valido);
+extern void traco_gravaBotao(traco_t *traco, int64_t instante, botaoTraco_t botao);
+extern void traco_gravaInicio(traco_t *traco, int64_t instante, modo_t modo, ponto_t ponto);
+extern void traco_gravaRele(traco_t *traco, int64_t instante, bool nivel, bool corte);
+extern void traco_gravaFim(traco_t *traco, int64_t instante);
+extern void traco_gravaLote(traco_t *traco, int64_t instante, modo_t modo, ponto_t ponto);
+extern void traco_usaBuffer(traco_t *traco, uint8_t *buffer, uint32_t capacidade);
+extern uint32_t traco_retira(traco_t *traco, uint8_t *destino, uint32_t maximo);
+extern bool traco_rotaciona(const char *caminho, uint32_t geracoes);
+
+extern bool traco_abre(traco_t *traco, FILE *arquivo);
+extern bool traco_leEvento(traco_t *traco, eventoTraco_t *evento);
+
+#endif /* GRAVACAOTRACO_H */
@@ -0,0 +1,55 @@
+#ifndef INDICADORESCOZIMENTO_H
+#define INDICADORESCOZIMENTO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "definitions.h"
+
+/* Indicadores de qualidade de um cozimento concluído */
+typedef struct _registroIndicadores {
+    uint32_t lote;              /* Número do lote no forno, a partir de 1       */
+    modo_t modo;
+    ponto_t ponto;
+    uint32_t temperaturaAlvo;   /* °C                                           */
+    uint32_t duracaoMs;         /* Do início ao fim, incluindo as pausas        */
+    int32_t tempoAteAlvoMs;     /* Até a estimativa chegar ao alvo, -1 se nunca */
+    uint32_t tempoNaFaixaMs;    /* Com a estimativa a INDICADORES_FAIXA_C do alvo*/
+    float sobressinal;          /* Maior estimativa acima do alvo em °C         */
+    uint32_t comutacoes;        /* Mudanças do nível da resistência             */
+    float energiaWh;            /* Tempo com a resistência ligada × potência    */
+    float media;                /* Média da temperatura depois de chegar ao alvo*/
+    float variancia;            /* Variância da mesma temperatura em °C²        */
+    uint32_t amostras;          /* Leituras processadas durante o cozimento     */
+} registroIndicadores_t;
+
+/* Acumuladores do cozimento em andamento, atualizados a cada leitura sem
+ * guardar as amostras, e os registros dos últimos INDICADORES_HISTORICO
+ * cozimentos concluídos */
+typedef struct _indicadores {
+    bool ativo;                 /* Há um cozimento em andamento                 */
+    registroIndicadores_t atual;/* Identificação do cozimento em andamento      */
+    int64_t inicio;             /* Instante do início em us                     */
+    int64_t instanteAnterior;   /* Instante da leitura anterior em us           */
+    int64_t tempoAteAlvo;       /* us, -1 enquanto o alvo não for alcançado     */
+    int64_t tempoNaFaixa;       /* us                                           */
+    int64_t tempoLigada;        /* us                                           */
+    bool ligadaAnterior;        /* Nível da resistência na leitura anterior     */
+    uint32_t comutacoes;
+    uint32_t amostras;
+    float temperaturaMaxima;    /* Depois de chegar ao alvo, em °C              */
+    float peso;                 /* Tempo somado das amostras em regime em s     */
+    float media;                /* Média ponderada pelo tempo em °C             */
+    float somaQuadrados;        /* Soma ponderada dos desvios ao quadrado       */
+    registroIndicadores_t historico[INDICADORES_HISTORICO];
+    uint32_t cozimentos;        /* Registros já finalizados                     */
+} indicadores_t;
+
+extern void indicadores_init(indicadores_t *indicadores);
+extern void indicadores_inicia(indicadores_t *indicadores, modo_t modo, ponto_t ponto, uint32_t temperaturaAlvo,
+                               int64_t agora, bool ligada);
+extern void indicadores_amostra(indicadores_t *indicadores, int64_t instante, float temperatura, bool ligada);
+extern bool indicadores_parcial(const indicadores_t *indicadores, int64_t agora, registroIndicadores_t *registro);
+extern const registroIndicadores_t *indicadores_finaliza(indicadores_t *indicadores, int64_t agora, uint32_t lote);
+extern bool indicadores_consulta(const indicadores_t *indicadores, uint32_t indice, registroIndicadores_t *registro);
+
+#endif /* INDICADORESCOZIMENTO_H */
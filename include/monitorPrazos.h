@@ -0,0 +1,38 @@
+#ifndef MONITORPRAZOS_H
+#define MONITORPRAZOS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Número máximo de tasks acompanhadas pelo monitor */
+#define MONITOR_MAX_PRAZOS      4
+
+/* Prazo de uma task periódica. Todos os tempos são em microssegundos. */
+typedef struct _prazo {
+    const char *nome;
+    int64_t periodo;            /* Intervalo esperado entre dois cumprimentos  */
+    int64_t tolerancia;         /* Atraso aceito antes do corte da resistência */
+    int64_t proximoPrazo;       /* Instante em que o próximo ciclo deve acabar */
+    int64_t piorAtraso;         /* Maior atraso observado                      */
+    uint32_t cumpridos;         /* Ciclos terminados dentro do prazo           */
+    uint32_t perdidos;          /* Ciclos terminados depois do prazo           */
+    bool atrasado;              /* O prazo atual já estourou a tolerância      */
+} prazo_t;
+
+typedef struct _monitorPrazos {
+    prazo_t prazos[MONITOR_MAX_PRAZOS];
+    uint32_t numeroDePrazos;
+    bool ativo;
+    bool corte;                 /* A resistência deve ficar desligada          */
+    uint32_t cortes;            /* Número de vezes que o corte foi acionado    */
+    int64_t instanteCorte;      /* Instante do último acionamento do corte     */
+} monitorPrazos_t;
+
+extern void monitor_init(monitorPrazos_t *monitor);
+extern prazo_t *monitor_adiciona(monitorPrazos_t *monitor, const char *nome, int64_t periodo, int64_t tolerancia);
+extern void monitor_ativa(monitorPrazos_t *monitor, int64_t agora);
+extern void monitor_desativa(monitorPrazos_t *monitor);
+extern void monitor_cumpre(monitorPrazos_t *monitor, prazo_t *prazo, int64_t agora);
+extern bool monitor_verifica(monitorPrazos_t *monitor, int64_t agora);
+
+#endif /* MONITORPRAZOS_H */
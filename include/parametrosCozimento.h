@@ -0,0 +1,11 @@
+#ifndef PARAMETROSCOZIMENTO_H
+#define PARAMETROSCOZIMENTO_H
+
+#include <stdint.h>
+#include "definitions.h"
+
+extern uint32_t getTemperaturaAlvoDoModo(modo_t modo);
+extern uint32_t getTempoDeFuncionamentoDoPonto(ponto_t ponto);
+extern float converteTemperaturaLm35(uint32_t leitura);
+
+#endif /* PARAMETROSCOZIMENTO_H */
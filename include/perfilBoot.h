@@ -0,0 +1,39 @@
+#ifndef PERFILBOOT_H
+#define PERFILBOOT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "definitions.h"
+
+/* Número máximo de fases registradas durante a inicialização */
+#define PERFIL_BOOT_MAX_FASES   16
+
+/* Cada marca registra o fim de uma fase da inicialização. O nome da fase é
+ * o mesmo texto do banner que seria impresso por ela, e deve ser uma string
+ * constante, pois apenas o ponteiro é guardado. */
+typedef struct _marcaBoot {
+    const char *fase;
+    int64_t instante;       /* Microssegundos desde o reset */
+} marcaBoot_t;
+
+/* Com FAST_BOOT (definitions.h) os banners da inicialização não são impressos
+ * enquanto ela acontece. As fases aparecem no relatório impresso por uma task
+ * de baixa prioridade depois que o forno já está pronto. */
+#ifdef FAST_BOOT
+#define BOOT_BANNER(texto)
+#else
+#define BOOT_BANNER(texto)      printf(texto)
+#endif
+
+extern void perfilBoot_marca(const char *fase);
+extern uint32_t perfilBoot_marcas(const marcaBoot_t **marcas);
+extern size_t perfilBoot_relatorio(char *buffer, size_t tamanho);
+extern void perfilBoot_limpa();
+
+#ifndef ESP_PLATFORM
+/* No build para host as marcas podem receber um instante fixo em us, até que
+ * um instante negativo volte ao relógio do sistema: */
+extern void perfilBoot_simulaInstante(int64_t instante);
+#endif
+
+#endif /* PERFILBOOT_H */
@@ -0,0 +1,29 @@
+#ifndef RASTREIOHOOKS_H
+#define RASTREIOHOOKS_H
+
+/* Macros de rastreio do FreeRTOS, que o kernel chama a cada troca de task,
+ * envio ou recebimento de uma fila e notificação. Os eventos vão para
+ * rastreioKernel.c. Como as macros precisam estar definidas na compilação do
+ * próprio FreeRTOS, este arquivo é incluído em todos os componentes do
+ * ESP-IDF pelo componente components/rastreioHooks, e não por um #include.
+ * Dentro do kernel, pxCurrentTCB e pxTCB são variáveis do próprio tasks.c. */
+#if defined(RASTREIO_TAREFAS) && !defined(__ASSEMBLER__)
+
+extern void rastreio_hookTroca(void *tarefa, int entra);
+extern void rastreio_hookFila(void *fila, int envia);
+extern void rastreio_hookNotifica(void *tarefa);
+
+#define traceTASK_SWITCHED_IN()                 rastreio_hookTroca(pxCurrentTCB[xPortGetCoreID()], 1)
+#define traceTASK_SWITCHED_OUT()                rastreio_hookTroca(pxCurrentTCB[xPortGetCoreID()], 0)
+#define traceQUEUE_SEND(fila)                   rastreio_hookFila(fila, 1)
+#define traceQUEUE_SEND_FROM_ISR(fila)          rastreio_hookFila(fila, 1)
+#define traceQUEUE_RECEIVE(fila)                rastreio_hookFila(fila, 0)
+#define traceQUEUE_RECEIVE_FROM_ISR(fila)       rastreio_hookFila(fila, 0)
+/* O número de argumentos destas mudou entre as versões do FreeRTOS */
+#define traceTASK_NOTIFY(...)                   rastreio_hookNotifica(pxTCB)
+#define traceTASK_NOTIFY_FROM_ISR(...)          rastreio_hookNotifica(pxTCB)
+#define traceTASK_NOTIFY_GIVE_FROM_ISR(...)     rastreio_hookNotifica(pxTCB)
+
+#endif
+
+#endif /* RASTREIOHOOKS_H */
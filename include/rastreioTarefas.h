@@ -0,0 +1,81 @@
+#ifndef RASTREIOTAREFAS_H
+#define RASTREIOTAREFAS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Número máximo de tasks e de filas ou timers com nome em um rastreio */
+#define RASTREIO_MAX_NOMES      24
+/* Índice usado quando a tabela de nomes está cheia */
+#define RASTREIO_SEM_NOME       0xFF
+/* Tamanho máximo do texto JSON de um evento */
+#define RASTREIO_TAMANHO_TEXTO  160
+
+typedef enum {
+    RASTREIO_NOME_TAREFA = 0,   /* Primeira vez que uma task aparece             */
+    RASTREIO_ENTRA,             /* A task passa a executar                       */
+    RASTREIO_SAI,               /* A task deixa de executar                      */
+    RASTREIO_FILA_ENVIA,        /* A task envia um elemento para a fila objeto   */
+    RASTREIO_FILA_RECEBE,       /* A task recebe um elemento da fila objeto      */
+    RASTREIO_NOTIFICA,          /* A task notifica a task objeto                 */
+    RASTREIO_TIMER              /* O timer objeto disparou                       */
+} tipoRastreio_t;
+
+/* Um evento do rastreio. O objeto é o índice de uma fila ou timer em
+ * rastreio_t.objetos, ou de uma task em rastreio_t.tarefas para
+ * RASTREIO_NOTIFICA. */
+typedef struct _eventoRastreio {
+    int64_t instante;           /* Nanossegundos                    */
+    uint8_t tipo;
+    uint8_t nucleo;
+    uint8_t tarefa;
+    uint8_t objeto;
+} eventoRastreio_t;
+
+/* Associa o identificador de uma task ou fila (o TCB ou o handle no ESP32) a
+ * um nome, que deve ser uma string que exista enquanto o rastreio existir */
+typedef struct _nomeRastreio {
+    const void *identificador;
+    const char *nome;
+} nomeRastreio_t;
+
+/* Buffer circular de eventos, fornecido por quem cria o rastreio. Com o
+ * buffer cheio os eventos novos são descartados e contados em perdidos. */
+typedef struct _rastreio {
+    eventoRastreio_t *eventos;
+    uint32_t capacidade;
+    uint32_t inicio;
+    uint32_t tamanho;
+    uint32_t perdidos;
+    nomeRastreio_t tarefas[RASTREIO_MAX_NOMES];
+    uint32_t numeroDeTarefas;
+    nomeRastreio_t objetos[RASTREIO_MAX_NOMES];
+    uint32_t numeroDeObjetos;
+} rastreio_t;
+
+extern void rastreio_init(rastreio_t *rastreio, eventoRastreio_t *eventos, uint32_t capacidade);
+extern uint8_t rastreio_tarefa(rastreio_t *rastreio, const void *identificador, const char *nome,
+                               int64_t instante);
+extern uint8_t rastreio_objeto(rastreio_t *rastreio, const void *identificador, const char *nome);
+extern uint8_t rastreio_procuraObjeto(const rastreio_t *rastreio, const void *identificador);
+extern void rastreio_registra(rastreio_t *rastreio, int64_t instante, tipoRastreio_t tipo, uint8_t nucleo,
+                              uint8_t tarefa, uint8_t objeto);
+extern bool rastreio_retira(rastreio_t *rastreio, eventoRastreio_t *evento);
+extern uint32_t rastreio_formataCabecalho(char *texto, uint32_t tamanho);
+extern uint32_t rastreio_formata(const rastreio_t *rastreio, const eventoRastreio_t *evento, char *texto,
+                                 uint32_t tamanho);
+extern bool rastreio_exporta(rastreio_t *rastreio, FILE *arquivo);
+
+/* Registro no firmware, pelas macros de rastreio do FreeRTOS (rastreioHooks.h)
+ * e pelos callbacks dos timers (rastreioKernel.c) */
+#ifdef RASTREIO_TAREFAS
+extern void rastreio_inicia();
+extern void rastreio_nomeiaObjeto(const void *identificador, const char *nome);
+extern void rastreio_timer(const void *timer);
+#define RASTREIO_TIMER(timer)       rastreio_timer(timer)
+#else
+#define RASTREIO_TIMER(timer)
+#endif
+
+#endif /* RASTREIOTAREFAS_H */
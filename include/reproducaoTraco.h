@@ -0,0 +1,72 @@
+#ifndef REPRODUCAOTRACO_H
+#define REPRODUCAOTRACO_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "definitions.h"
+#include "forno.h"
+#include "escalonadorPotencia.h"
+#include "gravacaoTraco.h"
+
+/* Uma versão do controlador a ser exercitada por um traço. O traço é
+ * reproduzido através de um forno_t (forno.c), que trata os botões, a porta e
+ * a fila de lotes como no firmware, e a função controla é chamada no lugar de
+ * forno_controla para cada leitura consumida pela task OutputControl. Como
+ * forno_controla, ela pede o nível da resistência por forno->hal.resistencia. */
+typedef struct _versaoControlador {
+    const char *nome;
+    void *estado;
+    void (*inicia)(void *estado);
+    void (*controla)(void *estado, forno_t *forno, const leitura_t *leitura, bool corte);
+} versaoControlador_t;
+
+/* Forno reconstruído a partir de um traço. O seu halForno_t lê as amostras e
+ * os quadros dos eventos do traço, e o pedido da resistência passa por um
+ * escalonador de potência com os parâmetros do firmware. */
+typedef struct _fornoReproduzido {
+    forno_t forno;
+    escalonador_t escalonador;
+    uint32_t saidaResistencia;
+    int64_t agora;                          /* Instante do evento reproduzido       */
+    const eventoTraco_t *amostras;          /* Rajada lida por leAdc                */
+    const eventoTraco_t *termopar;          /* Quadro lido por leTermopar, ou NULL  */
+    leitura_t leituras[TAMANHO_FILA_ADC];   /* Leituras à espera, como na adc_queue */
+    uint32_t inicio;
+    uint32_t pendentes;
+} fornoReproduzido_t;
+
+/* Decisão tomada pelo controlador em uma leitura do traço */
+typedef struct _decisaoReproducao {
+    int64_t instante;
+    float temperatura;
+    bool rele;
+    bool releGravado;           /* Nível aplicado pelo firmware, se houver    */
+    bool temReleGravado;
+} decisaoReproducao_t;
+
+typedef struct _reproducao {
+    decisaoReproducao_t *decisoes;
+    uint32_t numeroDeDecisoes;
+    uint32_t capacidade;
+    int64_t duracaoTraco;       /* Instante do último evento, em us */
+} reproducao_t;
+
+typedef struct _diferencaReproducao {
+    uint32_t leituras;                  /* Leituras comparadas                      */
+    uint32_t releDiferente;             /* Leituras com decisões diferentes         */
+    int64_t primeiraDiferenca;          /* Instante da primeira, ou -1              */
+    float maiorDiferencaTemperatura;    /* Em °C                                    */
+    float mediaDiferencaTemperatura;    /* Em °C                                    */
+    uint32_t chaveamentos[2];           /* Mudanças da saída em cada versão         */
+    uint32_t diferentesDoGravado[2];    /* Decisões diferentes da gravação          */
+} diferencaReproducao_t;
+
+extern void reproducao_versaoAtual(versaoControlador_t *versao);
+extern bool reproducao_executa(FILE *arquivo, versaoControlador_t *versao, reproducao_t *resultado);
+extern void reproducao_libera(reproducao_t *resultado);
+extern void reproducao_compara(const reproducao_t *a, const reproducao_t *b, diferencaReproducao_t *diferenca);
+extern void reproducao_relatorio(FILE *saida, const char *nomeA, const char *nomeB,
+                                 const diferencaReproducao_t *diferenca);
+
+#endif /* REPRODUCAOTRACO_H */
@@ -0,0 +1,58 @@
+#ifndef SALVAMENTOCOZIMENTO_H
+#define SALVAMENTOCOZIMENTO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "definitions.h"
+#include "forno.h"
+
+/* Identifica um registro gravado por salvamentoCozimento.c ("FORN") */
+#define SALVAMENTO_MAGICO       0x4E524F46u
+/* Cópias do registro na memória RTC, gravadas alternadamente */
+#define SALVAMENTO_COPIAS_RTC   2
+
+/* Estado de um cozimento, compacto o bastante para ser gravado a cada
+ * SALVAMENTO_PERIODO_MS. Os lotes da fila são guardados do próximo ao último,
+ * cada um como (modo << 4) | ponto. O crc cobre todos os campos anteriores. */
+typedef struct _registroCozimento {
+    uint32_t magico;
+    uint32_t sequencia;         /* Cresce a cada gravação                   */
+    uint8_t status;
+    uint8_t modo;
+    uint8_t ponto;
+    uint8_t estadoSessao;
+    uint8_t carregado;
+    uint8_t tamanhoFila;
+    uint16_t divergenciaMs;     /* Divergência entre os sensores (fusão)    */
+    uint8_t lotes[FILA_LOTES_MAX];
+    uint32_t duracaoMs;         /* Duração do cozimento, com as extensões   */
+    uint32_t decorridoMs;       /* Tempo já cozido                          */
+    float estimativa;           /* Temperatura estimada em °C               */
+    uint32_t crc;
+} registroCozimento_t;
+
+/* Posição das últimas gravações em cada memória */
+typedef struct _salvamento {
+    uint32_t sequencia;                 /* Sequência do último registro gravado */
+    uint32_t copiaRtc;                  /* Última cópia gravada na RTC          */
+    int64_t ultimaGravacaoFlash;        /* Instante da última gravação na flash */
+    registroCozimento_t ultimoFlash;    /* Último registro gravado na flash     */
+    uint32_t gravacoesRtc;
+    uint32_t gravacoesFlash;
+} salvamento_t;
+
+extern bool salvamento_init(salvamento_t *salvamento, registroCozimento_t *registro);
+extern void salvamento_captura(const forno_t *forno, registroCozimento_t *registro);
+extern void salvamento_restaura(forno_t *forno, const registroCozimento_t *registro);
+extern bool salvamento_grava(salvamento_t *salvamento, registroCozimento_t *registro, int64_t agora);
+extern bool salvamento_valido(const registroCozimento_t *registro);
+extern uint32_t salvamento_crc(const void *dados, uint32_t tamanho);
+
+#ifndef ESP_PLATFORM
+/* No build para host a memória RTC e a flash são simuladas: */
+extern void salvamento_simulaApaga();
+extern void salvamento_simulaQueda(bool perdeRtc, bool interrompeGravacao);
+extern uint32_t salvamento_simulaGravacoesFlash();
+#endif
+
+#endif /* SALVAMENTOCOZIMENTO_H */
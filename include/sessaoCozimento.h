@@ -0,0 +1,26 @@
+#ifndef SESSAOCOZIMENTO_H
+#define SESSAOCOZIMENTO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {SESSAO_INATIVA = 0, SESSAO_EM_CURSO, SESSAO_PAUSADA} estadoSessao_t;
+
+/* Contabilidade de tempo de um cozimento, em microssegundos. O instante
+ * atual é sempre passado pelo chamador (esp_timer_get_time no ESP32), de
+ * forma que o mesmo código pode ser usado com um relógio simulado. */
+typedef struct _sessao {
+    int64_t duracao;        /* Tempo total de cozimento, incluindo extensões   */
+    int64_t decorrido;      /* Tempo cozido até o último início ou retomada    */
+    int64_t inicio;         /* Instante do último início ou retomada           */
+    estadoSessao_t estado;
+} sessao_t;
+
+extern void sessao_inicia(sessao_t *sessao, int64_t duracao, int64_t agora);
+extern bool sessao_pausa(sessao_t *sessao, int64_t agora);
+extern bool sessao_retoma(sessao_t *sessao, int64_t agora);
+extern void sessao_estende(sessao_t *sessao, int64_t extensao);
+extern void sessao_encerra(sessao_t *sessao);
+extern int64_t sessao_restante(const sessao_t *sessao, int64_t agora);
+
+#endif /* SESSAOCOZIMENTO_H */
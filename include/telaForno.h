@@ -0,0 +1,26 @@
+#ifndef TELAFORNO_H
+#define TELAFORNO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "definitions.h"
+#include "forno.h"
+#include "framebuffer.h"
+
+/* O que o display mostra, copiado do forno_t de uma vez para que o desenho,
+ * que é lento, não precise acessar o forno */
+typedef struct _telaForno {
+    modo_t modo;
+    ponto_t ponto;
+    status_t status;
+    int32_t temperatura;        /* Temperatura estimada em °C               */
+    uint32_t temperaturaAlvo;   /* Em °C, ou 0 com o forno parado           */
+    uint32_t restante;          /* Tempo restante do cozimento em s         */
+    bool pausado;               /* Porta aberta                             */
+    uint32_t lotesNaFila;
+} telaForno_t;
+
+extern void telaForno_captura(telaForno_t *tela, const forno_t *forno);
+extern void telaForno_desenha(framebuffer_t *framebuffer, const telaForno_t *tela);
+
+#endif /* TELAFORNO_H */
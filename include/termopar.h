@@ -0,0 +1,18 @@
+#ifndef TERMOPAR_H
+#define TERMOPAR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+extern void termopar_init();
+extern bool termopar_ler(float *temperatura);
+extern bool termopar_leQuadro(uint16_t *quadro);
+extern bool termopar_decodificaQuadro(uint16_t quadro, float *temperatura);
+
+#ifndef ESP_PLATFORM
+/* No build para host o amplificador de termopar é simulado: */
+extern void termopar_simulaTemperatura(float temperatura, bool sensorAberto);
+extern uint16_t termopar_simulaQuadro(float temperatura, bool sensorAberto);
+#endif
+
+#endif /* TERMOPAR_H */
@@ -0,0 +1,112 @@
+#include "amostragemAdaptativa.h"
+#include "definitions.h"
+
+/* Este arquivo escolhe o período de leitura dos sensores e de controle da
+ * resistência a partir da dinâmica da temperatura. Com o controle liga/desliga
+ * o que importa é perceber a tempo que a temperatura cruzou o alvo, então o
+ * período é o menor entre:
+ *
+ *   - o tempo para a temperatura variar AMOSTRAGEM_VARIACAO_C na velocidade
+ *     atual, de forma que transitórios rápidos, como a porta aberta, sejam
+ *     acompanhados de perto;
+ *   - uma fração AMOSTRAGEM_FRACAO_ALVO do tempo que falta para a temperatura
+ *     chegar ao alvo, quando ela estiver indo em direção a ele, de forma que
+ *     a aproximação do alvo seja acompanhada cada vez mais de perto;
+ *
+ * limitado a [periodoMinimoMs, periodoMaximoMs]. Longe do alvo, no começo do
+ * aquecimento, e com a temperatura estável o período fica longo, e ele
+ * encurta quando a temperatura se aproxima rapidamente do alvo.
+ *
+ * Com um alvo de temperatura o período também não passa de
+ * AMOSTRAGEM_PERIODO_MAX_COZIMENTO_MS. Cada leitura do LM35 sai de uma rajada
+ * do decimador (decimador.c), cujo CIC de ordem CIC_ORDEM seguido do FIR de
+ * compensação combina amostras de cerca de 4 rajadas seguidas: com o período
+ * máximo elas cobririam 2 s da temperatura de um cozimento, e com esse limite
+ * cobrem no máximo 1 s. Com o forno parado o período volta a periodoMaximoMs.
+ *
+ * A velocidade é a diferença entre duas estimativas seguidas, suavizada por
+ * um filtro de primeira ordem com constante de tempo AMOSTRAGEM_CONSTANTE_S,
+ * e o período é arredondado para múltiplos de AMOSTRAGEM_RESOLUCAO_MS, que é
+ * o tick do FreeRTOS. */
+
+void amostragem_init(amostragem_t *amostragem, uint32_t periodoMinimoMs, uint32_t periodoMaximoMs)
+{
+    amostragem->periodoMinimoMs = periodoMinimoMs;
+    amostragem->periodoMaximoMs = (periodoMaximoMs > periodoMinimoMs) ? periodoMaximoMs : periodoMinimoMs;
+    amostragem->periodoMs = amostragem->periodoMinimoMs;
+    amostragem->inclinacao = 0;
+    amostragem->temperaturaAnterior = 0;
+    amostragem->instanteAnterior = 0;
+    amostragem->inicializado = false;
+}
+
+/* Retorna o intervalo em segundos entre a leitura anterior e uma leitura feita
+ * em instante. Na primeira leitura, ou depois de uma interrupção das leituras,
+ * o intervalo é o período atual. */
+float amostragem_intervalo(const amostragem_t *amostragem, int64_t instante)
+{
+    int64_t intervalo = instante - amostragem->instanteAnterior;
+
+    if(!amostragem->inicializado || intervalo <= 0 ||
+       intervalo > 2 * (int64_t)amostragem->periodoMaximoMs * 1000)
+    {
+        return amostragem->periodoMs / 1000.0f;
+    }
+    return (float)intervalo / 1e6f;
+}
+
+/* Processa a estimativa de temperatura de uma leitura feita em instante e
+ * retorna o período em ms até a próxima leitura. Com temperaturaAlvo 0, com o
+ * forno parado, somente a velocidade é considerada. */
+uint32_t amostragem_atualiza(amostragem_t *amostragem, int64_t instante, float temperatura,
+                             uint32_t temperaturaAlvo)
+{
+    float dt = amostragem_intervalo(amostragem, instante);
+    float velocidade = 0;
+    float erro = 0;
+    float periodo = amostragem->periodoMaximoMs / 1000.0f;
+    uint32_t periodoMs = 0;
+
+    if(amostragem->periodoMinimoMs == amostragem->periodoMaximoMs)
+    {
+        return amostragem->periodoMs;
+    }
+
+    if(amostragem->inicializado)
+    {
+        amostragem->inclinacao += (dt / (AMOSTRAGEM_CONSTANTE_S + dt)) *
+                                  ((temperatura - amostragem->temperaturaAnterior) / dt - amostragem->inclinacao);
+    }
+    amostragem->temperaturaAnterior = temperatura;
+    amostragem->instanteAnterior = instante;
+    amostragem->inicializado = true;
+
+    velocidade = (amostragem->inclinacao >= 0) ? amostragem->inclinacao : -amostragem->inclinacao;
+    if(velocidade * periodo > AMOSTRAGEM_VARIACAO_C)
+    {
+        periodo = AMOSTRAGEM_VARIACAO_C / velocidade;
+    }
+    erro = (float)temperaturaAlvo - temperatura;
+    if(temperaturaAlvo > 0 && erro * amostragem->inclinacao > 0 &&
+       AMOSTRAGEM_FRACAO_ALVO * erro / amostragem->inclinacao < periodo)
+    {
+        periodo = AMOSTRAGEM_FRACAO_ALVO * erro / amostragem->inclinacao;
+    }
+
+    periodoMs = (uint32_t)(periodo * 1000.0f) / AMOSTRAGEM_RESOLUCAO_MS * AMOSTRAGEM_RESOLUCAO_MS;
+    if(periodoMs < amostragem->periodoMinimoMs)
+    {
+        periodoMs = amostragem->periodoMinimoMs;
+    }
+    if(periodoMs > amostragem->periodoMaximoMs)
+    {
+        periodoMs = amostragem->periodoMaximoMs;
+    }
+    if(temperaturaAlvo > 0 && periodoMs > AMOSTRAGEM_PERIODO_MAX_COZIMENTO_MS &&
+       AMOSTRAGEM_PERIODO_MAX_COZIMENTO_MS >= amostragem->periodoMinimoMs)
+    {
+        periodoMs = AMOSTRAGEM_PERIODO_MAX_COZIMENTO_MS;
+    }
+    amostragem->periodoMs = periodoMs;
+    return periodoMs;
+}
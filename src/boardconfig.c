@@ -2,10 +2,47 @@
 #include "definitions.h"
 #include "controleForno.h"
 #include "boardconfig.h"
+#include "termopar.h"
+#include "display.h"
+#include "perfilBoot.h"
+#include "driver/uart.h"
 
 static void configPins()
 {
-    printf("Configurando os pinos de entrada e saída de dados... \n");
+    BOOT_BANNER("Configurando os pinos de entrada e saída de dados... \n");
+
+#ifdef FAST_BOOT
+    /* Na inicialização rápida todas as saídas (leds e resistência) são
+     * configuradas com uma única chamada a gpio_config, e todas as entradas
+     * (botões e sensor da porta) com outra, no lugar de uma sequência de
+     * chamadas por pino. O resultado é o mesmo da configuração abaixo. */
+    gpio_config_t saidas = {
+        .pin_bit_mask = (1ULL << LED_MODO_ASSAR)        |
+                        (1ULL << LED_MODO_GRATINAR)     |
+                        (1ULL << LED_MODO_GRELHAR)      |
+                        (1ULL << LED_PONTO_MAL_PASSADO) |
+                        (1ULL << LED_PONTO_AO_PONTO)    |
+                        (1ULL << LED_PONTO_BEM_PASSADO) |
+                        (1ULL << PIN_OUTPUT),
+        .mode = GPIO_MODE_OUTPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    gpio_config_t entradas = {
+        .pin_bit_mask = (1ULL << BT_SELECIONA_MODO)     |
+                        (1ULL << BT_SELECIONA_PONTO)    |
+                        (1ULL << BT_START)              |
+                        (1ULL << SENSOR_PORTA),
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+
+    gpio_config(&saidas);
+    gpio_config(&entradas);
+#else
 
     /* Abaixo é feita a configuração das GPIOs onde serão conectados
      * os leds que sinalizam a escolha do modo de funcionamento.
@@ -49,41 +86,115 @@ static void configPins()
 
     gpio_set_direction(BT_START, GPIO_MODE_INPUT);
     gpio_set_pull_mode(BT_START, GPIO_PULLUP_ONLY);
+
+    /* O sensor da porta também é uma entrada com pull-up, que é levada
+     * ao GND pela chave enquanto a porta estiver fechada. */
+    gpio_pad_select_gpio(SENSOR_PORTA);
+    gpio_set_direction(SENSOR_PORTA, GPIO_MODE_INPUT);
+    gpio_set_pull_mode(SENSOR_PORTA, GPIO_PULLUP_ONLY);
+#endif
+    perfilBoot_marca("configPins");
 }
 
 static void configAdc()
 {
-    printf("Configurando ADC... \n");
+    BOOT_BANNER("Configurando ADC... \n");
 
     /* Setup do ADC do ESP32 a ser utilizado */
     adc1_config_width(ADC_WIDTH_12Bit);
     /* Atenuação para leitura de escala total (0 a 3.3v) */
     adc1_config_channel_atten(LM35, ADC_ATTEN_11db);
+    perfilBoot_marca("configAdc");
+}
+
+static void configTermopar()
+{
+    BOOT_BANNER("Configurando barramento SPI do termopar... \n");
+
+    /* O termopar é o segundo sensor de temperatura do forno, e é lido
+     * através do amplificador MAX6675 (termopar.c) */
+    termopar_init();
+    perfilBoot_marca("configTermopar");
+}
+
+#ifdef USA_DISPLAY
+static void configDisplay()
+{
+    BOOT_BANNER("Configurando o display... \n");
+
+    /* O display (display.c) mostra o modo, o ponto, a temperatura e o tempo
+     * restante no lugar dos leds indicativos */
+    display_init();
+    perfilBoot_marca("configDisplay");
+}
+#endif
+
+static void configSerial()
+{
+    BOOT_BANNER("Configurando a serial de comandos... \n");
+
+    /* Os lotes de produção também podem ser adicionados pela serial do
+     * console (task comandos em controleForno.c), que passa a ser lida
+     * através do driver da UART */
+    uart_driver_install(SERIAL_UART, 256, 0, 0, NULL, 0);
+    perfilBoot_marca("configSerial");
+}
+
+#ifdef CAPTURA_TRACO
+#include "esp_spiffs.h"
+
+static void configTraco()
+{
+    BOOT_BANNER("Montando a partição do traço... \n");
+
+    /* O traço é gravado na partição SPIFFS, que é formatada caso ainda
+     * não tenha sido */
+    esp_vfs_spiffs_conf_t conf = {
+        .base_path = "/spiffs",
+        .partition_label = NULL,
+        .max_files = 1,
+        .format_if_mount_failed = true,
+    };
+    esp_vfs_spiffs_register(&conf);
+    perfilBoot_marca("configTraco");
 }
+#endif
 
 static void configISR()
 {
-    printf("Configurando interrupções externas... \n");
+    BOOT_BANNER("Configurando interrupções externas... \n");
 
     /* Abaixo é feita a configuração das interrupções externas. Os botões
      * de escolha modo, ponto e inicialização serão responsáveis por
      * disparar as interrupções. Todas as interrupções foram configuradas
-     * para acontecer na borda de descida, e a implementação das funções
+     * para acontecer na borda de descida, exceto a do sensor da porta, que
+     * dispara nas duas bordas, e a implementação das funções
      * de callback estão no arquivo controleForno.c */
     gpio_set_intr_type(BT_SELECIONA_MODO, GPIO_INTR_NEGEDGE);
     gpio_set_intr_type(BT_SELECIONA_PONTO, GPIO_INTR_NEGEDGE);
     gpio_set_intr_type(BT_START, GPIO_INTR_NEGEDGE);
+    gpio_set_intr_type(SENSOR_PORTA, GPIO_INTR_ANYEDGE);
 
     gpio_install_isr_service(ESP_INTR_FLAG_DEFAULT);
 
     gpio_isr_handler_add(BT_SELECIONA_PONTO, bt_ponto_isr_handler, NULL);
     gpio_isr_handler_add(BT_SELECIONA_MODO, bt_modo_isr_handler, NULL);
     gpio_isr_handler_add(BT_START, bt_start_isr_handler, NULL);
+    gpio_isr_handler_add(SENSOR_PORTA, sensor_porta_isr_handler, NULL);
+    perfilBoot_marca("configISR");
 }
 
 void board_init()
 {
     configPins();
     configAdc();
+    configTermopar();
+#ifdef USA_DISPLAY
+    configDisplay();
+#endif
+    configSerial();
+#ifdef CAPTURA_TRACO
+    configTraco();
+#endif
     configISR();
 }
\ No newline at end of file
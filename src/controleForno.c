@@ -1,26 +1,88 @@
 #include "controleForno.h"
 #include "ledsControl.h"
 #include "definitions.h"
+#include "termopar.h"
+#include "forno.h"
+#include "esp_timer.h"
+#include "perfilBoot.h"
+#include "parametrosCozimento.h"
+#include "monitorPrazos.h"
+#include "escalonadorPotencia.h"
+#include "rastreioTarefas.h"
+#include "telaForno.h"
+#include "display.h"
+#include "salvamentoCozimento.h"
+#include "esp_task_wdt.h"
+#include "driver/uart.h"
 #include "esp_log.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+
+/* Com CAPTURA_TRACO (definitions.h) as leituras brutas dos sensores, os botões,
+ * os lotes da serial e as decisões da saída são gravados em ARQUIVO_TRACO
+ * (gravacaoTraco.c), para serem reproduzidos depois no host
+ * (reproducaoTraco.c). A macro TRACO_GRAVA serializa as gravações feitas
+ * pelas diversas tasks, que só codificam o evento no buffer em RAM do traço.
+ * A escrita na flash é feita pela task descarregaTraco, para que ela não
+ * atrase as tasks medidas. */
+#ifdef CAPTURA_TRACO
+#include "gravacaoTraco.h"
+
+static traco_t traco;
+static uint8_t bufferTraco[TRACO_BUFFER];
+static SemaphoreHandle_t tracoMutex;
+static TaskHandle_t xDescarregaTracoHandle;
+
+#define TRACO_GRAVA(chamada)                                \
+    do {                                                    \
+        if(tracoMutex != NULL)                              \
+        {                                                   \
+            xSemaphoreTake(tracoMutex, portMAX_DELAY);      \
+            chamada;                                        \
+            xSemaphoreGive(tracoMutex);                     \
+        }                                                   \
+    } while(0)
+#else
+#define TRACO_GRAVA(chamada)
+#endif
 
 /* Comente a linha abaixo para desativar os logs de debug */
 #define DEBUG 1
 
-/* A struct _action servirá para moldar como será o funcionamento
- * do forno durante o cozimento através do conjunto de variáveis
- * contidas nela. Um exemplo é, o forno deverá assar (modo_t ASSAR)
- * uma carne ao ponto (ponto_t AO_PONTO). A variáveis status serve
- * para controle do fluxo, registrando se o forno está assando ou
- * aguardando uma nova ação. */
-typedef struct _action {
-    modo_t modo;
-    ponto_t ponto;
-    status_t status;  
-} action_t;
+/* Estado do forno (forno.c): modo, ponto e status da ação de cozimento, a
+ * contabilidade do tempo do cozimento, o decimador e o estimador de
+ * temperatura. Ele é acessado por várias tasks e por quem consultar o tempo
+ * restante, então todo acesso é protegido pelo mutex fornoMutex, com
+ * travaForno e liberaForno. Com ele travado são feitos o estimador, a
+ * amostragem, os indicadores e as saídas do hal, trabalho demais para uma
+ * seção crítica, que desligaria as interrupções e prenderia o outro núcleo.
+ * A exceção é forno_leSensores, chamada somente pela task adcRead, que só
+ * acessa o decimador.
+ *
+ * As interrupções dos botões não podem esperar pelo mutex, e só precisam
+ * saber se há um cozimento em andamento. Elas leem statusBotoes, uma cópia de
+ * forno.status feita por liberaForno, protegida pela seção crítica
+ * statusMux. */
+static forno_t forno;
+static SemaphoreHandle_t fornoMutex;
+static status_t statusBotoes = AGUARDANDO_ACAO;
+static portMUX_TYPE statusMux = portMUX_INITIALIZER_UNLOCKED;
 
-/* Declaração de variáveis action que moldará uma ação de cozimento
- * de alimentos no forno. */
-static action_t action;
+/* Escalonador de potência das resistências (escalonadorPotencia.c). O pedido
+ * de forno.c passa por ele antes de chegar a PIN_OUTPUT, a cada período da
+ * task OutputControl, e ele é protegido pelo mesmo fornoMutex. */
+static escalonador_t escalonador;
+static uint32_t saidaResistencia;
+
+/* As tasks adcRead e OutputControl só executam durante um cozimento ou entre
+ * dois lotes, e as tasks selecionaModo e selecionaPonto só fora de um lote.
+ * Nenhuma delas é suspensa de fora, o que poderia pará-la com fornoMutex ou
+ * tracoMutex travado e prender quem esperasse por eles: no começo de cada
+ * ciclo elas mesmas esperam pelo seu bit, EVENTO_CONTROLE_ATIVO, que
+ * ativaControle liga e desativaControle desliga, ou EVENTO_SELECAO_ATIVA. */
+#define EVENTO_CONTROLE_ATIVO   BIT0
+#define EVENTO_SELECAO_ATIVA    BIT1
+static EventGroupHandle_t eventosControle;
 
 /* Declaração do handler de cada Task */
 static TaskHandle_t xSelecionaModoHandle;
@@ -28,6 +90,18 @@ static TaskHandle_t xSelecionaPontoHandle;
 static TaskHandle_t xStartHandle;
 static TaskHandle_t xAdcReadHandle;
 static TaskHandle_t xOutputControlHandle;
+static TaskHandle_t xFinalizaCozimentoHandle;
+static TaskHandle_t xPortaHandle;
+static TaskHandle_t xComandosHandle;
+static TaskHandle_t xSalvaCozimentoHandle;
+#ifdef USA_DISPLAY
+static TaskHandle_t xAtualizaDisplayHandle;
+#endif
+
+/* Salvamento do estado do cozimento na memória RTC e na flash
+ * (salvamentoCozimento.c), usado somente pela task salvaCozimento depois da
+ * inicialização */
+static salvamento_t salvamento;
 
 /* Declaração do handle da Queue usada para trocar mensagens entre a
  * task que faz aquisição de valores do sensor analógico LM35, e a task
@@ -35,8 +109,110 @@ static TaskHandle_t xOutputControlHandle;
 xQueueHandle adc_queue;
 
 /* Declaração do dandler do timer que contará o tempo que a resistência
- * deverá ficar ligada em função do ponto escolhido pelo operador. */
-TimerHandle_t xTempoDeFuncionamentoHandle;
+ * deverá ficar ligada em função do ponto escolhido pelo operador. É usado
+ * um esp_timer, com resolução de microssegundos, no lugar de um timer do
+ * FreeRTOS, cuja resolução é a de um tick (10ms). */
+esp_timer_handle_t xTempoDeFuncionamentoHandle;
+
+/* Monitor dos prazos das tasks adcRead e OutputControl (monitorPrazos.c). Ele
+ * é verificado pelo timer xMonitorHandle, que desliga a resistência se alguma
+ * das duas tasks travar durante um cozimento. */
+static monitorPrazos_t monitor;
+static prazo_t *prazoAdcRead;
+static prazo_t *prazoOutputControl;
+/* Folga dos prazos das duas tasks além do período de leitura, que com a
+ * amostragem adaptativa (amostragemAdaptativa.c) muda a cada leitura */
+#define FOLGA_PRAZO_MS      (MONITOR_PRAZO_MS - PERIODO_LEITURA_MS)
+static portMUX_TYPE monitorMux = portMUX_INITIALIZER_UNLOCKED;
+esp_timer_handle_t xMonitorHandle;
+
+/* Acesso ao hardware do forno, usado por forno.c. As leituras dos sensores
+ * também são gravadas no traço quando CAPTURA_TRACO estiver definido. */
+static int64_t halAgora(void *contexto)
+{
+    return esp_timer_get_time();
+}
+
+static void halLeAdc(void *contexto, uint16_t *amostras, uint32_t n)
+{
+    uint32_t i = 0;
+
+    for(i = 0 ; i < n ; i++)
+    {
+        amostras[i] = adc1_get_raw(LM35);
+    }
+    TRACO_GRAVA(traco_gravaAmostras(&traco, esp_timer_get_time(), amostras, n));
+}
+
+static bool halLeTermopar(void *contexto, uint16_t *quadro)
+{
+    bool valido = termopar_leQuadro(quadro);
+
+    TRACO_GRAVA(traco_gravaTermopar(&traco, esp_timer_get_time(), *quadro, valido));
+    return valido;
+}
+
+/* O pedido de ligar só é aplicado quando o escalonador o conceder, na task
+ * OutputControl. Desligar é imediato. */
+static void halResistencia(void *contexto, bool nivel)
+{
+    escalonador_pede(&escalonador, saidaResistencia, nivel);
+    if(!nivel)
+    {
+        gpio_set_level(PIN_OUTPUT, 0);
+    }
+}
+
+/* Com USA_DISPLAY o modo e o ponto aparecem no display, que é atualizado
+ * pela task atualizaDisplay, e os leds não são usados */
+static void halLedsModo(void *contexto, modo_t modo)
+{
+#ifndef USA_DISPLAY
+    updateLedsModo(modo);
+#endif
+}
+
+static void halLedsPonto(void *contexto, ponto_t ponto)
+{
+#ifndef USA_DISPLAY
+    updateLedsPonto(ponto);
+#endif
+}
+
+static void travaForno()
+{
+    xSemaphoreTake(fornoMutex, portMAX_DELAY);
+}
+
+/* Libera o forno, publicando antes o seu status para as interrupções */
+static void liberaForno()
+{
+    portENTER_CRITICAL(&statusMux);
+    statusBotoes = forno.status;
+    portEXIT_CRITICAL(&statusMux);
+    xSemaphoreGive(fornoMutex);
+}
+
+/* Usada pelas interrupções dos botões: retorna false durante um cozimento */
+static bool IRAM_ATTR botoesAtivos()
+{
+    status_t status;
+
+    portENTER_CRITICAL_ISR(&statusMux);
+    status = statusBotoes;
+    portEXIT_CRITICAL_ISR(&statusMux);
+    return status != ACAO_INICIADA;
+}
+
+static const halForno_t hal = {
+    .contexto = NULL,
+    .agora = halAgora,
+    .leAdc = halLeAdc,
+    .leTermopar = halLeTermopar,
+    .resistencia = halResistencia,
+    .ledsModo = halLedsModo,
+    .ledsPonto = halLedsPonto,
+};
 
 /* Implementação da função de callback para o tratamento da interrupção
  * externa do botão de seleção do modo. */
@@ -45,8 +221,10 @@ void IRAM_ATTR bt_modo_isr_handler( void * pvParameter)
     /* Deve-se executar a task que trata a interrupção Somente se o status for
      * aguardando ação, pois se o status for ACAO_INICIADA, significa que o
      * forno já começou a execução de alguma operação, e não é possível escolher
-     * outro modo de funcionamento até que a ação em execução seja finalizada */
-    if(action.status == AGUARDANDO_ACAO)
+     * outro modo de funcionamento até que a ação em execução seja finalizada.
+     * Entre dois lotes da fila (PREAQUECENDO) os botões continuam ativos, para
+     * que mais lotes possam ser adicionados. */
+    if(botoesAtivos())
     {
         if(xSelecionaModoHandle != NULL)
         {
@@ -65,7 +243,7 @@ void IRAM_ATTR bt_ponto_isr_handler( void * pvParameter)
      * aguardando ação, pois se o status for ACAO_INICIADA, significa que o
      * forno já começou a execução de alguma operação, e não é possível escolher
      * outro modo de funcionamento até que a ação em execução seja finalizada */
-    if(action.status == AGUARDANDO_ACAO)
+    if(botoesAtivos())
     {
         /* Se o botão foi pressionado, a task que trata a ação é notificada
          * pela chamada a seguir. */
@@ -81,7 +259,7 @@ void IRAM_ATTR bt_start_isr_handler( void * pvParameter)
      * aguardando ação, pois se o status for ACAO_INICIADA, significa que o
      * forno já começou a execução de alguma operação, e não é possível escolher
      * outro modo de funcionamento até que a ação em execução seja finalizada */
-    if(action.status == AGUARDANDO_ACAO)
+    if(botoesAtivos())
     {
         /* Se o botão foi pressionado, a task que trata a ação é notificada
          * pela chamada a seguir. */
@@ -89,53 +267,14 @@ void IRAM_ATTR bt_start_isr_handler( void * pvParameter)
     }
 }
 
-/* O forno deverá atingir uma temperatura de acordo com o modo de funcionamento
- * escolhido pelo operador (definições de valores no arquivo definitions.h),
- * desta forma, a função auxiliar getTemperaturaAlvoDoModo foi criada para retornar
- * o valor definido de temperatura em função do modo passado para ela como parâmetro,
- * ou seja, ela recebe o modo e retorna um valor de temperatura em graus Celsius. */
-static uint32_t getTemperaturaAlvoDoModo(modo_t modo)
-{
-    switch (modo)
-    {
-    case ASSAR:
-        return TEMPERATURA_ASSAR;
-        break;
-    case GRATINAR:
-        return TEMPERATURA_GRATINAR;
-        break;
-    case GRELHAR:
-        return TEMPERATURA_GRELHAR;
-        break;
-    default:
-        return -1;
-        break;
-    }
-}
-
-/* O forno deverá fazer a contagem do tempo de cozimento para controlar o ponto
- * do alimento que está sendo preparado. Ou seja, o tempo de um cozimento é função
- * do ponto escolhido pelo operador (definições de valores no arquivo definitions.h),
- * desta forma, a função auxiliar getTempoDeFuncionamentoDoPonto foi criada para
- * retornar o valor definido de tempo em função do ponto passado para ela como
- * parâmetro, ou seja, ela recebe o ponto e retorna um valor de tempo em
- * mili segundos. */
-static uint32_t getTempoDeFuncionamentoDoPonto(ponto_t ponto)
+/* Implementação da função de callback para o tratamento da interrupção
+ * externa do sensor da porta, que dispara nas duas bordas. A abertura
+ * da porta pausa o cozimento, e o seu fechamento o retoma. */
+void IRAM_ATTR sensor_porta_isr_handler( void * pvParameter)
 {
-    switch (ponto)
+    if(xPortaHandle != NULL)
     {
-    case MAL_PASSADO:
-        return TEMPO_MAL_PASSADO;
-        break;
-    case AO_PONTO:
-        return TEMPO_AO_PONTO;
-        break;
-    case BEM_PASSADO:
-        return TEMPO_BEM_PASSADO;
-        break;
-    default:
-        return -1;
-        break;
+        vTaskNotifyGiveFromISR(xPortaHandle, pdFALSE);
     }
 }
 
@@ -143,45 +282,34 @@ static uint32_t getTempoDeFuncionamentoDoPonto(ponto_t ponto)
  * variar entre ASSAR, GRATINAR e GRELHAR */
 void selecionaModo(void *pvParameter)
 {
-    /* Variável de controle da máquina de estados de seleção de modos.
-     * Estado inicial ASSAR */
-    uint32_t estado = ASSAR;
+    #ifdef DEBUG
+        modo_t modo;
+
+        travaForno();
+        modo = forno.modo;
+        liberaForno();
+    #endif
 
     while(true)
     {
         #ifdef DEBUG
-            ESP_LOGI("Task selecionaModo", "Modo selecionado: %d\n", action.modo); 
+            ESP_LOGI("Task selecionaModo", "Modo selecionado: %d\n", modo);
         #endif
+        xEventGroupWaitBits(eventosControle, EVENTO_SELECAO_ATIVA, pdFALSE, pdTRUE, portMAX_DELAY);
         /* Caso o botão seja pressionado e o status seja aguardando ação,
          * o callback da interrupção do botão de seleção do modo irá
          * notificar esta task e então a condição abaixo será satisfeita */
         if(ulTaskNotifyTake(pdTRUE, portMAX_DELAY) > 0)
         {
-            /* O switch case abaixo faz a transição entre os modos a cada vez
-             * que o botão de seleção de modo é pressionado. Dentro do case de
-             * cada modo a variável estado registra o valor do próximo estado
-             * para fazer a transição entre modos quando o botão for novamente
-             * pressionado, e o valor do modo escolhido é salvo em action.modo. */
-            switch (estado)
-            {
-            case ASSAR:
-                estado = GRATINAR;
-                action.modo = ASSAR;
-                break;
-            case GRATINAR:
-                estado = GRELHAR;
-                action.modo = GRATINAR;
-                break;
-            case GRELHAR:
-                estado = ASSAR;
-                action.modo = GRELHAR;
-                break;
-            default:
-                break;
-            }
-            /* Os leds indicativos de modo são atualizados de acordo com o valor que foi
-             * recém selecionado */
-            updateLedsModo(action.modo);
+            /* A transição entre os modos e a atualização dos leds indicativos
+             * são feitas em forno.c */
+            travaForno();
+            forno_selecionaModo(&forno);
+            #ifdef DEBUG
+                modo = forno.modo;
+            #endif
+            liberaForno();
+            TRACO_GRAVA(traco_gravaBotao(&traco, esp_timer_get_time(), BOTAO_MODO));
         }
         vTaskDelay(pdMS_TO_TICKS(1000));
     }
@@ -191,53 +319,150 @@ void selecionaModo(void *pvParameter)
  * variar entre MAL_PASSADO, AO_PONTO e BEM_PASSADO */
 void selecionaPonto(void *pvParameter)
 {
-    /* Variável de controle da máquina de estados de seleção de pontos.
-     * Estado inicial MAL_PASSADO */
-    uint32_t estado = MAL_PASSADO;
+    #ifdef DEBUG
+        ponto_t ponto;
+
+        travaForno();
+        ponto = forno.ponto;
+        liberaForno();
+    #endif
 
     while(true)
     {
         #ifdef DEBUG
-            ESP_LOGI("Task selecionaPonto", "Ponto selecionado: %d\n", action.ponto); 
+            ESP_LOGI("Task selecionaPonto", "Ponto selecionado: %d\n", ponto);
         #endif
+        xEventGroupWaitBits(eventosControle, EVENTO_SELECAO_ATIVA, pdFALSE, pdTRUE, portMAX_DELAY);
         /* Caso o botão seja pressionado e o status seja aguardando ação,
          * o callback da interrupção do botão de seleção do modo irá
          * notificar esta task e então a condição abaixo será satisfeita */
         if(ulTaskNotifyTake(pdTRUE, portMAX_DELAY) > 0)
         {
-            /* O switch case abaixo faz a transição entre os pontos a cada vez
-             * que o botão de seleção de ponto é pressionado. Dentro do case de
-             * cada ponto a variável estado registra o valor do próximo estado
-             * para fazer a transição entre pontos quando o botão for novamente
-             * pressionado, e o valor do ponto escolhido é salvo em action.ponto */
-            switch (estado)
-            {
-            case MAL_PASSADO:
-                estado = AO_PONTO;
-                action.ponto = MAL_PASSADO;
-                break;
-            case AO_PONTO:
-                estado = BEM_PASSADO;
-                action.ponto =  AO_PONTO;
-                break;
-            case BEM_PASSADO:
-                estado = MAL_PASSADO;
-                action.ponto = BEM_PASSADO;
-                break;
-            default:
-                break;
-            }
-            /* Os leds indicativos de ponto são atualizados de acordo com o valor que foi
-             * recém selecionado */
-            updateLedsPonto(action.ponto);
+            travaForno();
+            forno_selecionaPonto(&forno);
+            #ifdef DEBUG
+                ponto = forno.ponto;
+            #endif
+            liberaForno();
+            TRACO_GRAVA(traco_gravaBotao(&traco, esp_timer_get_time(), BOTAO_PONTO));
         }
         vTaskDelay(pdMS_TO_TICKS(1000));
     }
 }
 
+/* Pede à task salvaCozimento que salve o estado do forno logo após uma
+ * mudança, sem esperar pelo próximo período */
+static void notificaSalvamento()
+{
+    if(xSalvaCozimentoHandle != NULL)
+    {
+        xTaskNotifyGive(xSalvaCozimentoHandle);
+    }
+}
+
+/* Coloca as tasks adcRead e OutputControl em execução, para que a temperatura
+ * do forno seja controlada durante um lote ou entre dois lotes. Enquanto isso
+ * as duas tasks são acompanhadas pelo monitor de prazos e pelo watchdog de
+ * tasks do ESP-IDF. Se o controle já estiver ativo nada é feito. */
+static void ativaControle()
+{
+    bool ativar = false;
+
+    portENTER_CRITICAL(&monitorMux);
+    ativar = !monitor.ativo;
+    if(ativar)
+    {
+        monitor_ativa(&monitor, esp_timer_get_time());
+    }
+    portEXIT_CRITICAL(&monitorMux);
+
+    if(ativar)
+    {
+        xEventGroupSetBits(eventosControle, EVENTO_CONTROLE_ATIVO);
+    }
+}
+
+/* Para as tasks adcRead e OutputControl com o forno parado. Elas terminam o
+ * período em andamento, liberando o que tiverem travado, e param no começo do
+ * próximo, em aguardaControle. */
+static void desativaControle()
+{
+    portENTER_CRITICAL(&monitorMux);
+    monitor_desativa(&monitor);
+    portEXIT_CRITICAL(&monitorMux);
+
+    xEventGroupClearBits(eventosControle, EVENTO_CONTROLE_ATIVO);
+}
+
+/* Chamada por adcRead e OutputControl no começo de cada período, sem nenhum
+ * mutex travado: bloqueia a task enquanto o controle estiver desativado. A
+ * própria task sai do watchdog antes de bloquear e volta a ele depois, e
+ * supervisionada guarda se ela está nele. */
+static void aguardaControle(bool *supervisionada)
+{
+    if((xEventGroupGetBits(eventosControle) & EVENTO_CONTROLE_ATIVO) == 0)
+    {
+        if(*supervisionada)
+        {
+            esp_task_wdt_delete(NULL);
+            *supervisionada = false;
+        }
+        xEventGroupWaitBits(eventosControle, EVENTO_CONTROLE_ATIVO, pdFALSE, pdTRUE, portMAX_DELAY);
+    }
+    if(!*supervisionada)
+    {
+        esp_task_wdt_add(NULL);
+        *supervisionada = true;
+    }
+}
+
+/* Chamada quando um lote começa, pelo botão start ou pela carga do próximo
+ * lote da fila */
+static void iniciaCozimento(int64_t duracao)
+{
+    modo_t modo;
+    ponto_t ponto;
+    uint32_t lotes = 0;
+
+    travaForno();
+    modo = forno.modo;
+    ponto = forno.ponto;
+    lotes = forno.fila.tamanho;
+    liberaForno();
+    TRACO_GRAVA(traco_gravaInicio(&traco, esp_timer_get_time(), modo, ponto));
+
+    /* O timer é disparado de acordo com o tempo definido em função do
+     * ponto de cozimento do alimento */
+    esp_timer_start_once(xTempoDeFuncionamentoHandle, (uint64_t)duracao);
+
+    /* A temperatura do forno deverá ser controlada para obedecer ao modo de 
+     * funcionamento, desta forma as tasks adcRead e OutputControl deverão
+     * estar em executaçâo, pois ela tem esse papel. */
+    ativaControle();
+
+    /* Já que no período em que a ação estiver sendo executada, nada mais além
+     * do controle da saída e da leitura da temperatura poderá ser feito,
+     * então as tasks que não serão utilizadas durante este período param
+     * no começo do seu próximo ciclo */
+    xEventGroupClearBits(eventosControle, EVENTO_SELECAO_ATIVA);
+    notificaSalvamento();
+
+    #ifdef DEBUG
+        ESP_LOGI("Cozimento", "Modo %d selecionado. A temperatura alvo e de %d graus Celsius",
+                    modo, getTemperaturaAlvoDoModo(modo));
+        ESP_LOGI("Cozimento", "Ponto %d selecionado. O tempo de cozimento sera de %d milisegundos",
+                    ponto, getTempoDeFuncionamentoDoPonto(ponto));
+        ESP_LOGI("Cozimento", "%u lotes na fila", lotes);
+    #endif
+}
+
 /* Task usada para inicializar uma ação */
 void start(void *pvParameter)
 {
+    int64_t duracao = 0;
+    status_t status;
+    uint32_t lotes = 0;
+
     /* Inicio do loop infinito da task start */
     while(true)
     {
@@ -246,70 +471,71 @@ void start(void *pvParameter)
          * a condição abaixo será satisfeita */
         if(ulTaskNotifyTake(pdTRUE, portMAX_DELAY) > 0)
         {
-            /* O status deve ser mudado para indicar que uma ação foi iniciada.
-             * Isso fará o travamento da seleção de modo, ponto e do próprio start,
-             * pois as interrupções não irão notificar as tasks no período em que
-             * o alimento estiver sendo preparado. */
-            action.status = ACAO_INICIADA;
-
-            /* A chamada abaixo dispara o timer de acordo com o tempo definido em função
-             * do ponto de cozimento do alimento */
-            xTimerChangePeriod(xTempoDeFuncionamentoHandle,
-                                pdMS_TO_TICKS(getTempoDeFuncionamentoDoPonto(action.ponto)),
-                                0);
-
-            /* A temperatura do forno deverá ser controlada para obedecer ao modo de 
-             * funcionamento, desta forma as tasks adcRead e OutputControl deverão
-             * estar em executaçâo, pois ela tem esse papel. */
-            vTaskResume(xAdcReadHandle);
-            vTaskResume(xOutputControlHandle);
-
-            /* Já que no período em que a ação estiver sendo executada, nada mais além
-             * do controle da saída e da leitura da temperatura poderá ser feito,
-             * então as tasks que não serão utilizadas durante este período serão
-             * suspendidas */
-            vTaskSuspend(xSelecionaModoHandle);
-            vTaskSuspend(xSelecionaPontoHandle);
+            /* O modo e o ponto selecionados formam um lote da fila. Com o forno
+             * parado ele começa imediatamente, e o status é mudado para indicar
+             * que uma ação foi iniciada. Isso fará o travamento da seleção de
+             * modo, ponto e do próprio start, pois as interrupções não irão
+             * notificar as tasks no período em que o alimento estiver sendo
+             * preparado. Entre dois lotes ele apenas entra na fila. */
+            travaForno();
+            duracao = forno_inicia(&forno);
+            status = forno.status;
+            lotes = forno.fila.tamanho;
+            liberaForno();
+            TRACO_GRAVA(traco_gravaBotao(&traco, esp_timer_get_time(), BOTAO_START));
 
-            #ifdef DEBUG
-                ESP_LOGI("Task start", "Modo %d selecionado. A temperatura alvo e de %d graus Celsius",
-                            action.modo, getTemperaturaAlvoDoModo(action.modo));
-                ESP_LOGI("Task start", "Ponto %d selecionado. O tempo de cozimento sera de %d milisegundos",
-                            action.ponto, getTempoDeFuncionamentoDoPonto(action.ponto));
-                ESP_LOGI("Task start", "Status %d", action.status); 
-            #endif
+            if(duracao > 0)
+            {
+                iniciaCozimento(duracao);
+            }
+            else if(status == PREAQUECENDO)
+            {
+                notificaSalvamento();
+                #ifdef DEBUG
+                    ESP_LOGI("Task start", "Lote adicionado, %u na fila", lotes);
+                #endif
+            }
         }
         vTaskDelay(pdMS_TO_TICKS(1000));
     }
 }
 
 /* Task que faz a leitura do valor de tensão da saída do sensor de
- * temperatura e o salva na  fila adc_queue para que a task OutputControl
- * consuma esses dados. */
+ * temperatura e do termopar, e as salva na fila adc_queue para que a task
+ * OutputControl consuma esses dados. */
 void adcRead(void *pvParameters )
 {
-    uint32_t adc_raw_read = 0;
-    uint32_t filter = 0;
-    int i = 0;
+    leitura_t leitura;
+    uint32_t periodoMs = 0;
+    bool supervisionada = false;
 
     while(1)
     {
-        filter = 0;
+        aguardaControle(&supervisionada);
 
-        /* O laço de repetição abaixo é usado para se realizar uma especie de
-         * filtro de médias na leitura do sensor para minimizar o número elevado
-         * de pequenas variações que o sensor apresenta. Apenas o valor da media
-         * de NUMBER_OF_SAMPLES (definitions.h) é salvo na fila*/
-        for(i = 0 ; i < NUMBER_OF_SAMPLES ; i++)
+        /* A rajada de leituras do LM35, a decimação e a leitura do termopar
+         * são feitas em forno.c. Enquanto o decimador estabiliza nenhuma
+         * leitura é enviada. */
+        if(forno_leSensores(&forno, &leitura))
         {
-            adc_raw_read = adc1_get_raw(LM35);
-            filter += adc_raw_read;
+            /* Adiciona o valor na fila. Se a fila estiver cheia a task OutputControl
+             * parou de consumir, o que é tratado pelo monitor de prazos, então a
+             * leitura é descartada em vez de bloquear esta task indefinidamente. */
+            xQueueSend(adc_queue, &leitura, pdMS_TO_TICKS(AMOSTRAGEM_PERIODO_MAX_MS));
+            /* Cede o processador para que OutputControl processe a leitura e
+             * escolha o próximo período a partir dela */
+            taskYIELD();
         }
-        adc_raw_read = filter/NUMBER_OF_SAMPLES;
 
-        /* Adiciona o valor na fila */
-        xQueueSend(adc_queue, &adc_raw_read, portMAX_DELAY);
-        vTaskDelay(pdMS_TO_TICKS(100));
+        /* O período até a próxima leitura é escolhido em forno.c, e a leitura
+         * de um uint32_t é atômica, então não exige o fornoMutex */
+        periodoMs = forno_periodoLeituraMs(&forno);
+        portENTER_CRITICAL(&monitorMux);
+        prazoAdcRead->periodo = (int64_t)(periodoMs + FOLGA_PRAZO_MS) * 1000;
+        monitor_cumpre(&monitor, prazoAdcRead, esp_timer_get_time());
+        portEXIT_CRITICAL(&monitorMux);
+        esp_task_wdt_reset();
+        vTaskDelay(pdMS_TO_TICKS(periodoMs));
     }
 }
 
@@ -317,69 +543,576 @@ void adcRead(void *pvParameters )
  * e controla a saída de acordo com a temperatura alvo. */
 void OutputControl(void *pvParameters )
 {
-    uint32_t recv_value = 0;
-    uint32_t temperaturaAtual = 0;
+    leitura_t leitura;
+    bool nivel = false;
+    bool corte = false;
+    uint32_t periodoMs = 0;
+    bool supervisionada = false;
+    #ifdef DEBUG
+        float temperaturaLm35 = 0;
+        float estimativa = 0;
+        bool divergencia = false;
+        char termopar[12];
+    #endif
+
     while(1)
     {
-        /* Retirando dado da fila e atribuindo o valor para a variável recv_value */
-        xQueueReceive(adc_queue, &recv_value, portMAX_DELAY);
-
-        /* O cálculo abaixo faz a conversão do valor digital para graus Celsius.
-         * O sensor apresenta uma tensão saída de 10mV/°C, desta forma descobre-se
-         * o valor de temperatura equivalente da seguinte forma:
-         * 1 - Divida o valor da escala total de tensão (0 a 3.3) pelo 
-         *     número total de níveis possíveis (2^12) = 3.3/4095
-         * 2 - Multiplique o valor de divisão anterior pelo número da leitura digital
-         *     contido em recv_value e terá o valor da tensão lida = (recv_value*3.3/4095)
-         * 3 - Para descobrir o valor em grauas celsius, divida o resultado do passo 2
-         *     pelo valor de 10mV, que é a relação entre tensão e temperatura do
-         *     sensor = (recv_value*3.3/4095)/0.010 */
-        temperaturaAtual = ((recv_value * 3.3) / 4095) / 0.010;
+        aguardaControle(&supervisionada);
+
+        /* Retirando dado da fila e atribuindo o valor para a variável leitura.
+         * Se nenhuma leitura chegar dentro do prazo a temperatura do forno é
+         * desconhecida, e a resistência é desligada. */
+        periodoMs = forno_periodoLeituraMs(&forno);
+        if(xQueueReceive(adc_queue, &leitura, pdMS_TO_TICKS(periodoMs + FOLGA_PRAZO_MS)) != pdTRUE)
+        {
+            travaForno();
+            forno_desligaResistencia(&forno);
+            liberaForno();
+            portENTER_CRITICAL(&monitorMux);
+            monitor_cumpre(&monitor, prazoOutputControl, esp_timer_get_time());
+            portEXIT_CRITICAL(&monitorMux);
+            esp_task_wdt_reset();
+            continue;
+        }
+
+        portENTER_CRITICAL(&monitorMux);
+        monitor_cumpre(&monitor, prazoOutputControl, esp_timer_get_time());
+        corte = monitor.corte;
+        portEXIT_CRITICAL(&monitorMux);
+        esp_task_wdt_reset();
+
+        /* A decisão de ligar ou desligar a resistência é tomada em forno.c, a
+         * partir da estimativa de temperatura, que também define o período
+         * até a próxima leitura. Enquanto o monitor de prazos mantiver o
+         * corte, a resistência fica desligada. O pedido de ligar passa pelo
+         * escalonador, que respeita o orçamento de potência. O nível é
+         * aplicado a PIN_OUTPUT com o forno travado, como o desligamento feito
+         * por halResistencia, para que uma decisão antiga nunca religue a
+         * resistência depois que forno_verificaFim a desligou. */
+        travaForno();
+        forno_controla(&forno, &leitura, corte);
+        periodoMs = forno_periodoLeituraMs(&forno);
+        escalonador_executa(&escalonador, periodoMs);
+        nivel = escalonador_ligada(&escalonador, saidaResistencia);
+        forno_confirmaResistencia(&forno, nivel);
+        gpio_set_level(PIN_OUTPUT, nivel);
+        #ifdef DEBUG
+            temperaturaLm35 = forno.controle.temperaturaLm35;
+            estimativa = forno.controle.temperaturaAtual;
+            divergencia = forno.controle.fusao.divergencia;
+        #endif
+        liberaForno();
+        portENTER_CRITICAL(&monitorMux);
+        prazoOutputControl->periodo = (int64_t)(periodoMs + FOLGA_PRAZO_MS) * 1000;
+        portEXIT_CRITICAL(&monitorMux);
+        TRACO_GRAVA(traco_gravaRele(&traco, esp_timer_get_time(), nivel, corte));
         #ifdef DEBUG
-            ESP_LOGI("OutputControl", "ADC temperature read from LM35: %d graus celsius", temperaturaAtual); 
+            /* Com um quadro inválido forno_leSensores não preenche leitura.termopar */
+            if(leitura.termoparValido)
+            {
+                snprintf(termopar, sizeof(termopar), "%.2f", leitura.termopar);
+            }
+            else
+            {
+                snprintf(termopar, sizeof(termopar), "invalido");
+            }
+            ESP_LOGI("OutputControl", "LM35: %.1f, termopar: %s, estimativa: %.1f graus celsius, proxima leitura em %u ms",
+                        temperaturaLm35, termopar, estimativa, periodoMs);
+            if (divergencia)
+            {
+                ESP_LOGE("OutputControl", "Divergencia entre LM35 e termopar, resistencia desligada");
+            }
         #endif
+    }
+}
+
+/* Após a contagem do tempo de funcionamento, o esp_timer chamará este callback.
+ * Ele executa na task do esp_timer, que é compartilhada com todos os outros
+ * timers do sistema, então todo o trabalho de finalização do cozimento é
+ * delegado à task finalizaCozimento. */
+void callBackTimer(void *pvParameter)
+{
+    RASTREIO_TIMER(xTempoDeFuncionamentoHandle);
+    xTaskNotifyGive(xFinalizaCozimentoHandle);
+}
+
+/* Task que volta o sistema ao estado inicial ao fim de um cozimento */
+void finalizaCozimento(void *pvParameter)
+{
+    int64_t restante = 0;
+    status_t status;
+    #ifdef DEBUG
+        registroIndicadores_t indicadores;
+        uint32_t lotes = 0;
+    #endif
+
+    while(true)
+    {
+        if(ulTaskNotifyTake(pdTRUE, portMAX_DELAY) > 0)
+        {
+            /* O cozimento pode ter sido estendido depois do disparo do timer, e
+             * nesse caso o timer é apenas rearmado com o tempo que falta. Caso
+             * contrário forno_verificaFim desliga a resistência e volta o forno
+             * para o estado AGUARDANDO_ACAO. */
+            travaForno();
+            restante = forno_verificaFim(&forno);
+            status = forno.status;
+            #ifdef DEBUG
+                lotes = forno.fila.tamanho;
+            #endif
+            liberaForno();
+            if(restante > 0)
+            {
+                esp_timer_start_once(xTempoDeFuncionamentoHandle, restante);
+                continue;
+            }
+
+            /* Se houver outro lote na fila o controle continua ativo, mantendo
+             * a temperatura do próximo lote até que ele seja carregado */
+            if(status != PREAQUECENDO)
+            {
+                desativaControle();
+            }
+            /* Libera novamente as tasks de leitura do modo e do ponto */
+            xEventGroupSetBits(eventosControle, EVENTO_SELECAO_ATIVA);
+            notificaSalvamento();
+            TRACO_GRAVA(traco_gravaFim(&traco, esp_timer_get_time()));
+            #ifdef DEBUG
+                ESP_LOGI("Task finalizaCozimento", "Lote concluido, %u na fila", lotes);
+                if(controle_indicadores(0, &indicadores))
+                {
+                    ESP_LOGI("Task finalizaCozimento", "Lote %u: alvo em %d ms, sobressinal %.1f C, %u ms na faixa, "
+                             "%u comutacoes, %.2f Wh, variancia %.2f C2", indicadores.lote,
+                             indicadores.tempoAteAlvoMs, indicadores.sobressinal, indicadores.tempoNaFaixaMs,
+                             indicadores.comutacoes, indicadores.energiaWh, indicadores.variancia);
+                }
+            #endif
+        }
+    }
+}
+
+/* Task que pausa o cozimento quando a porta do forno é aberta e o retoma
+ * quando ela é fechada. O sensor da porta é uma chave que fecha para o GND
+ * com a porta fechada, então nível alto significa porta aberta. */
+void porta(void *pvParameter)
+{
+    int64_t restante = 0;
+    int64_t duracao = 0;
+    bool aberta = false;
+    bool alterada = false;
+    #ifdef DEBUG
+        estadoSessao_t estado;
+    #endif
+
+    while(true)
+    {
+        if(ulTaskNotifyTake(pdTRUE, portMAX_DELAY) > 0)
+        {
+            /* Espera a chave estabilizar antes de ler o seu nível */
+            vTaskDelay(pdMS_TO_TICKS(50));
+            aberta = (gpio_get_level(SENSOR_PORTA) == 1);
+
+            /* Entre dois lotes, abrir e fechar a porta carrega o próximo lote,
+             * que começa imediatamente */
+            travaForno();
+            alterada = forno_porta(&forno, aberta);
+            restante = forno_restante(&forno);
+            duracao = forno_iniciaProximo(&forno);
+            #ifdef DEBUG
+                estado = forno.sessao.estado;
+            #endif
+            liberaForno();
+            TRACO_GRAVA(traco_gravaBotao(&traco, esp_timer_get_time(),
+                                         aberta ? BOTAO_PORTA_ABERTA : BOTAO_PORTA_FECHADA));
+            if(alterada)
+            {
+                if(aberta)
+                {
+                    esp_timer_stop(xTempoDeFuncionamentoHandle);
+                }
+                else
+                {
+                    esp_timer_start_once(xTempoDeFuncionamentoHandle, restante);
+                }
+                notificaSalvamento();
+            }
+            if(duracao > 0)
+            {
+                iniciaCozimento(duracao);
+            }
+            #ifdef DEBUG
+                ESP_LOGI("Task porta", "Porta %s, estado da sessao %d",
+                            aberta ? "aberta" : "fechada", estado);
+            #endif
+        }
+    }
+}
+
+/* Task que recebe lotes pela serial, um por linha no formato "<modo> <ponto>",
+ * por exemplo "assar bem_passado" (filaLotes.c). Os lotes podem ser
+ * adicionados a qualquer momento, inclusive durante um cozimento. */
+void comandos(void *pvParameter)
+{
+    char linha[SERIAL_TAMANHO_LINHA];
+    uint32_t tamanho = 0;
+    uint8_t caractere = 0;
+    lote_t lote;
+    bool adicionado = false;
+    status_t status;
+    uint32_t lotes = 0;
+
+    while(true)
+    {
+        if(uart_read_bytes(SERIAL_UART, &caractere, 1, portMAX_DELAY) != 1)
+        {
+            continue;
+        }
+        if(caractere != '\n' && caractere != '\r')
+        {
+            /* Linhas longas demais são truncadas, e rejeitadas pelo interpretador */
+            if(tamanho + 1 < sizeof(linha))
+            {
+                linha[tamanho++] = (char)caractere;
+            }
+            continue;
+        }
+        if(tamanho == 0)
+        {
+            continue;
+        }
+        linha[tamanho] = '\0';
+        tamanho = 0;
+
+        if(!filaLotes_interpretaComando(linha, &lote))
+        {
+            printf("erro: use <assar|gratinar|grelhar> <mal_passado|ao_ponto|bem_passado>\n");
+            continue;
+        }
+        travaForno();
+        adicionado = forno_adicionaLote(&forno, lote.modo, lote.ponto);
+        status = forno.status;
+        lotes = forno.fila.tamanho;
+        liberaForno();
+
+        /* Com o forno parado o lote começa a ser preaquecido */
+        if(adicionado && status == PREAQUECENDO)
+        {
+            ativaControle();
+        }
+        if(adicionado)
+        {
+            TRACO_GRAVA(traco_gravaLote(&traco, esp_timer_get_time(), lote.modo, lote.ponto));
+            notificaSalvamento();
+        }
+        printf(adicionado ? "ok: %u lotes na fila\n" : "erro: fila cheia (%u lotes)\n", lotes);
+    }
+}
+
+/* Task que salva o estado do forno (salvamentoCozimento.c) a cada
+ * SALVAMENTO_PERIODO_MS, ou logo que for notificada de uma mudança. O estado é
+ * copiado com o forno travado, e a gravação, que na flash leva alguns
+ * milissegundos, acontece depois de liberá-lo. */
+void salvaCozimento(void *pvParameter)
+{
+    registroCozimento_t registro;
 
-        /* O controle de temperatura é feito ligando/desligando a saída que ativa
-         * a resistência que aquecerá o forno. Quando a temperatura passa do valor,
-         * a resistência é desligada, quando ela volta ao normal a resistência é
-         * religada. */
-        if (temperaturaAtual > getTemperaturaAlvoDoModo(action.modo))
+    while(true)
+    {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SALVAMENTO_PERIODO_MS));
+        travaForno();
+        salvamento_captura(&forno, &registro);
+        liberaForno();
+        if(!salvamento_grava(&salvamento, &registro, esp_timer_get_time()))
         {
-            gpio_set_level(PIN_OUTPUT, 0);
+            #ifdef DEBUG
+                ESP_LOGE("salvaCozimento", "Erro na gravacao do estado na flash");
+            #endif
         }
-        else
+    }
+}
+
+/* Retoma o cozimento restaurado por controle_init, depois da criação das
+ * tasks: com a porta fechada o timer é armado com o tempo que faltava, e o
+ * controle de temperatura volta a executar durante um lote ou entre dois. */
+static void retomaCozimento()
+{
+    bool aberta = (gpio_get_level(SENSOR_PORTA) == 1);
+    int64_t restante = 0;
+    estadoSessao_t estado;
+    status_t status;
+    #ifdef DEBUG
+        modo_t modo;
+        ponto_t ponto;
+        uint32_t lotes = 0;
+    #endif
+    #ifdef CAPTURA_TRACO
+        lote_t atual;
+        filaLotes_t fila;
+        const lote_t *lote = NULL;
+        uint32_t i = 0;
+    #endif
+
+    travaForno();
+    forno_porta(&forno, aberta);
+    restante = forno_restante(&forno);
+    estado = forno.sessao.estado;
+    status = forno.status;
+    #ifdef DEBUG
+        modo = forno.modo;
+        ponto = forno.ponto;
+        lotes = forno.fila.tamanho;
+    #endif
+    #ifdef CAPTURA_TRACO
+        atual.modo = forno.modo;
+        atual.ponto = forno.ponto;
+        fila = forno.fila;
+    #endif
+    liberaForno();
+
+    #ifdef CAPTURA_TRACO
+        /* O estado restaurado abre o traço, para que a reprodução
+         * (reproducaoTraco.c) parta do mesmo cozimento e da mesma fila */
+        if(status == ACAO_INICIADA)
+        {
+            TRACO_GRAVA(traco_gravaInicio(&traco, esp_timer_get_time(), atual.modo, atual.ponto));
+        }
+        for(i = 0 ; i < fila.tamanho ; i++)
+        {
+            lote = &fila.lotes[(fila.inicio + i) % FILA_LOTES_MAX];
+            TRACO_GRAVA(traco_gravaLote(&traco, esp_timer_get_time(), lote->modo, lote->ponto));
+        }
+        if(aberta)
+        {
+            TRACO_GRAVA(traco_gravaBotao(&traco, esp_timer_get_time(), BOTAO_PORTA_ABERTA));
+        }
+    #endif
+
+    if(status == ACAO_INICIADA)
+    {
+        /* Um cozimento que já tinha acabado é finalizado imediatamente */
+        if(estado == SESSAO_EM_CURSO)
+        {
+            esp_timer_start_once(xTempoDeFuncionamentoHandle, (restante > 0) ? restante : 1);
+        }
+        xEventGroupClearBits(eventosControle, EVENTO_SELECAO_ATIVA);
+    }
+    if(status != AGUARDANDO_ACAO)
+    {
+        ativaControle();
+    }
+    #ifdef DEBUG
+        ESP_LOGI("controle_init", "Cozimento retomado: status %d, modo %d, ponto %d, restante %lld us, %u na fila",
+                    status, modo, ponto, (long long)restante, lotes);
+    #endif
+}
+
+#ifdef CAPTURA_TRACO
+/* Task de baixa prioridade que retira os eventos do buffer do traço a cada
+ * TRACO_PERIODO_MS e os escreve em ARQUIVO_TRACO. O tracoMutex só fica travado
+ * durante a cópia dos bytes, e a escrita na flash acontece depois de liberá-lo,
+ * então ela nunca atrasa adcRead e OutputControl. */
+void descarregaTraco(void *pvParameter)
+{
+    uint8_t bloco[256];
+    uint32_t n = 0;
+    uint32_t perdidos = 0;
+    uint32_t perdidosAnteriores = 0;
+    bool escrito = false;
+
+    while(true)
+    {
+        vTaskDelay(pdMS_TO_TICKS(TRACO_PERIODO_MS));
+        escrito = false;
+        do
+        {
+            xSemaphoreTake(tracoMutex, portMAX_DELAY);
+            n = traco_retira(&traco, bloco, sizeof(bloco));
+            perdidos = traco.perdidos;
+            xSemaphoreGive(tracoMutex);
+            if(n > 0)
+            {
+                fwrite(bloco, 1, n, traco.arquivo);
+                escrito = true;
+            }
+        } while(n == sizeof(bloco));
+        if(escrito)
+        {
+            fflush(traco.arquivo);
+        }
+        #ifdef DEBUG
+            if(perdidos != perdidosAnteriores)
+            {
+                ESP_LOGW("descarregaTraco", "%u eventos do traço perdidos com o buffer cheio", perdidos);
+            }
+        #endif
+        perdidosAnteriores = perdidos;
+    }
+}
+#endif
+
+#ifdef USA_DISPLAY
+/* Task de baixa prioridade que redesenha o display a cada DISPLAY_PERIODO_MS.
+ * O estado do forno é copiado com o forno travado, e o desenho e o envio por
+ * DMA (display.c) acontecem depois de liberá-lo, então o display nunca atrasa
+ * as tasks de controle. Só os retângulos que mudaram são transferidos. */
+static framebuffer_t framebuffer;
+
+void atualizaDisplay(void *pvParameter)
+{
+    telaForno_t tela;
+    int64_t inicio = 0;
+    uint32_t bytes = 0;
+
+    framebuffer_init(&framebuffer);
+    while(true)
+    {
+        travaForno();
+        telaForno_captura(&tela, &forno);
+        liberaForno();
+
+        inicio = esp_timer_get_time();
+        telaForno_desenha(&framebuffer, &tela);
+        bytes = display_envia(&framebuffer);
+        #ifdef DEBUG
+            if(bytes > 0)
+            {
+                ESP_LOGI("atualizaDisplay", "%u bytes em %lld us", bytes,
+                         (long long)(esp_timer_get_time() - inicio));
+            }
+        #endif
+        vTaskDelay(pdMS_TO_TICKS(DISPLAY_PERIODO_MS));
+    }
+}
+#endif
+
+/* Callback do timer periódico do monitor de prazos. Ele executa na task do
+ * esp_timer, que tem prioridade maior que a de todas as tasks do forno, então
+ * continua executando mesmo que adcRead ou OutputControl travem. */
+void callBackMonitor(void *pvParameter)
+{
+    static uint32_t cortesAnteriores = 0;
+    bool corte = false;
+    uint32_t cortes = 0;
+
+    RASTREIO_TIMER(xMonitorHandle);
+    portENTER_CRITICAL(&monitorMux);
+    corte = monitor_verifica(&monitor, esp_timer_get_time());
+    cortes = monitor.cortes;
+    portEXIT_CRITICAL(&monitorMux);
+
+    if(corte)
+    {
+        gpio_set_level(PIN_OUTPUT, 0);
+    }
+    #ifdef DEBUG
+        if(cortes != cortesAnteriores)
         {
-            gpio_set_level(PIN_OUTPUT, 1);
+            ESP_LOGE("Monitor", "Prazo perdido, resistencia desligada. adcRead: %u perdidos, pior atraso %lld us. "
+                                "OutputControl: %u perdidos, pior atraso %lld us",
+                        prazoAdcRead->perdidos, (long long)prazoAdcRead->piorAtraso,
+                        prazoOutputControl->perdidos, (long long)prazoOutputControl->piorAtraso);
         }
+    #endif
+    cortesAnteriores = cortes;
+}
+
+/* Retorna o monitor de prazos, com os contadores de prazos cumpridos e
+ * perdidos e o pior atraso de cada task */
+const monitorPrazos_t *controle_monitorPrazos()
+{
+    return &monitor;
+}
+
+/* Acrescenta tempo ao cozimento em andamento. Valores negativos encurtam o
+ * cozimento. */
+void controle_estendeCozimento(int32_t extensaoMs)
+{
+    int64_t restante = 0;
+    estadoSessao_t estado;
+
+    travaForno();
+    forno_estende(&forno, (int64_t)extensaoMs * 1000);
+    restante = forno_restante(&forno);
+    estado = forno.sessao.estado;
+    liberaForno();
+
+    /* Somente uma sessão em curso tem o timer armado. Se a sessão estiver
+     * pausada, o novo tempo será usado quando ela for retomada. */
+    if(estado == SESSAO_EM_CURSO)
+    {
+        esp_timer_stop(xTempoDeFuncionamentoHandle);
+        esp_timer_start_once(xTempoDeFuncionamentoHandle, restante);
     }
 }
 
-/* Após a contagem do tempo de funcionamento, o timer chamará este callback,
- * e ela é responsável por voltar o sistema ao estado inicial */
-void callBackTimer(TimerHandle_t pxTimer)
+/* Retorna o tempo restante do cozimento em ms, ou 0 se o forno estiver parado */
+uint32_t controle_tempoRestanteMs()
+{
+    int64_t restante = 0;
+
+    travaForno();
+    restante = forno_restante(&forno);
+    liberaForno();
+
+    return (uint32_t)(restante / 1000);
+}
+
+/* Copia os indicadores de qualidade de um cozimento concluído, do mais
+ * recente (indice 0) ao mais antigo guardado. Retorna false se ele não
+ * existir. */
+bool controle_indicadores(uint32_t indice, registroIndicadores_t *registro)
 {
-    gpio_set_level(PIN_OUTPUT, 0);          /* Desliga a resistência                                            */
-    action.status = AGUARDANDO_ACAO;        /* Volta para o estado AGUARDANDO_ACAO                              */
-    vTaskResume(xSelecionaModoHandle);      /* Inicializa novamente a task de leitura de modo                   */
-    vTaskResume(xSelecionaPontoHandle);     /* Inicializa novamente a task de leitura do ponto                  */
-    vTaskSuspend(xAdcReadHandle);           /* Suspende a task que faz a leitura do sensor de temperatura       */
-    vTaskSuspend(xOutputControlHandle);     /* Suspende a task que faz o controle da temperatura da resistencia */
+    bool existe = false;
+
+    travaForno();
+    existe = indicadores_consulta(&forno.indicadores, indice, registro);
+    liberaForno();
+
+    return existe;
 }
 
 void controle_init()
 {
-    printf("Inicializando as tasks de controle do forno...\n");
+    registroCozimento_t registro;
+    bool retomar = false;
+
+    BOOT_BANNER("Inicializando as tasks de controle do forno...\n");
+
+    fornoMutex = xSemaphoreCreateMutex();
+    eventosControle = xEventGroupCreate();
+    if(fornoMutex == NULL || eventosControle == NULL)
+    {
+        #ifdef DEBUG
+            ESP_LOGE("controle_init", "Erro na criação do mutex do forno");
+        #endif
+        return;
+    }
+    xEventGroupSetBits(eventosControle, EVENTO_SELECAO_ATIVA);
+
+    /* O escalonador de potência é criado antes do forno, que o usa para
+     * acionar a resistência */
+    escalonador_init(&escalonador, ORCAMENTO_POTENCIA_W, ESCALONADOR_LIGAMENTOS_SLOT, ESCALONADOR_TEMPO_MINIMO_MS);
+    saidaResistencia = (uint32_t)escalonador_adicionaSaida(&escalonador, "resistencia", POTENCIA_RESISTENCIA_W);
 
-    /* Inicialização de variaveis */
-    action.status = AGUARDANDO_ACAO;
-    action.ponto = MAL_PASSADO;
-    action.modo = ASSAR;
-    updateLedsModo(action.modo);
-    updateLedsPonto(action.ponto);
+    /* Inicialização do estado do forno, que também atualiza os leds */
+    forno_init(&forno, &hal);
+
+    /* Um cozimento interrompido por uma queda de energia ou por um reset é
+     * restaurado do último registro salvo, e retomado depois da criação das
+     * tasks */
+    if(salvamento_init(&salvamento, &registro) && registro.status != AGUARDANDO_ACAO)
+    {
+        salvamento_restaura(&forno, &registro);
+        retomar = true;
+    }
+    perfilBoot_marca("salvamento");
 
     /* Criação do timer que contará o tempo de cozimento*/
-    xTempoDeFuncionamentoHandle = xTimerCreate("Tempo de funcionamento", pdMS_TO_TICKS(1000), pdFALSE, 0, callBackTimer);
-    if(xTempoDeFuncionamentoHandle == NULL)
+    const esp_timer_create_args_t argsTimer = {
+        .callback = callBackTimer,
+        .name = "Tempo de funcionamento",
+    };
+    if(esp_timer_create(&argsTimer, &xTempoDeFuncionamentoHandle) != ESP_OK)
     {
         #ifdef DEBUG
             ESP_LOGE("controle_init", "Erro na inicialização do timer de controle"); 
@@ -387,9 +1120,27 @@ void controle_init()
         return;
     }
 
+    /* Criação do monitor de prazos e do timer que o verifica */
+    monitor_init(&monitor);
+    prazoAdcRead = monitor_adiciona(&monitor, "adcRead", MONITOR_PRAZO_MS * 1000, MONITOR_TOLERANCIA_MS * 1000);
+    prazoOutputControl = monitor_adiciona(&monitor, "OutputControl", MONITOR_PRAZO_MS * 1000,
+                                          MONITOR_TOLERANCIA_MS * 1000);
+    const esp_timer_create_args_t argsMonitor = {
+        .callback = callBackMonitor,
+        .name = "Monitor de prazos",
+    };
+    if(esp_timer_create(&argsMonitor, &xMonitorHandle) != ESP_OK ||
+       esp_timer_start_periodic(xMonitorHandle, MONITOR_PERIODO_MS * 1000) != ESP_OK)
+    {
+        #ifdef DEBUG
+            ESP_LOGE("controle_init", "Erro na inicialização do monitor de prazos");
+        #endif
+        return;
+    }
+
     /*  Instanciação da Queue que será usada para troca de informações entre a task que fará a leitura
      *  e conversão A/D da tensão do sensor e a task que controlará a saída */
-    adc_queue = xQueueCreate(20, sizeof(int));
+    adc_queue = xQueueCreate(TAMANHO_FILA_ADC, sizeof(leitura_t));
     if(adc_queue == NULL)
     {
         #ifdef DEBUG
@@ -398,18 +1149,76 @@ void controle_init()
         return;
     }
 
+#ifdef CAPTURA_TRACO
+    /* O arquivo do traço fica na partição SPIFFS montada em board_init. Os
+     * traços dos boots anteriores são guardados, e um novo é criado. Em
+     * qualquer falha o mutex é apagado e o arquivo fechado, e nenhum evento
+     * é gravado. */
+    FILE *arquivoTraco = NULL;
+
+    tracoMutex = xSemaphoreCreateMutex();
+    if(tracoMutex != NULL && traco_rotaciona(ARQUIVO_TRACO, TRACO_GERACOES))
+    {
+        arquivoTraco = fopen(ARQUIVO_TRACO, "wb");
+    }
+    if(arquivoTraco != NULL && traco_inicia(&traco, arquivoTraco))
+    {
+        traco_usaBuffer(&traco, bufferTraco, sizeof(bufferTraco));
+        xTaskCreate(&descarregaTraco, "Descarrega traco", 3072, NULL, 0, &xDescarregaTracoHandle);
+    }
+    if(xDescarregaTracoHandle == NULL)
+    {
+        #ifdef DEBUG
+            ESP_LOGE("controle_init", "Erro na inicialização da captura do traço");
+        #endif
+        if(arquivoTraco != NULL)
+        {
+            fclose(arquivoTraco);
+            traco.arquivo = NULL;
+        }
+        if(tracoMutex != NULL)
+        {
+            vSemaphoreDelete(tracoMutex);
+            tracoMutex = NULL;
+        }
+    }
+#endif
+
+#ifdef RASTREIO_TAREFAS
+    /* O rastreio começa antes da criação das tasks, para que todas apareçam */
+    rastreio_inicia();
+    rastreio_nomeiaObjeto(adc_queue, "adc_queue");
+    rastreio_nomeiaObjeto(xTempoDeFuncionamentoHandle, "tempo de funcionamento");
+    rastreio_nomeiaObjeto(xMonitorHandle, "monitor de prazos");
+#endif
+
     /* Criação de todas as tasks: */
     xTaskCreate(&selecionaModo, "Seleciona Modo", 2048, NULL, 0, &xSelecionaModoHandle);
     xTaskCreate(&selecionaPonto, "Seleciona Ponto", 2048, NULL, 0, &xSelecionaPontoHandle);
     xTaskCreate(&start, "Inicializa processo", 2048, NULL, 0, &xStartHandle);
     xTaskCreate(&adcRead, "Leitura ADC", 2048, NULL, 0, &xAdcReadHandle);
     xTaskCreate(&OutputControl, "Controle da saida", 2048, NULL, 0, &xOutputControlHandle);
+    xTaskCreate(&finalizaCozimento, "Finaliza cozimento", 2048, NULL, 1, &xFinalizaCozimentoHandle);
+    xTaskCreate(&porta, "Porta", 2048, NULL, 1, &xPortaHandle);
+    xTaskCreate(&comandos, "Comandos", 2048, NULL, 0, &xComandosHandle);
+    xTaskCreate(&salvaCozimento, "Salva cozimento", 2048, NULL, 0, &xSalvaCozimentoHandle);
+#ifdef USA_DISPLAY
+    xTaskCreate(&atualizaDisplay, "Display", 2048, NULL, 0, &xAtualizaDisplayHandle);
+#endif
 
-    if( xSelecionaModoHandle == NULL  ||
-        xSelecionaPontoHandle == NULL ||
-        xStartHandle == NULL          ||
-        xAdcReadHandle  == NULL       ||
-        xOutputControlHandle == NULL)
+    if( xSelecionaModoHandle == NULL     ||
+        xSelecionaPontoHandle == NULL    ||
+        xStartHandle == NULL             ||
+        xAdcReadHandle  == NULL          ||
+        xOutputControlHandle == NULL     ||
+        xFinalizaCozimentoHandle == NULL ||
+        xPortaHandle == NULL             ||
+        xComandosHandle == NULL          ||
+        xSalvaCozimentoHandle == NULL
+#ifdef USA_DISPLAY
+        || xAtualizaDisplayHandle == NULL
+#endif
+        )
     {
         #ifdef DEBUG
             ESP_LOGE("controle_init", "Erro na inicialização das tasks"); 
@@ -417,8 +1226,13 @@ void controle_init()
         return;
     }
 
-    /* As tasks adcRead e OutputControl só funcionarão quando o botão start
-     * for pressionado e uma ação estiver sendo executada */
-    vTaskSuspend(xAdcReadHandle);
-    vTaskSuspend(xOutputControlHandle);
+    /* As tasks adcRead e OutputControl ficam paradas em aguardaControle até
+     * que o botão start seja pressionado e uma ação seja executada */
+    perfilBoot_marca("criacao das tasks");
+
+    if(retomar)
+    {
+        retomaCozimento();
+        perfilBoot_marca("retomada do cozimento");
+    }
 }
\ No newline at end of file
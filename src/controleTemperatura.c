@@ -0,0 +1,48 @@
+#include "controleTemperatura.h"
+#include "parametrosCozimento.h"
+
+/* Este arquivo contém a decisão de ligar ou desligar a resistência a partir
+ * de uma leitura dos sensores. Ela foi separada da task OutputControl para
+ * que a mesma lógica possa ser executada no host, por exemplo na reprodução
+ * de traços gravados (reproducaoTraco.c). */
+
+void controleTemperatura_init(controleTemperatura_t *controle)
+{
+    fusao_init(&controle->fusao);
+    controle->resistenciaLigada = false;
+    controle->temperaturaLm35 = 0;
+    controle->temperaturaAtual = 0;
+    controle->periodo = PERIODO_LEITURA_MS / 1000.0f;
+}
+
+/* Processa uma leitura e retorna o novo nível da saída da resistência */
+bool controleTemperatura_atualiza(controleTemperatura_t *controle, const leitura_t *leitura,
+                                  uint32_t temperaturaAlvo, bool pausado)
+{
+    /* Conversão da saída do decimador para graus Celsius (parametrosCozimento.c) */
+    controle->temperaturaLm35 = converteTemperaturaLm35(leitura->lm35);
+
+    /* As duas medidas são combinadas pelo estimador, que usa o estado da
+     * resistência no último período para prever a variação de temperatura */
+    controle->temperaturaAtual = fusao_atualiza(&controle->fusao, controle->temperaturaLm35,
+                                                leitura->termopar, leitura->termoparValido,
+                                                controle->resistenciaLigada, controle->periodo);
+
+    /* Com a porta aberta o cozimento fica pausado, e a resistência desligada.
+     * Se os sensores discordam entre si não é possível saber qual deles está
+     * correto, então a resistência também é mantida desligada até que voltem
+     * a concordar. */
+    if (pausado || controle->fusao.divergencia)
+    {
+        controle->resistenciaLigada = false;
+    }
+    /* O controle de temperatura é feito ligando/desligando a saída que ativa
+     * a resistência que aquecerá o forno. Quando a temperatura passa do valor,
+     * a resistência é desligada, quando ela volta ao normal a resistência é
+     * religada. */
+    else
+    {
+        controle->resistenciaLigada = !(controle->temperaturaAtual > temperaturaAlvo);
+    }
+    return controle->resistenciaLigada;
+}
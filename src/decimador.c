@@ -0,0 +1,113 @@
+#include "decimador.h"
+#include "definitions.h"
+
+/* Este arquivo implementa o pipeline de decimação usado na leitura do LM35.
+ * O fluxo de leituras brutas de 12 bits do ADC passa por um filtro CIC
+ * (cascaded integrator-comb) de ordem CIC_ORDEM, que faz a média de R = 2^log2Fator
+ * amostras com uma janela suave e entrega uma amostra a cada R de entrada. Como o
+ * ganho do CIC é R^N, a saída tem 12 + N*log2(R) bits, dos quais os
+ * DECIMADOR_BITS_SAIDA mais significativos são mantidos. Em seguida um FIR curto
+ * compensa a queda de ganho do CIC perto da frequência de corte.
+ *
+ * Toda a aritmética é inteira, para que o custo por amostra seja apenas algumas
+ * somas: N somas por amostra de entrada e N subtrações mais o FIR por saída. */
+
+/* A razão de decimação usada pelo forno é conhecida na compilação, então uma
+ * razão inválida é um erro de compilação, e não de execução */
+#if !DECIMADOR_FATOR_VALIDO(ADC_DECIMACAO_LOG2)
+#error "ADC_DECIMACAO_LOG2 fora da faixa aceita pelo decimador"
+#endif
+
+/* FIR de compensação [-a, 1+2a, -a] com a = 3/16, em Q4. A resposta em DC é 1
+ * e o ganho sobe perto de fs/4, compensando a queda do sinc^3 do CIC. */
+static const int32_t coeficientesFir[FIR_COMPENSACAO_TAPS] = {-3, 22, -3};
+#define FIR_Q               4
+
+/* Inicializa o decimador com razão de decimação 2^log2Fator, que deve
+ * satisfazer DECIMADOR_FATOR_VALIDO. */
+void decimador_init(decimador_t *decimador, uint32_t log2Fator)
+{
+    uint32_t i = 0;
+    uint32_t bitsCic = DECIMADOR_BITS_ENTRADA + CIC_ORDEM * log2Fator;
+
+    for(i = 0 ; i < CIC_ORDEM ; i++)
+    {
+        decimador->integradores[i] = 0;
+        decimador->atrasosPente[i] = 0;
+    }
+    for(i = 0 ; i < FIR_COMPENSACAO_TAPS ; i++)
+    {
+        decimador->historicoFir[i] = 0;
+    }
+    decimador->log2Fator = log2Fator;
+    decimador->deslocamento = bitsCic - DECIMADOR_BITS_SAIDA;
+    decimador->contador = 0;
+
+    /* Partindo de acumuladores zerados, as primeiras saídas do CIC e do FIR
+     * ainda contêm parte da condição inicial e são descartadas */
+    decimador->saidasDescartadas = (CIC_ORDEM - 1) + (FIR_COMPENSACAO_TAPS - 1);
+}
+
+/* Adiciona uma amostra bruta do ADC ao decimador. A cada 2^log2Fator amostras
+ * uma nova saída de DECIMADOR_BITS_SAIDA bits é escrita em saida e a função
+ * retorna true; nas demais chamadas ela retorna false. */
+bool decimador_adiciona(decimador_t *decimador, uint32_t amostra, uint16_t *saida)
+{
+    uint32_t valor = amostra;
+    uint32_t atraso = 0;
+    int32_t acumulador = 0;
+    uint32_t i = 0;
+
+    /* Seção dos integradores, executada na taxa de entrada */
+    for(i = 0 ; i < CIC_ORDEM ; i++)
+    {
+        decimador->integradores[i] += valor;
+        valor = decimador->integradores[i];
+    }
+
+    if(++decimador->contador < (1u << decimador->log2Fator))
+    {
+        return false;
+    }
+    decimador->contador = 0;
+
+    /* Seção dos pentes, executada na taxa de saída */
+    for(i = 0 ; i < CIC_ORDEM ; i++)
+    {
+        atraso = decimador->atrasosPente[i];
+        decimador->atrasosPente[i] = valor;
+        valor -= atraso;
+    }
+    valor >>= decimador->deslocamento;
+
+    /* FIR de compensação */
+    for(i = FIR_COMPENSACAO_TAPS - 1 ; i > 0 ; i--)
+    {
+        decimador->historicoFir[i] = decimador->historicoFir[i - 1];
+    }
+    decimador->historicoFir[0] = valor;
+    for(i = 0 ; i < FIR_COMPENSACAO_TAPS ; i++)
+    {
+        acumulador += coeficientesFir[i] * (int32_t)decimador->historicoFir[i];
+    }
+    acumulador = (acumulador + (1 << (FIR_Q - 1))) >> FIR_Q;
+
+    if(decimador->saidasDescartadas > 0)
+    {
+        decimador->saidasDescartadas--;
+        return false;
+    }
+
+    /* Os coeficientes negativos do FIR podem levar a saída levemente para fora
+     * da escala em degraus, então ela é saturada */
+    if(acumulador < 0)
+    {
+        acumulador = 0;
+    }
+    else if(acumulador > (1 << DECIMADOR_BITS_SAIDA) - 1)
+    {
+        acumulador = (1 << DECIMADOR_BITS_SAIDA) - 1;
+    }
+    *saida = (uint16_t)acumulador;
+    return true;
+}
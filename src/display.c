@@ -0,0 +1,258 @@
+#include "display.h"
+
+/* Este arquivo envia o framebuffer (framebuffer.c) a um display OLED SSD1306
+ * de 128x64 pixels, ligado por SPI. A memória do SSD1306 é organizada em
+ * páginas como o framebuffer, e no modo de endereçamento horizontal basta
+ * definir a janela de colunas e páginas de uma região para que os bytes
+ * seguintes a preencham. Cada retângulo sujo é então uma sequência de
+ * DISPLAY_BYTES_COMANDO bytes de comando, com a linha D/C em 0, seguida dos
+ * seus dados, com a linha D/C em 1. */
+
+#define SSD1306_JANELA_COLUNAS  0x21
+#define SSD1306_JANELA_PAGINAS  0x22
+
+/* Sequência de inicialização do SSD1306 para um painel de 128x64 alimentado
+ * pela bomba de carga interna, no modo de endereçamento horizontal */
+#define SSD1306_INICIALIZACAO   {                                               \
+    0xAE,               /* Display desligado                                */  \
+    0xD5, 0x80,         /* Frequência do oscilador                          */  \
+    0xA8, 0x3F,         /* 64 linhas                                        */  \
+    0xD3, 0x00,         /* Sem deslocamento vertical                        */  \
+    0x40,               /* Primeira linha na página 0                       */  \
+    0x8D, 0x14,         /* Bomba de carga ligada                            */  \
+    0x20, 0x00,         /* Endereçamento horizontal                         */  \
+    0xA1, 0xC8,         /* Coluna 0 à esquerda e página 0 em cima           */  \
+    0xDA, 0x12,         /* Configuração dos pinos das linhas                */  \
+    0x81, 0xCF,         /* Contraste                                        */  \
+    0xD9, 0xF1,         /* Pré-carga                                        */  \
+    0xDB, 0x40,         /* Nível de VCOMH                                   */  \
+    0xA4, 0xA6,         /* Exibe a memória, sem inversão                    */  \
+    0xAF                /* Display ligado                                   */  \
+}
+
+/* Monta os comandos que definem a janela de uma região. Retorna o número de
+ * bytes, que é sempre DISPLAY_BYTES_COMANDO. */
+uint32_t display_comandosRegiao(const regiaoFramebuffer_t *regiao, uint8_t *comandos)
+{
+    comandos[0] = SSD1306_JANELA_COLUNAS;
+    comandos[1] = regiao->inicio;
+    comandos[2] = (uint8_t)(regiao->fim - 1);
+    comandos[3] = SSD1306_JANELA_PAGINAS;
+    comandos[4] = regiao->pagina;
+    comandos[5] = regiao->pagina;
+    return DISPLAY_BYTES_COMANDO;
+}
+
+#ifdef ESP_PLATFORM
+
+#include "definitions.h"
+#include "driver/spi_master.h"
+#include "driver/gpio.h"
+#include "esp_attr.h"
+
+static spi_device_handle_t display_spi;
+/* Os buffers enviados por DMA ficam na RAM interna. Há no máximo uma região
+ * por página, e cada uma usa uma transação de comandos e uma de dados. */
+static DMA_ATTR uint8_t inicializacao[] = SSD1306_INICIALIZACAO;
+static DMA_ATTR uint8_t comandos[FRAMEBUFFER_PAGINAS][DISPLAY_BYTES_COMANDO];
+static spi_transaction_t transacoes[2 * FRAMEBUFFER_PAGINAS];
+
+/* Chamada pelo driver antes de cada transação, para ajustar a linha D/C */
+static void IRAM_ATTR preTransacao(spi_transaction_t *transacao)
+{
+    gpio_set_level(DISPLAY_DC, transacao->user != NULL);
+}
+
+void display_init()
+{
+    spi_bus_config_t buscfg = {
+        .mosi_io_num = DISPLAY_MOSI,
+        .miso_io_num = -1,
+        .sclk_io_num = DISPLAY_SCLK,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = FRAMEBUFFER_LARGURA,
+    };
+    spi_device_interface_config_t devcfg = {
+        .clock_speed_hz = DISPLAY_SPI_HZ,
+        .mode = 0,
+        .spics_io_num = DISPLAY_CS,
+        .queue_size = 2 * FRAMEBUFFER_PAGINAS,
+        .pre_cb = preTransacao,
+    };
+    spi_transaction_t transacao = {
+        .length = 8 * sizeof(inicializacao),
+        .tx_buffer = inicializacao,
+        .user = (void *)0,
+    };
+
+    /* O termopar usa o HSPI, então o display fica no VSPI, com o canal 2 de
+     * DMA */
+    gpio_set_direction(DISPLAY_DC, GPIO_MODE_OUTPUT);
+    if(spi_bus_initialize(VSPI_HOST, &buscfg, 2) != ESP_OK ||
+       spi_bus_add_device(VSPI_HOST, &devcfg, &display_spi) != ESP_OK)
+    {
+        display_spi = NULL;
+        return;
+    }
+    spi_device_polling_transmit(display_spi, &transacao);
+}
+
+/* Envia todos os retângulos sujos do framebuffer. As transações são todas
+ * enfileiradas antes de esperar pela primeira, então o DMA transfere uma
+ * região enquanto a próxima é preparada, e a task que chama esta função fica
+ * bloqueada sem ocupar a CPU até o fim. Retorna o número de bytes
+ * transferidos. */
+uint32_t display_envia(framebuffer_t *framebuffer)
+{
+    regiaoFramebuffer_t regiao;
+    spi_transaction_t *transacao = NULL;
+    uint32_t numeroDeTransacoes = 0;
+    uint32_t bytes = 0;
+    uint32_t i = 0;
+
+    if(display_spi == NULL)
+    {
+        return 0;
+    }
+    while(framebuffer_proximaRegiao(framebuffer, &regiao))
+    {
+        transacao = &transacoes[numeroDeTransacoes];
+        transacao[0] = (spi_transaction_t){
+            .length = 8 * display_comandosRegiao(&regiao, comandos[regiao.pagina]),
+            .tx_buffer = comandos[regiao.pagina],
+            .user = (void *)0,
+        };
+        transacao[1] = (spi_transaction_t){
+            .length = 8 * (regiao.fim - regiao.inicio),
+            .tx_buffer = regiao.dados,
+            .user = (void *)1,
+        };
+        spi_device_queue_trans(display_spi, &transacao[0], portMAX_DELAY);
+        spi_device_queue_trans(display_spi, &transacao[1], portMAX_DELAY);
+        numeroDeTransacoes += 2;
+        bytes += DISPLAY_BYTES_COMANDO + regiao.fim - regiao.inicio;
+    }
+    for(i = 0 ; i < numeroDeTransacoes ; i++)
+    {
+        spi_device_get_trans_result(display_spi, &transacao, portMAX_DELAY);
+    }
+    return bytes;
+}
+
+#else
+
+/* Display simulado usado no build para host: a memória do SSD1306 e o
+ * interpretador dos comandos de janela, que recebem exatamente os bytes que
+ * seriam transmitidos pelo SPI */
+static uint8_t memoria[FRAMEBUFFER_PAGINAS][FRAMEBUFFER_LARGURA];
+static uint8_t janelaColunas[2] = {0, FRAMEBUFFER_LARGURA - 1};
+static uint8_t janelaPaginas[2] = {0, FRAMEBUFFER_PAGINAS - 1};
+static uint8_t coluna = 0;
+static uint8_t pagina = 0;
+
+/* Número de parâmetros de cada comando da sequência de inicialização */
+static uint32_t parametrosDoComando(uint8_t comando)
+{
+    switch (comando)
+    {
+    case SSD1306_JANELA_COLUNAS:
+    case SSD1306_JANELA_PAGINAS:
+        return 2;
+    case 0x20:
+    case 0x81:
+    case 0x8D:
+    case 0xA8:
+    case 0xD3:
+    case 0xD5:
+    case 0xD9:
+    case 0xDA:
+    case 0xDB:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static void simulaComandos(const uint8_t *bytes, uint32_t n)
+{
+    uint32_t i = 0;
+
+    while(i < n)
+    {
+        if(bytes[i] == SSD1306_JANELA_COLUNAS && i + 2 < n)
+        {
+            janelaColunas[0] = bytes[i + 1];
+            janelaColunas[1] = bytes[i + 2];
+            coluna = janelaColunas[0];
+        }
+        else if(bytes[i] == SSD1306_JANELA_PAGINAS && i + 2 < n)
+        {
+            janelaPaginas[0] = bytes[i + 1];
+            janelaPaginas[1] = bytes[i + 2];
+            pagina = janelaPaginas[0];
+        }
+        i += 1 + parametrosDoComando(bytes[i]);
+    }
+}
+
+static void simulaDados(const uint8_t *bytes, uint32_t n)
+{
+    uint32_t i = 0;
+
+    for(i = 0 ; i < n ; i++)
+    {
+        memoria[pagina % FRAMEBUFFER_PAGINAS][coluna % FRAMEBUFFER_LARGURA] = bytes[i];
+        if(coluna < janelaColunas[1])
+        {
+            coluna++;
+            continue;
+        }
+        coluna = janelaColunas[0];
+        pagina = (pagina < janelaPaginas[1]) ? pagina + 1 : janelaPaginas[0];
+    }
+}
+
+void display_init()
+{
+    static const uint8_t inicializacao[] = SSD1306_INICIALIZACAO;
+    uint32_t i = 0;
+    uint32_t j = 0;
+
+    for(i = 0 ; i < FRAMEBUFFER_PAGINAS ; i++)
+    {
+        for(j = 0 ; j < FRAMEBUFFER_LARGURA ; j++)
+        {
+            memoria[i][j] = 0;
+        }
+    }
+    simulaComandos(inicializacao, sizeof(inicializacao));
+}
+
+uint32_t display_envia(framebuffer_t *framebuffer)
+{
+    regiaoFramebuffer_t regiao;
+    uint8_t comandos[DISPLAY_BYTES_COMANDO];
+    uint32_t bytes = 0;
+
+    while(framebuffer_proximaRegiao(framebuffer, &regiao))
+    {
+        simulaComandos(comandos, display_comandosRegiao(&regiao, comandos));
+        simulaDados(regiao.dados, regiao.fim - regiao.inicio);
+        bytes += DISPLAY_BYTES_COMANDO + regiao.fim - regiao.inicio;
+    }
+    return bytes;
+}
+
+const uint8_t (*display_simulaMemoria())[FRAMEBUFFER_LARGURA]
+{
+    return (const uint8_t (*)[FRAMEBUFFER_LARGURA])memoria;
+}
+
+/* Grava o que o display simulado está mostrando em uma imagem PBM */
+bool display_gravaImagem(FILE *arquivo)
+{
+    return framebuffer_gravaPbm((const uint8_t (*)[FRAMEBUFFER_LARGURA])memoria, arquivo);
+}
+
+#endif
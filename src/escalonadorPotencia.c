@@ -0,0 +1,180 @@
+#include "escalonadorPotencia.h"
+#include <stddef.h>
+
+/* Este arquivo limita a potência somada das resistências que compartilham uma
+ * mesma alimentação. O controle de temperatura de cada resistência apenas
+ * pede que ela seja ligada ou desligada, e a cada slot de tempo (um período
+ * de leitura, cuja duração varia com a amostragem adaptativa) o escalonador
+ * decide quais pedidos de ligar são atendidos:
+ *
+ *  - a soma das potências ligadas nunca passa do orçamento;
+ *  - no máximo ligamentosPorSlot resistências são ligadas em um mesmo slot,
+ *    o que escalona os ligamentos que aconteceriam juntos, por exemplo quando
+ *    vários fornos começam a aquecer ao mesmo tempo;
+ *  - quando os pedidos passam do orçamento, a resistência que espera há mais
+ *    tempo é atendida primeiro, e uma resistência ligada cede a vez depois de
+ *    tempoMinimoMs, qualquer que seja a duração dos slots. Assim a potência disponível é dividida em ciclos de
+ *    trabalho entre todas as resistências que pedem, em vez de ficar com as
+ *    primeiras.
+ *
+ * Desligar nunca aumenta a carga, então um pedido de desligar é atendido
+ * imediatamente, sem esperar pelo slot. */
+
+void escalonador_init(escalonador_t *escalonador, float orcamento, uint32_t ligamentosPorSlot,
+                      uint32_t tempoMinimoMs)
+{
+    escalonador->numeroDeSaidas = 0;
+    escalonador->orcamento = orcamento;
+    escalonador->ligamentosPorSlot = ligamentosPorSlot;
+    escalonador->tempoMinimoMs = tempoMinimoMs;
+    escalonador->potenciaAtual = 0;
+    escalonador->picoPotencia = 0;
+    escalonador->energia = 0;
+    escalonador->tempoMs = 0;
+    escalonador->slots = 0;
+}
+
+/* Retorna o índice da nova saída, ou -1 se não houver espaço */
+int32_t escalonador_adicionaSaida(escalonador_t *escalonador, const char *nome, float potencia)
+{
+    saidaPotencia_t *saida = NULL;
+
+    if(escalonador->numeroDeSaidas >= ESCALONADOR_MAX_SAIDAS)
+    {
+        return -1;
+    }
+    saida = &escalonador->saidas[escalonador->numeroDeSaidas];
+    saida->nome = nome;
+    saida->potencia = potencia;
+    saida->pedido = false;
+    saida->ligada = false;
+    saida->espera = 0;
+    saida->tempoLigadaMs = 0;
+    saida->negados = 0;
+    return (int32_t)escalonador->numeroDeSaidas++;
+}
+
+void escalonador_pede(escalonador_t *escalonador, uint32_t saida, bool ligar)
+{
+    saidaPotencia_t *s = &escalonador->saidas[saida];
+
+    s->pedido = ligar;
+    if(!ligar && s->ligada)
+    {
+        s->ligada = false;
+        escalonador->potenciaAtual -= s->potencia;
+    }
+}
+
+/* Prioridade de uma saída que pede para ser ligada. Uma resistência ligada há
+ * menos de tempoMinimoMs continua ligada, as que esperam são atendidas
+ * da maior espera para a menor, e as ligadas há mais tempo vêm por último. */
+static uint32_t prioridade(const escalonador_t *escalonador, const saidaPotencia_t *saida)
+{
+    if(saida->ligada && saida->tempoLigadaMs < escalonador->tempoMinimoMs)
+    {
+        return UINT32_MAX;
+    }
+    return saida->ligada ? 0 : saida->espera + 1;
+}
+
+/* Decide as saídas ligadas no próximo slot, que dura duracaoMs */
+void escalonador_executa(escalonador_t *escalonador, uint32_t duracaoMs)
+{
+    bool decidida[ESCALONADOR_MAX_SAIDAS];
+    bool concedida[ESCALONADOR_MAX_SAIDAS];
+    saidaPotencia_t *saida = NULL;
+    float potencia = 0;
+    uint32_t ligamentos = 0;
+    uint32_t melhor = 0;
+    uint32_t i = 0;
+    uint32_t j = 0;
+    bool encontrada = false;
+
+    for(i = 0 ; i < escalonador->numeroDeSaidas ; i++)
+    {
+        decidida[i] = !escalonador->saidas[i].pedido;
+        concedida[i] = false;
+    }
+
+    /* Os pedidos são atendidos em ordem de prioridade enquanto houver
+     * orçamento. Com poucas saídas a busca repetida pelo maior é mais simples
+     * que uma ordenação, e igualmente rápida. */
+    for(j = 0 ; j < escalonador->numeroDeSaidas ; j++)
+    {
+        encontrada = false;
+        for(i = 0 ; i < escalonador->numeroDeSaidas ; i++)
+        {
+            if(!decidida[i] && (!encontrada || prioridade(escalonador, &escalonador->saidas[i]) >
+                                               prioridade(escalonador, &escalonador->saidas[melhor])))
+            {
+                melhor = i;
+                encontrada = true;
+            }
+        }
+        if(!encontrada)
+        {
+            break;
+        }
+        decidida[melhor] = true;
+        saida = &escalonador->saidas[melhor];
+
+        if(potencia + saida->potencia > escalonador->orcamento)
+        {
+            continue;
+        }
+        if(!saida->ligada)
+        {
+            if(ligamentos >= escalonador->ligamentosPorSlot)
+            {
+                continue;
+            }
+            ligamentos++;
+        }
+        concedida[melhor] = true;
+        potencia += saida->potencia;
+    }
+
+    for(i = 0 ; i < escalonador->numeroDeSaidas ; i++)
+    {
+        saida = &escalonador->saidas[i];
+        if(concedida[i])
+        {
+            saida->tempoLigadaMs = (saida->ligada ? saida->tempoLigadaMs : 0) + duracaoMs;
+            saida->espera = 0;
+        }
+        else if(saida->pedido)
+        {
+            saida->tempoLigadaMs = 0;
+            saida->espera++;
+            saida->negados++;
+        }
+        else
+        {
+            saida->tempoLigadaMs = 0;
+            saida->espera = 0;
+        }
+        saida->ligada = concedida[i];
+    }
+
+    escalonador->potenciaAtual = potencia;
+    if(potencia > escalonador->picoPotencia)
+    {
+        escalonador->picoPotencia = potencia;
+    }
+    escalonador->energia += (double)potencia * duracaoMs;
+    escalonador->tempoMs += duracaoMs;
+    escalonador->slots++;
+}
+
+bool escalonador_ligada(const escalonador_t *escalonador, uint32_t saida)
+{
+    return escalonador->saidas[saida].ligada;
+}
+
+/* Potência média concedida em W desde a inicialização, ponderada pela
+ * duração de cada slot */
+float escalonador_potenciaMedia(const escalonador_t *escalonador)
+{
+    return (escalonador->tempoMs > 0) ? (float)(escalonador->energia / escalonador->tempoMs) : 0;
+}
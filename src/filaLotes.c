@@ -0,0 +1,112 @@
+#include <ctype.h>
+#include <string.h>
+#include "filaLotes.h"
+
+/* Este arquivo contém a fila de lotes de produção, os cozimentos que o forno
+ * executa um após o outro (forno.c), e a interpretação dos comandos recebidos
+ * pela serial para adicionar lotes à fila. */
+
+void filaLotes_init(filaLotes_t *fila)
+{
+    fila->inicio = 0;
+    fila->tamanho = 0;
+}
+
+/* Retorna false se a fila estiver cheia */
+bool filaLotes_adiciona(filaLotes_t *fila, const lote_t *lote)
+{
+    if(fila->tamanho >= FILA_LOTES_MAX)
+    {
+        return false;
+    }
+    fila->lotes[(fila->inicio + fila->tamanho) % FILA_LOTES_MAX] = *lote;
+    fila->tamanho++;
+    return true;
+}
+
+/* Copia o próximo lote sem retirá-lo da fila. Retorna false se ela estiver
+ * vazia. */
+bool filaLotes_proximo(const filaLotes_t *fila, lote_t *lote)
+{
+    if(fila->tamanho == 0)
+    {
+        return false;
+    }
+    *lote = fila->lotes[fila->inicio];
+    return true;
+}
+
+bool filaLotes_retira(filaLotes_t *fila, lote_t *lote)
+{
+    if(!filaLotes_proximo(fila, lote))
+    {
+        return false;
+    }
+    fila->inicio = (fila->inicio + 1) % FILA_LOTES_MAX;
+    fila->tamanho--;
+    return true;
+}
+
+/* Nomes aceitos nos comandos, na ordem dos valores de modo_t e ponto_t */
+static const char *nomesModo[] = {"assar", "gratinar", "grelhar"};
+static const char *nomesPonto[] = {"mal_passado", "ao_ponto", "bem_passado"};
+
+/* Copia a próxima palavra de linha para palavra, em minúsculas, e retorna a
+ * posição seguinte a ela */
+static const char *proximaPalavra(const char *linha, char *palavra, uint32_t tamanho)
+{
+    uint32_t i = 0;
+
+    while(*linha != '\0' && isspace((unsigned char)*linha))
+    {
+        linha++;
+    }
+    while(*linha != '\0' && !isspace((unsigned char)*linha))
+    {
+        if(i + 1 < tamanho)
+        {
+            palavra[i++] = (char)tolower((unsigned char)*linha);
+        }
+        linha++;
+    }
+    palavra[i] = '\0';
+    return linha;
+}
+
+static int32_t buscaNome(const char *palavra, const char **nomes, uint32_t numeroDeNomes)
+{
+    uint32_t i = 0;
+
+    for(i = 0 ; i < numeroDeNomes ; i++)
+    {
+        if(strcmp(palavra, nomes[i]) == 0)
+        {
+            return (int32_t)i;
+        }
+    }
+    return -1;
+}
+
+/* Interpreta um comando no formato "<modo> <ponto>", por exemplo
+ * "assar bem_passado", sem diferenciar maiúsculas de minúsculas. Retorna
+ * false se o comando for inválido. */
+bool filaLotes_interpretaComando(const char *linha, lote_t *lote)
+{
+    char palavra[16];
+    int32_t modo = -1;
+    int32_t ponto = -1;
+
+    linha = proximaPalavra(linha, palavra, sizeof(palavra));
+    modo = buscaNome(palavra, nomesModo, sizeof(nomesModo) / sizeof(nomesModo[0]));
+    linha = proximaPalavra(linha, palavra, sizeof(palavra));
+    ponto = buscaNome(palavra, nomesPonto, sizeof(nomesPonto) / sizeof(nomesPonto[0]));
+    proximaPalavra(linha, palavra, sizeof(palavra));
+
+    if(modo < 0 || ponto < 0 || palavra[0] != '\0')
+    {
+        return false;
+    }
+    lote->modo = (modo_t)modo;
+    lote->ponto = (ponto_t)ponto;
+    return true;
+}
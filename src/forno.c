@@ -0,0 +1,362 @@
+#include "forno.h"
+#include "parametrosCozimento.h"
+#include "termopar.h"
+
+/* Este arquivo contém a lógica de um forno, separada das tasks, filas e
+ * timers do FreeRTOS que a executam no ESP32 (controleForno.c). Todo acesso
+ * ao hardware passa pelo halForno_t do forno, e todo estado fica no forno_t,
+ * de forma que as funções são reentrantes: fornos diferentes podem ser
+ * usados ao mesmo tempo por threads diferentes, como na simulação de uma
+ * frota no host.
+ *
+ * As funções não fazem nenhuma exclusão mútua. Quem chama a mesma instância
+ * de mais de uma task deve serializar as chamadas, com exceção de
+ * forno_leSensores, que só acessa o decimador e pode executar ao mesmo tempo
+ * que as demais.
+ *
+ * Os cozimentos são executados como lotes de uma fila (filaLotes.c). Ao fim
+ * de um lote, se houver outro na fila, o forno passa a PREAQUECENDO e mantém
+ * a temperatura do próximo lote, que começa assim que for carregado, ou seja,
+ * quando a porta for aberta e fechada. Assim a cavidade não esfria entre um
+ * lote e outro. */
+
+void forno_init(forno_t *forno, const halForno_t *hal)
+{
+    forno->hal = *hal;
+    forno->status = AGUARDANDO_ACAO;
+    forno->modo = ASSAR;
+    forno->ponto = MAL_PASSADO;
+    forno->proximoModo = ASSAR;
+    forno->proximoPonto = MAL_PASSADO;
+    sessao_encerra(&forno->sessao);
+    decimador_init(&forno->decimador, ADC_DECIMACAO_LOG2);
+    forno->ultimaRajada = 0;
+    controleTemperatura_init(&forno->controle);
+    amostragem_init(&forno->amostragem, AMOSTRAGEM_PERIODO_MIN_MS, AMOSTRAGEM_PERIODO_MAX_MS);
+    filaLotes_init(&forno->fila);
+    indicadores_init(&forno->indicadores);
+    forno->portaAberta = false;
+    forno->carregado = false;
+    forno->lotesConcluidos = 0;
+
+    forno->hal.ledsModo(forno->hal.contexto, forno->modo);
+    forno->hal.ledsPonto(forno->hal.contexto, forno->ponto);
+}
+
+/* Trata um toque no botão de seleção do modo, que alterna entre ASSAR,
+ * GRATINAR e GRELHAR. Retorna false se houver um cozimento em andamento,
+ * quando não é possível escolher outro modo. */
+bool forno_selecionaModo(forno_t *forno)
+{
+    if(forno->status == ACAO_INICIADA)
+    {
+        return false;
+    }
+
+    /* O modo escolhido é o registrado no toque anterior, e o próximo é
+     * registrado para quando o botão for novamente pressionado */
+    forno->modo = forno->proximoModo;
+    switch (forno->proximoModo)
+    {
+    case ASSAR:
+        forno->proximoModo = GRATINAR;
+        break;
+    case GRATINAR:
+        forno->proximoModo = GRELHAR;
+        break;
+    case GRELHAR:
+    default:
+        forno->proximoModo = ASSAR;
+        break;
+    }
+    forno->hal.ledsModo(forno->hal.contexto, forno->modo);
+    return true;
+}
+
+/* Trata um toque no botão de seleção do ponto, que alterna entre MAL_PASSADO,
+ * AO_PONTO e BEM_PASSADO */
+bool forno_selecionaPonto(forno_t *forno)
+{
+    if(forno->status == ACAO_INICIADA)
+    {
+        return false;
+    }
+
+    forno->ponto = forno->proximoPonto;
+    switch (forno->proximoPonto)
+    {
+    case MAL_PASSADO:
+        forno->proximoPonto = AO_PONTO;
+        break;
+    case AO_PONTO:
+        forno->proximoPonto = BEM_PASSADO;
+        break;
+    case BEM_PASSADO:
+    default:
+        forno->proximoPonto = MAL_PASSADO;
+        break;
+    }
+    forno->hal.ledsPonto(forno->hal.contexto, forno->ponto);
+    return true;
+}
+
+/* Trata o botão start: um lote com o modo e o ponto selecionados é
+ * adicionado à fila. Com o forno parado o alimento já está dentro, e o
+ * cozimento começa imediatamente, e nesse caso a sua duração em us é
+ * retornada para que o chamador arme o seu timer. Caso contrário o lote
+ * espera a sua vez e 0 é retornado. */
+int64_t forno_inicia(forno_t *forno)
+{
+    bool parado = (forno->status == AGUARDANDO_ACAO);
+
+    if(forno->status == ACAO_INICIADA || !forno_adicionaLote(forno, forno->modo, forno->ponto))
+    {
+        return 0;
+    }
+    if(!parado)
+    {
+        return 0;
+    }
+    forno->carregado = true;
+    return forno_iniciaProximo(forno);
+}
+
+/* Adiciona um lote à fila, pelo botão start ou pela serial. Com o forno
+ * parado o preaquecimento para o lote começa imediatamente. Retorna false se
+ * a fila estiver cheia. */
+bool forno_adicionaLote(forno_t *forno, modo_t modo, ponto_t ponto)
+{
+    lote_t lote = {modo, ponto};
+
+    if(!filaLotes_adiciona(&forno->fila, &lote))
+    {
+        return false;
+    }
+    if(forno->status == AGUARDANDO_ACAO)
+    {
+        forno->status = PREAQUECENDO;
+        forno->carregado = false;
+    }
+    return true;
+}
+
+/* Inicia o próximo lote da fila, se ele já tiver sido carregado. Retorna a
+ * duração do cozimento em us, ou 0 se nenhum cozimento foi iniciado. */
+int64_t forno_iniciaProximo(forno_t *forno)
+{
+    int64_t duracao = 0;
+    int64_t agora = 0;
+    lote_t lote;
+
+    if(forno->status == ACAO_INICIADA || !forno->carregado || !filaLotes_retira(&forno->fila, &lote))
+    {
+        return 0;
+    }
+    forno->carregado = false;
+    forno->modo = lote.modo;
+    forno->ponto = lote.ponto;
+    forno->hal.ledsModo(forno->hal.contexto, forno->modo);
+    forno->hal.ledsPonto(forno->hal.contexto, forno->ponto);
+
+    duracao = (int64_t)getTempoDeFuncionamentoDoPonto(forno->ponto) * 1000;
+    agora = forno->hal.agora(forno->hal.contexto);
+    forno->status = ACAO_INICIADA;
+    sessao_inicia(&forno->sessao, duracao, agora);
+    indicadores_inicia(&forno->indicadores, forno->modo, forno->ponto, forno_temperaturaAlvo(forno), agora,
+                       forno->controle.resistenciaLigada);
+    return duracao;
+}
+
+/* Temperatura que o controle deve manter: a do lote em andamento, a do
+ * próximo lote entre dois lotes, ou 0 com o forno parado */
+uint32_t forno_temperaturaAlvo(const forno_t *forno)
+{
+    lote_t proximo;
+
+    if(forno->status == ACAO_INICIADA)
+    {
+        return getTemperaturaAlvoDoModo(forno->modo);
+    }
+    if(forno->status == PREAQUECENDO && filaLotes_proximo(&forno->fila, &proximo))
+    {
+        return getTemperaturaAlvoDoModo(proximo.modo);
+    }
+    return 0;
+}
+
+/* Trabalho de um período da task adcRead: uma rajada de NUMBER_OF_SAMPLES
+ * leituras brutas do LM35 passa pelo decimador (decimador.c), que resulta em
+ * uma única saída de 16 bits, e a cada saída o termopar também é lido.
+ * Retorna true se leitura foi preenchida. O próximo período é dado por
+ * forno_periodoLeituraMs. */
+bool forno_leSensores(forno_t *forno, leitura_t *leitura)
+{
+    uint16_t amostras[NUMBER_OF_SAMPLES];
+    uint16_t saida = 0;
+    uint16_t quadro = 0;
+    int64_t agora = forno->hal.agora(forno->hal.contexto);
+    bool saidaPronta = false;
+    uint32_t i = 0;
+
+    /* Entre um cozimento e outro as leituras param, então se a última rajada
+     * for antiga o histórico do decimador não representa mais a temperatura
+     * do forno, e o pipeline é reiniciado */
+    if((agora - forno->ultimaRajada) > 2 * (int64_t)forno->amostragem.periodoMaximoMs * 1000)
+    {
+        decimador_init(&forno->decimador, ADC_DECIMACAO_LOG2);
+    }
+    forno->ultimaRajada = agora;
+
+    forno->hal.leAdc(forno->hal.contexto, amostras, NUMBER_OF_SAMPLES);
+    for(i = 0 ; i < NUMBER_OF_SAMPLES ; i++)
+    {
+        saidaPronta = decimador_adiciona(&forno->decimador, amostras[i], &saida);
+    }
+
+    /* Enquanto o decimador estabiliza nenhuma leitura é produzida */
+    if(!saidaPronta)
+    {
+        return false;
+    }
+    leitura->lm35 = saida;
+    leitura->instante = agora;
+    leitura->termoparValido = forno->hal.leTermopar(forno->hal.contexto, &quadro) &&
+                              termopar_decodificaQuadro(quadro, &leitura->termopar);
+    return true;
+}
+
+/* Trabalho da task OutputControl para cada leitura: a decisão de ligar ou
+ * desligar a resistência é tomada em controleTemperatura.c e aplicada à
+ * saída, e o período até a próxima leitura é escolhido a partir da nova
+ * estimativa de temperatura (amostragemAdaptativa.c), que também atualiza os
+ * indicadores do cozimento (indicadoresCozimento.c). Com corte a resistência
+ * fica desligada, por exemplo enquanto o monitor de prazos (monitorPrazos.c)
+ * indicar uma task atrasada. Com a porta aberta, durante um lote ou entre
+ * dois lotes, a resistência também fica desligada. */
+bool forno_controla(forno_t *forno, const leitura_t *leitura, bool corte)
+{
+    uint32_t temperaturaAlvo = forno_temperaturaAlvo(forno);
+    /* Nível confirmado na leitura anterior, que a resistência teve até esta */
+    bool ligada = forno->controle.resistenciaLigada;
+    bool nivel = false;
+
+    /* O estimador prevê a temperatura pelo intervalo real desde a leitura
+     * anterior, que varia com o período */
+    forno->controle.periodo = amostragem_intervalo(&forno->amostragem, leitura->instante);
+    nivel = controleTemperatura_atualiza(&forno->controle, leitura, temperaturaAlvo,
+                                         forno->sessao.estado == SESSAO_PAUSADA || forno->portaAberta ||
+                                         forno->status == AGUARDANDO_ACAO);
+    amostragem_atualiza(&forno->amostragem, leitura->instante, forno->controle.temperaturaAtual, temperaturaAlvo);
+    indicadores_amostra(&forno->indicadores, leitura->instante, forno->controle.temperaturaAtual, ligada);
+
+    if(corte)
+    {
+        nivel = false;
+        forno->controle.resistenciaLigada = false;
+    }
+    forno->hal.resistencia(forno->hal.contexto, nivel);
+    return nivel;
+}
+
+/* O acionamento pedido por forno_controla pode ser adiado pelo escalonador de
+ * potência (escalonadorPotencia.c). O nível efetivamente aplicado é informado
+ * aqui, para que o estimador use a potência real no próximo período. */
+void forno_confirmaResistencia(forno_t *forno, bool nivel)
+{
+    forno->controle.resistenciaLigada = nivel;
+}
+
+/* Desliga a resistência quando não há leitura recente dos sensores */
+void forno_desligaResistencia(forno_t *forno)
+{
+    forno->controle.resistenciaLigada = false;
+    forno->hal.resistencia(forno->hal.contexto, false);
+}
+
+/* A abertura da porta pausa o cozimento e desliga a resistência, e o seu
+ * fechamento o retoma. Retorna true se o estado da sessão mudou, caso em que
+ * o chamador deve parar ou rearmar o seu timer com forno_restante. Entre dois
+ * lotes, abrir e fechar a porta indica que o próximo lote foi carregado, e o
+ * chamador deve então chamar forno_iniciaProximo. */
+bool forno_porta(forno_t *forno, bool aberta)
+{
+    int64_t agora = forno->hal.agora(forno->hal.contexto);
+    bool estavaAberta = forno->portaAberta;
+
+    forno->portaAberta = aberta;
+    if(forno->status == PREAQUECENDO)
+    {
+        if(aberta)
+        {
+            forno_desligaResistencia(forno);
+        }
+        else if(estavaAberta)
+        {
+            forno->carregado = true;
+        }
+        return false;
+    }
+
+    if(aberta)
+    {
+        if(!sessao_pausa(&forno->sessao, agora))
+        {
+            return false;
+        }
+        forno_desligaResistencia(forno);
+        return true;
+    }
+    return sessao_retoma(&forno->sessao, agora);
+}
+
+/* Acrescenta tempo em us ao cozimento em andamento. Valores negativos
+ * encurtam o cozimento. */
+void forno_estende(forno_t *forno, int64_t extensao)
+{
+    sessao_estende(&forno->sessao, extensao);
+}
+
+/* Retorna o tempo restante do cozimento em us, ou 0 se o forno estiver parado */
+int64_t forno_restante(const forno_t *forno)
+{
+    return sessao_restante(&forno->sessao, forno->hal.agora(forno->hal.contexto));
+}
+
+/* Chamada quando o tempo do cozimento deveria ter acabado. O cozimento pode
+ * ter sido estendido, e nesse caso o tempo que falta é retornado para que o
+ * chamador rearme o seu timer. Caso contrário 0 é retornado, os indicadores
+ * do cozimento são registrados, e se houver outro lote na fila o forno passa
+ * a mantê-lo aquecido, ou então volta ao estado inicial com a resistência
+ * desligada. */
+int64_t forno_verificaFim(forno_t *forno)
+{
+    int64_t restante = forno_restante(forno);
+
+    if(restante > 0)
+    {
+        return restante;
+    }
+    if(forno->status != ACAO_INICIADA)
+    {
+        return 0;
+    }
+    forno->lotesConcluidos++;
+    indicadores_finaliza(&forno->indicadores, forno->hal.agora(forno->hal.contexto), forno->lotesConcluidos);
+    sessao_encerra(&forno->sessao);
+    if(forno->fila.tamanho > 0)
+    {
+        forno->status = PREAQUECENDO;
+        forno->carregado = false;
+        return 0;
+    }
+    forno_desligaResistencia(forno);
+    forno->status = AGUARDANDO_ACAO;
+    return 0;
+}
+
+/* Período em ms até a próxima leitura dos sensores, escolhido na última
+ * chamada a forno_controla */
+uint32_t forno_periodoLeituraMs(const forno_t *forno)
+{
+    return forno->amostragem.periodoMs;
+}
@@ -0,0 +1,250 @@
+#include "framebuffer.h"
+
+/* Este arquivo mantém a imagem do display em RAM. Os desenhos só alteram o
+ * framebuffer, e cada pixel que realmente muda de valor marca a sua coluna
+ * como suja na página a que pertence. Assim redesenhar um texto igual ao que
+ * já está na tela não gera nenhuma transferência, e quem envia a imagem ao
+ * display (display.c) transfere apenas os retângulos sujos de cada página. */
+
+/* Fonte 5x7 dos caracteres ' ' a 'Z'. Cada byte é uma coluna, com a linha de
+ * cima no bit 0, como na memória do display. Letras minúsculas são
+ * desenhadas como maiúsculas, e os demais caracteres como espaço. */
+#define FONTE_PRIMEIRO      ' '
+#define FONTE_ULTIMO        'Z'
+
+static const uint8_t fonte[FONTE_ULTIMO - FONTE_PRIMEIRO + 1][5] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00},   /* ' ' */
+    {0x00, 0x00, 0x00, 0x00, 0x00},   /* '!' */
+    {0x00, 0x00, 0x00, 0x00, 0x00},   /* '"' */
+    {0x00, 0x00, 0x00, 0x00, 0x00},   /* '#' */
+    {0x00, 0x00, 0x00, 0x00, 0x00},   /* '$' */
+    {0x23, 0x13, 0x08, 0x64, 0x62},   /* '%' */
+    {0x00, 0x00, 0x00, 0x00, 0x00},   /* '&' */
+    {0x00, 0x00, 0x00, 0x00, 0x00},   /* ''' */
+    {0x00, 0x00, 0x00, 0x00, 0x00},   /* '(' */
+    {0x00, 0x00, 0x00, 0x00, 0x00},   /* ')' */
+    {0x00, 0x00, 0x00, 0x00, 0x00},   /* '*' */
+    {0x00, 0x00, 0x00, 0x00, 0x00},   /* '+' */
+    {0x00, 0x00, 0x00, 0x00, 0x00},   /* ',' */
+    {0x08, 0x08, 0x08, 0x08, 0x08},   /* '-' */
+    {0x00, 0x60, 0x60, 0x00, 0x00},   /* '.' */
+    {0x20, 0x10, 0x08, 0x04, 0x02},   /* '/' */
+    {0x3E, 0x51, 0x49, 0x45, 0x3E},   /* '0' */
+    {0x00, 0x42, 0x7F, 0x40, 0x00},   /* '1' */
+    {0x42, 0x61, 0x51, 0x49, 0x46},   /* '2' */
+    {0x21, 0x41, 0x45, 0x4B, 0x31},   /* '3' */
+    {0x18, 0x14, 0x12, 0x7F, 0x10},   /* '4' */
+    {0x27, 0x45, 0x45, 0x45, 0x39},   /* '5' */
+    {0x3C, 0x4A, 0x49, 0x49, 0x30},   /* '6' */
+    {0x01, 0x71, 0x09, 0x05, 0x03},   /* '7' */
+    {0x36, 0x49, 0x49, 0x49, 0x36},   /* '8' */
+    {0x06, 0x49, 0x49, 0x29, 0x1E},   /* '9' */
+    {0x00, 0x36, 0x36, 0x00, 0x00},   /* ':' */
+    {0x00, 0x00, 0x00, 0x00, 0x00},   /* ';' */
+    {0x00, 0x00, 0x00, 0x00, 0x00},   /* '<' */
+    {0x00, 0x00, 0x00, 0x00, 0x00},   /* '=' */
+    {0x00, 0x00, 0x00, 0x00, 0x00},   /* '>' */
+    {0x00, 0x00, 0x00, 0x00, 0x00},   /* '?' */
+    {0x00, 0x00, 0x00, 0x00, 0x00},   /* '@' */
+    {0x7E, 0x09, 0x09, 0x09, 0x7E},   /* 'A' */
+    {0x7F, 0x49, 0x49, 0x49, 0x36},   /* 'B' */
+    {0x3E, 0x41, 0x41, 0x41, 0x22},   /* 'C' */
+    {0x7F, 0x41, 0x41, 0x22, 0x1C},   /* 'D' */
+    {0x7F, 0x49, 0x49, 0x49, 0x41},   /* 'E' */
+    {0x7F, 0x09, 0x09, 0x09, 0x01},   /* 'F' */
+    {0x3E, 0x41, 0x49, 0x49, 0x7A},   /* 'G' */
+    {0x7F, 0x08, 0x08, 0x08, 0x7F},   /* 'H' */
+    {0x00, 0x41, 0x7F, 0x41, 0x00},   /* 'I' */
+    {0x20, 0x40, 0x41, 0x3F, 0x01},   /* 'J' */
+    {0x7F, 0x08, 0x14, 0x22, 0x41},   /* 'K' */
+    {0x7F, 0x40, 0x40, 0x40, 0x40},   /* 'L' */
+    {0x7F, 0x02, 0x0C, 0x02, 0x7F},   /* 'M' */
+    {0x7F, 0x04, 0x08, 0x10, 0x7F},   /* 'N' */
+    {0x3E, 0x41, 0x41, 0x41, 0x3E},   /* 'O' */
+    {0x7F, 0x09, 0x09, 0x09, 0x06},   /* 'P' */
+    {0x3E, 0x41, 0x51, 0x21, 0x5E},   /* 'Q' */
+    {0x7F, 0x09, 0x19, 0x29, 0x46},   /* 'R' */
+    {0x46, 0x49, 0x49, 0x49, 0x31},   /* 'S' */
+    {0x01, 0x01, 0x7F, 0x01, 0x01},   /* 'T' */
+    {0x3F, 0x40, 0x40, 0x40, 0x3F},   /* 'U' */
+    {0x1F, 0x20, 0x40, 0x20, 0x1F},   /* 'V' */
+    {0x3F, 0x40, 0x38, 0x40, 0x3F},   /* 'W' */
+    {0x63, 0x14, 0x08, 0x14, 0x63},   /* 'X' */
+    {0x07, 0x08, 0x70, 0x08, 0x07},   /* 'Y' */
+    {0x61, 0x51, 0x49, 0x45, 0x43},   /* 'Z' */
+
+};
+
+/* No início toda a tela está suja, para que o primeiro envio sincronize o
+ * display com o framebuffer */
+void framebuffer_init(framebuffer_t *framebuffer)
+{
+    uint32_t pagina = 0;
+    uint32_t coluna = 0;
+
+    for(pagina = 0 ; pagina < FRAMEBUFFER_PAGINAS ; pagina++)
+    {
+        for(coluna = 0 ; coluna < FRAMEBUFFER_LARGURA ; coluna++)
+        {
+            framebuffer->pixels[pagina][coluna] = 0;
+        }
+        framebuffer->sujoInicio[pagina] = 0;
+        framebuffer->sujoFim[pagina] = FRAMEBUFFER_LARGURA;
+    }
+}
+
+/* Pixels fora da tela são ignorados */
+void framebuffer_pixel(framebuffer_t *framebuffer, uint32_t x, uint32_t y, bool aceso)
+{
+    uint32_t pagina = y / 8;
+    uint8_t mascara = (uint8_t)(1 << (y % 8));
+    uint8_t anterior = 0;
+    uint8_t novo = 0;
+
+    if(x >= FRAMEBUFFER_LARGURA || y >= FRAMEBUFFER_ALTURA)
+    {
+        return;
+    }
+    anterior = framebuffer->pixels[pagina][x];
+    novo = aceso ? (anterior | mascara) : (anterior & (uint8_t)~mascara);
+    if(novo == anterior)
+    {
+        return;
+    }
+    framebuffer->pixels[pagina][x] = novo;
+    if(framebuffer->sujoInicio[pagina] >= framebuffer->sujoFim[pagina])
+    {
+        framebuffer->sujoInicio[pagina] = (uint8_t)x;
+        framebuffer->sujoFim[pagina] = (uint8_t)(x + 1);
+    }
+    else if(x < framebuffer->sujoInicio[pagina])
+    {
+        framebuffer->sujoInicio[pagina] = (uint8_t)x;
+    }
+    else if(x >= framebuffer->sujoFim[pagina])
+    {
+        framebuffer->sujoFim[pagina] = (uint8_t)(x + 1);
+    }
+}
+
+void framebuffer_retangulo(framebuffer_t *framebuffer, uint32_t x, uint32_t y, uint32_t largura,
+                           uint32_t altura, bool aceso)
+{
+    uint32_t i = 0;
+    uint32_t j = 0;
+
+    for(j = y ; j < y + altura ; j++)
+    {
+        for(i = x ; i < x + largura ; i++)
+        {
+            framebuffer_pixel(framebuffer, i, j, aceso);
+        }
+    }
+}
+
+/* Desenha um texto a partir do canto superior esquerdo (x, y), com cada pixel
+ * da fonte ampliado escala vezes. O fundo de cada caractere também é
+ * desenhado, então um texto pode ser sobrescrito por outro do mesmo tamanho
+ * sem apagar a área antes. Retorna a largura desenhada em pixels. */
+uint32_t framebuffer_texto(framebuffer_t *framebuffer, uint32_t x, uint32_t y, const char *texto,
+                           uint32_t escala)
+{
+    const uint8_t *glifo = NULL;
+    char caractere = 0;
+    uint32_t inicio = x;
+    uint32_t coluna = 0;
+    uint32_t linha = 0;
+
+    for( ; *texto != '\0' ; texto++)
+    {
+        caractere = *texto;
+        if(caractere >= 'a' && caractere <= 'z')
+        {
+            caractere = (char)(caractere - 'a' + 'A');
+        }
+        if(caractere < FONTE_PRIMEIRO || caractere > FONTE_ULTIMO)
+        {
+            caractere = ' ';
+        }
+        glifo = fonte[caractere - FONTE_PRIMEIRO];
+
+        for(coluna = 0 ; coluna < FRAMEBUFFER_LARGURA_CARACTERE ; coluna++)
+        {
+            for(linha = 0 ; linha < FRAMEBUFFER_ALTURA_CARACTERE ; linha++)
+            {
+                framebuffer_retangulo(framebuffer, x + coluna * escala, y + linha * escala, escala, escala,
+                                      coluna < 5 && (glifo[coluna] & (1 << linha)));
+            }
+        }
+        x += FRAMEBUFFER_LARGURA_CARACTERE * escala;
+    }
+    return x - inicio;
+}
+
+bool framebuffer_sujo(const framebuffer_t *framebuffer)
+{
+    uint32_t pagina = 0;
+
+    for(pagina = 0 ; pagina < FRAMEBUFFER_PAGINAS ; pagina++)
+    {
+        if(framebuffer->sujoInicio[pagina] < framebuffer->sujoFim[pagina])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Retira o retângulo sujo da próxima página que tiver um, que passa a ser
+ * considerada limpa. Os dados apontam para o próprio framebuffer, então ele
+ * não deve ser alterado enquanto a região estiver sendo enviada. Retorna
+ * false quando nada mais estiver sujo. */
+bool framebuffer_proximaRegiao(framebuffer_t *framebuffer, regiaoFramebuffer_t *regiao)
+{
+    uint32_t pagina = 0;
+
+    for(pagina = 0 ; pagina < FRAMEBUFFER_PAGINAS ; pagina++)
+    {
+        if(framebuffer->sujoInicio[pagina] < framebuffer->sujoFim[pagina])
+        {
+            regiao->pagina = (uint8_t)pagina;
+            regiao->inicio = framebuffer->sujoInicio[pagina];
+            regiao->fim = framebuffer->sujoFim[pagina];
+            regiao->dados = &framebuffer->pixels[pagina][regiao->inicio];
+            framebuffer->sujoInicio[pagina] = FRAMEBUFFER_LARGURA;
+            framebuffer->sujoFim[pagina] = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Grava uma imagem no formato PBM binário (P4), em que cada linha de pixels
+ * é gravada com o pixel mais à esquerda no bit mais significativo */
+bool framebuffer_gravaPbm(const uint8_t pixels[FRAMEBUFFER_PAGINAS][FRAMEBUFFER_LARGURA], FILE *arquivo)
+{
+    uint8_t linha[FRAMEBUFFER_LARGURA / 8];
+    uint32_t x = 0;
+    uint32_t y = 0;
+
+    fprintf(arquivo, "P4\n%u %u\n", FRAMEBUFFER_LARGURA, FRAMEBUFFER_ALTURA);
+    for(y = 0 ; y < FRAMEBUFFER_ALTURA ; y++)
+    {
+        for(x = 0 ; x < FRAMEBUFFER_LARGURA / 8 ; x++)
+        {
+            linha[x] = 0;
+        }
+        for(x = 0 ; x < FRAMEBUFFER_LARGURA ; x++)
+        {
+            if(pixels[y / 8][x] & (1 << (y % 8)))
+            {
+                linha[x / 8] |= (uint8_t)(0x80 >> (x % 8));
+            }
+        }
+        if(fwrite(linha, 1, sizeof(linha), arquivo) != sizeof(linha))
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,91 @@
+#include "fusaoSensores.h"
+#include "definitions.h"
+
+/* Este arquivo implementa a fusão das leituras do LM35 e do termopar com um
+ * filtro de Kalman escalar. O estado é a própria temperatura do forno, e o
+ * modelo de predição usa o estado da resistência como entrada:
+ *
+ *   T[k+1] = T[k] + dt * (u * taxaAquecimento - coeficientePerda * (T[k] - Tamb))
+ *
+ * onde u vale 1 com a resistência ligada e 0 com ela desligada. Como o modelo
+ * já "sabe" para onde a temperatura está indo, o filtro pode confiar menos
+ * nas medidas individuais sem atrasar a estimativa, o que não acontece com o
+ * filtro de médias simples. Cada sensor é incorporado em sequência, com a sua
+ * própria variância de medida. */
+
+void fusao_init(fusao_t *fusao)
+{
+    fusao->estimativa = FUSAO_TEMPERATURA_AMBIENTE;
+    fusao->variancia = 100.0f;
+    fusao->ruidoProcesso = FUSAO_RUIDO_PROCESSO;
+    fusao->ruidoLm35 = FUSAO_RUIDO_LM35;
+    fusao->ruidoTermopar = FUSAO_RUIDO_TERMOPAR;
+    fusao->taxaAquecimento = FUSAO_TAXA_AQUECIMENTO;
+    fusao->coeficientePerda = FUSAO_COEFICIENTE_PERDA;
+    fusao->temperaturaAmbiente = FUSAO_TEMPERATURA_AMBIENTE;
+    fusao->limiteDivergencia = FUSAO_LIMITE_DIVERGENCIA;
+    fusao->divergenteMs = 0;
+    fusao->divergencia = false;
+    fusao->inicializado = false;
+}
+
+/* Etapa de correção do filtro para uma única medida com variância r */
+static void fusao_corrige(fusao_t *fusao, float medida, float r)
+{
+    float ganho = fusao->variancia / (fusao->variancia + r);
+
+    fusao->estimativa += ganho * (medida - fusao->estimativa);
+    fusao->variancia *= (1.0f - ganho);
+}
+
+/* Recebe a leitura dos dois sensores em °C, o estado da resistência durante
+ * o último período e a duração desse período em segundos, e retorna a nova
+ * estimativa de temperatura. */
+float fusao_atualiza(fusao_t *fusao, float lm35, float termopar, bool termoparValido,
+                     bool resistenciaLigada, float dt)
+{
+    /* Verificação de coerência entre os sensores: uma diferença acima do limite
+     * durante FUSAO_TEMPO_DIVERGENCIA_MS sinaliza que um dos dois está com
+     * defeito. O tempo é somado período a período, porque o número de leituras
+     * nesse intervalo muda com a amostragem adaptativa. Um termopar aberto
+     * também é tratado como divergência, pois o forno ficaria dependendo de um
+     * único sensor. */
+    if(!termoparValido || (lm35 - termopar) > fusao->limiteDivergencia ||
+                          (termopar - lm35) > fusao->limiteDivergencia)
+    {
+        fusao->divergenteMs += (uint32_t)(dt * 1000.0f + 0.5f);
+        if(fusao->divergenteMs > FUSAO_TEMPO_DIVERGENCIA_MS)
+        {
+            fusao->divergenteMs = FUSAO_TEMPO_DIVERGENCIA_MS;
+        }
+    }
+    else
+    {
+        fusao->divergenteMs = 0;
+    }
+    fusao->divergencia = (fusao->divergenteMs >= FUSAO_TEMPO_DIVERGENCIA_MS);
+
+    /* Na primeira amostra não há histórico, então o filtro parte da leitura do LM35 */
+    if(!fusao->inicializado)
+    {
+        fusao->estimativa = lm35;
+        fusao->variancia = fusao->ruidoLm35;
+        fusao->inicializado = true;
+    }
+    else
+    {
+        /* Predição a partir do modelo térmico e da entrada da resistência */
+        fusao->estimativa += dt * ((resistenciaLigada ? fusao->taxaAquecimento : 0.0f) -
+                                   fusao->coeficientePerda * (fusao->estimativa - fusao->temperaturaAmbiente));
+        fusao->variancia += fusao->ruidoProcesso * dt;
+
+        fusao_corrige(fusao, lm35, fusao->ruidoLm35);
+    }
+
+    if(termoparValido)
+    {
+        fusao_corrige(fusao, termopar, fusao->ruidoTermopar);
+    }
+
+    return fusao->estimativa;
+}
@@ -0,0 +1,386 @@
+#include "gravacaoTraco.h"
+
+/* Este arquivo grava e lê traços binários do funcionamento do forno: as
+ * leituras brutas do ADC e do termopar, os botões, os lotes da serial e as
+ * decisões da saída da resistência, cada um com o seu instante. O formato é
+ * compacto para que um cozimento inteiro caiba na flash:
+ *
+ *   cabeçalho: "FTRC" seguido de um byte de versão
+ *   evento:    tipo (1 byte), diferença de tempo em us para o evento anterior
+ *              (inteiro de tamanho variável, 7 bits por byte) e os dados do tipo
+ *
+ * As amostras de 12 bits do ADC são empacotadas duas a duas em 3 bytes, e o
+ * quadro do termopar é gravado como está, para que a reprodução (reproducaoTraco.c)
+ * passe exatamente os mesmos dados pelo decimador e pelo estimador.
+ *
+ * No firmware a gravação não pode atrasar as tasks de controle com escritas
+ * na flash, então os eventos são codificados em um buffer circular em RAM
+ * (traco_usaBuffer), e uma task de baixa prioridade os retira com
+ * traco_retira e os escreve no arquivo. Um evento só entra no buffer se
+ * couber inteiro, para que o traço nunca fique corrompido; os que não cabem
+ * são contados em perdidos. */
+
+#define TRACO_VERSAO    2
+/* Maior cabeçalho de evento: o tipo e um uint64_t em 7 bits por byte */
+#define TRACO_MAX_CABECALHO     11
+
+static const uint8_t assinatura[4] = {'F', 'T', 'R', 'C'};
+
+static void gravaByte(traco_t *traco, uint8_t valor)
+{
+    if(traco->buffer != NULL)
+    {
+        traco->buffer[(traco->inicio + traco->tamanho) % traco->capacidade] = valor;
+        traco->tamanho++;
+    }
+    else
+    {
+        fputc(valor, traco->arquivo);
+    }
+    traco->bytes++;
+}
+
+/* Verifica se um evento com até n bytes de dados cabe no buffer */
+static bool cabe(traco_t *traco, uint32_t n)
+{
+    if(traco->buffer == NULL || traco->capacidade - traco->tamanho >= TRACO_MAX_CABECALHO + n)
+    {
+        return true;
+    }
+    traco->perdidos++;
+    return false;
+}
+
+/* Grava o tipo e o instante do evento. Um instante anterior ao último evento
+ * é gravado como diferença zero. */
+static void gravaCabecalhoEvento(traco_t *traco, tipoEventoTraco_t tipo, int64_t instante)
+{
+    uint64_t diferenca = (instante > traco->ultimoInstante) ? (uint64_t)(instante - traco->ultimoInstante) : 0;
+
+    gravaByte(traco, (uint8_t)tipo);
+    do
+    {
+        gravaByte(traco, (uint8_t)((diferenca & 0x7F) | ((diferenca > 0x7F) ? 0x80 : 0)));
+        diferenca >>= 7;
+    } while(diferenca > 0);
+
+    if(instante > traco->ultimoInstante)
+    {
+        traco->ultimoInstante = instante;
+    }
+}
+
+bool traco_inicia(traco_t *traco, FILE *arquivo)
+{
+    traco->arquivo = arquivo;
+    traco->ultimoInstante = 0;
+    traco->bytes = 0;
+    traco->buffer = NULL;
+    traco->capacidade = 0;
+    traco->inicio = 0;
+    traco->tamanho = 0;
+    traco->perdidos = 0;
+
+    if(arquivo == NULL || fwrite(assinatura, 1, sizeof(assinatura), arquivo) != sizeof(assinatura))
+    {
+        return false;
+    }
+    traco->bytes = sizeof(assinatura);
+    gravaByte(traco, TRACO_VERSAO);
+    return true;
+}
+
+void traco_gravaAmostras(traco_t *traco, int64_t instante, const uint16_t *amostras, uint32_t n)
+{
+    uint32_t i = 0;
+
+    if(n > TRACO_MAX_AMOSTRAS)
+    {
+        n = TRACO_MAX_AMOSTRAS;
+    }
+    if(!cabe(traco, 1 + (n / 2) * 3 + (n % 2) * 2))
+    {
+        return;
+    }
+    gravaCabecalhoEvento(traco, TRACO_AMOSTRAS, instante);
+    gravaByte(traco, (uint8_t)n);
+    for(i = 0 ; i + 1 < n ; i += 2)
+    {
+        gravaByte(traco, (uint8_t)(amostras[i] & 0xFF));
+        gravaByte(traco, (uint8_t)(((amostras[i] >> 8) & 0x0F) | ((amostras[i + 1] & 0x0F) << 4)));
+        gravaByte(traco, (uint8_t)((amostras[i + 1] >> 4) & 0xFF));
+    }
+    if(i < n)
+    {
+        gravaByte(traco, (uint8_t)(amostras[i] & 0xFF));
+        gravaByte(traco, (uint8_t)((amostras[i] >> 8) & 0x0F));
+    }
+}
+
+void traco_gravaTermopar(traco_t *traco, int64_t instante, uint16_t quadro, bool valido)
+{
+    if(!cabe(traco, 3))
+    {
+        return;
+    }
+    gravaCabecalhoEvento(traco, TRACO_TERMOPAR, instante);
+    gravaByte(traco, (uint8_t)(quadro & 0xFF));
+    gravaByte(traco, (uint8_t)(quadro >> 8));
+    gravaByte(traco, valido ? 1 : 0);
+}
+
+void traco_gravaBotao(traco_t *traco, int64_t instante, botaoTraco_t botao)
+{
+    if(!cabe(traco, 1))
+    {
+        return;
+    }
+    gravaCabecalhoEvento(traco, TRACO_BOTAO, instante);
+    gravaByte(traco, (uint8_t)botao);
+}
+
+void traco_gravaInicio(traco_t *traco, int64_t instante, modo_t modo, ponto_t ponto)
+{
+    if(!cabe(traco, 2))
+    {
+        return;
+    }
+    gravaCabecalhoEvento(traco, TRACO_INICIO, instante);
+    gravaByte(traco, (uint8_t)modo);
+    gravaByte(traco, (uint8_t)ponto);
+}
+
+/* O nível é o aplicado à resistência, depois do escalonador de potência, e
+ * corte indica se o monitor de prazos a mantinha desligada */
+void traco_gravaRele(traco_t *traco, int64_t instante, bool nivel, bool corte)
+{
+    if(!cabe(traco, 1))
+    {
+        return;
+    }
+    gravaCabecalhoEvento(traco, TRACO_RELE, instante);
+    gravaByte(traco, (nivel ? 1 : 0) | (corte ? 2 : 0));
+}
+
+void traco_gravaFim(traco_t *traco, int64_t instante)
+{
+    if(!cabe(traco, 0))
+    {
+        return;
+    }
+    gravaCabecalhoEvento(traco, TRACO_FIM, instante);
+}
+
+void traco_gravaLote(traco_t *traco, int64_t instante, modo_t modo, ponto_t ponto)
+{
+    if(!cabe(traco, 2))
+    {
+        return;
+    }
+    gravaCabecalhoEvento(traco, TRACO_LOTE, instante);
+    gravaByte(traco, (uint8_t)modo);
+    gravaByte(traco, (uint8_t)ponto);
+}
+
+/* Passa a codificar os eventos em buffer, de capacidade bytes, em vez de
+ * escrevê-los no arquivo. Deve ser chamada depois de traco_inicia. */
+void traco_usaBuffer(traco_t *traco, uint8_t *buffer, uint32_t capacidade)
+{
+    traco->buffer = buffer;
+    traco->capacidade = capacidade;
+    traco->inicio = 0;
+    traco->tamanho = 0;
+}
+
+/* Retira até maximo bytes do buffer, na ordem em que foram gravados, e
+ * retorna quantos foram copiados para destino */
+uint32_t traco_retira(traco_t *traco, uint8_t *destino, uint32_t maximo)
+{
+    uint32_t n = 0;
+
+    while(n < maximo && traco->tamanho > 0)
+    {
+        destino[n++] = traco->buffer[traco->inicio];
+        traco->inicio = (traco->inicio + 1) % traco->capacidade;
+        traco->tamanho--;
+    }
+    return n;
+}
+
+/* Guarda os traços anteriores antes de um novo ser criado em caminho: o
+ * arquivo de cada geração passa a ser o da seguinte ("<caminho>.1",
+ * "<caminho>.2", ...), e o mais antigo, o de número geracoes, é apagado.
+ * Assim um reset não apaga o traço do cozimento que acabou de falhar.
+ * Retorna false se caminho continuar existindo. */
+bool traco_rotaciona(const char *caminho, uint32_t geracoes)
+{
+    char origem[64];
+    char destino[64];
+    FILE *arquivo = NULL;
+    uint32_t i = 0;
+
+    for(i = geracoes ; i > 0 ; i--)
+    {
+        if(i > 1)
+        {
+            snprintf(origem, sizeof(origem), "%s.%u", caminho, (unsigned)(i - 1));
+        }
+        else
+        {
+            snprintf(origem, sizeof(origem), "%s", caminho);
+        }
+        snprintf(destino, sizeof(destino), "%s.%u", caminho, (unsigned)i);
+        remove(destino);
+        rename(origem, destino);
+    }
+    if(geracoes == 0)
+    {
+        remove(caminho);
+    }
+
+    arquivo = fopen(caminho, "rb");
+    if(arquivo != NULL)
+    {
+        fclose(arquivo);
+        return false;
+    }
+    return true;
+}
+
+/* Abre um traço para leitura, verificando o cabeçalho */
+bool traco_abre(traco_t *traco, FILE *arquivo)
+{
+    uint8_t cabecalho[sizeof(assinatura) + 1];
+    uint32_t i = 0;
+
+    traco->arquivo = arquivo;
+    traco->ultimoInstante = 0;
+    traco->bytes = 0;
+
+    if(arquivo == NULL || fread(cabecalho, 1, sizeof(cabecalho), arquivo) != sizeof(cabecalho))
+    {
+        return false;
+    }
+    for(i = 0 ; i < sizeof(assinatura) ; i++)
+    {
+        if(cabecalho[i] != assinatura[i])
+        {
+            return false;
+        }
+    }
+    traco->bytes = sizeof(cabecalho);
+    return cabecalho[sizeof(assinatura)] == TRACO_VERSAO;
+}
+
+static bool leByte(traco_t *traco, uint8_t *valor)
+{
+    int c = fgetc(traco->arquivo);
+
+    if(c == EOF)
+    {
+        return false;
+    }
+    traco->bytes++;
+    *valor = (uint8_t)c;
+    return true;
+}
+
+/* Lê o próximo evento do traço. Retorna false no fim do arquivo ou se o
+ * evento estiver incompleto ou for desconhecido. */
+bool traco_leEvento(traco_t *traco, eventoTraco_t *evento)
+{
+    uint8_t byte = 0;
+    uint8_t dados[3];
+    uint64_t diferenca = 0;
+    uint32_t deslocamento = 0;
+    uint32_t i = 0;
+
+    if(!leByte(traco, &byte))
+    {
+        return false;
+    }
+    evento->tipo = (tipoEventoTraco_t)byte;
+
+    do
+    {
+        if(!leByte(traco, &byte) || deslocamento > 63)
+        {
+            return false;
+        }
+        diferenca |= (uint64_t)(byte & 0x7F) << deslocamento;
+        deslocamento += 7;
+    } while(byte & 0x80);
+    traco->ultimoInstante += (int64_t)diferenca;
+    evento->instante = traco->ultimoInstante;
+
+    switch (evento->tipo)
+    {
+    case TRACO_AMOSTRAS:
+        if(!leByte(traco, &byte))
+        {
+            return false;
+        }
+        evento->numeroDeAmostras = byte;
+        for(i = 0 ; i + 1 < evento->numeroDeAmostras ; i += 2)
+        {
+            if(!leByte(traco, &dados[0]) || !leByte(traco, &dados[1]) || !leByte(traco, &dados[2]))
+            {
+                return false;
+            }
+            evento->amostras[i] = dados[0] | ((dados[1] & 0x0F) << 8);
+            evento->amostras[i + 1] = (dados[1] >> 4) | (dados[2] << 4);
+        }
+        if(i < evento->numeroDeAmostras)
+        {
+            if(!leByte(traco, &dados[0]) || !leByte(traco, &dados[1]))
+            {
+                return false;
+            }
+            evento->amostras[i] = dados[0] | ((dados[1] & 0x0F) << 8);
+        }
+        return true;
+    case TRACO_TERMOPAR:
+        if(!leByte(traco, &dados[0]) || !leByte(traco, &dados[1]) || !leByte(traco, &dados[2]))
+        {
+            return false;
+        }
+        evento->quadro = dados[0] | (dados[1] << 8);
+        evento->quadroValido = (dados[2] != 0);
+        return true;
+    case TRACO_BOTAO:
+        if(!leByte(traco, &byte))
+        {
+            return false;
+        }
+        evento->botao = (botaoTraco_t)byte;
+        return true;
+    case TRACO_INICIO:
+        if(!leByte(traco, &dados[0]) || !leByte(traco, &dados[1]))
+        {
+            return false;
+        }
+        evento->modo = (modo_t)dados[0];
+        evento->ponto = (ponto_t)dados[1];
+        return true;
+    case TRACO_RELE:
+        if(!leByte(traco, &byte))
+        {
+            return false;
+        }
+        evento->nivel = (byte & 1) != 0;
+        evento->corte = (byte & 2) != 0;
+        return true;
+    case TRACO_FIM:
+        return true;
+    case TRACO_LOTE:
+        if(!leByte(traco, &dados[0]) || !leByte(traco, &dados[1]))
+        {
+            return false;
+        }
+        evento->modo = (modo_t)dados[0];
+        evento->ponto = (ponto_t)dados[1];
+        return true;
+    default:
+        return false;
+    }
+}
@@ -0,0 +1,165 @@
+#include <string.h>
+#include "indicadoresCozimento.h"
+
+/* Este arquivo calcula os indicadores de qualidade de cada cozimento: o tempo
+ * até o alvo, o sobressinal, o tempo dentro da faixa em torno do alvo, as
+ * comutações da resistência, a energia consumida e a média e a variância da
+ * temperatura. Cada leitura processada pela task OutputControl atualiza os
+ * acumuladores em tempo constante, a partir da estimativa de temperatura e
+ * do nível da resistência que ela já calculou, e nenhuma amostra é guardada.
+ * Ao fim do cozimento os acumuladores viram um registro, guardado em um
+ * histórico circular que pode ser consultado.
+ *
+ * Com a amostragem adaptativa (amostragemAdaptativa.c) as leituras não são
+ * igualmente espaçadas, então cada uma pesa o intervalo desde a anterior. A
+ * média e a variância usam a forma ponderada do algoritmo de Welford (West,
+ * 1979), que não perde precisão como a soma dos quadrados. Elas só contam
+ * depois que a temperatura chega ao alvo, já que antes disso descreveriam o
+ * aquecimento, e não a estabilidade do controle.
+ *
+ * As funções não fazem nenhuma exclusão mútua, que fica a cargo de quem as
+ * chama. */
+
+void indicadores_init(indicadores_t *indicadores)
+{
+    memset(indicadores, 0, sizeof(*indicadores));
+}
+
+/* Zera os acumuladores para um novo cozimento. ligada é o nível atual da
+ * resistência, que pode já estar ligada mantendo a temperatura entre dois
+ * lotes. */
+void indicadores_inicia(indicadores_t *indicadores, modo_t modo, ponto_t ponto, uint32_t temperaturaAlvo,
+                        int64_t agora, bool ligada)
+{
+    memset(&indicadores->atual, 0, sizeof(indicadores->atual));
+    indicadores->atual.modo = modo;
+    indicadores->atual.ponto = ponto;
+    indicadores->atual.temperaturaAlvo = temperaturaAlvo;
+    indicadores->inicio = agora;
+    indicadores->instanteAnterior = agora;
+    indicadores->tempoAteAlvo = -1;
+    indicadores->tempoNaFaixa = 0;
+    indicadores->tempoLigada = 0;
+    indicadores->ligadaAnterior = ligada;
+    indicadores->comutacoes = 0;
+    indicadores->amostras = 0;
+    indicadores->temperaturaMaxima = 0;
+    indicadores->peso = 0;
+    indicadores->media = 0;
+    indicadores->somaQuadrados = 0;
+    indicadores->ativo = true;
+}
+
+/* Incorpora uma leitura: temperatura é a estimativa no instante da leitura,
+ * e ligada o nível que a resistência teve desde a leitura anterior. */
+void indicadores_amostra(indicadores_t *indicadores, int64_t instante, float temperatura, bool ligada)
+{
+    float alvo = (float)indicadores->atual.temperaturaAlvo;
+    int64_t intervalo = instante - indicadores->instanteAnterior;
+    float peso = 0;
+    float desvio = 0;
+
+    if(!indicadores->ativo)
+    {
+        return;
+    }
+    /* Uma leitura feita antes do início do cozimento não tem intervalo */
+    intervalo = (intervalo > 0) ? intervalo : 0;
+    indicadores->instanteAnterior = (instante > indicadores->instanteAnterior) ? instante
+                                                                               : indicadores->instanteAnterior;
+    indicadores->amostras++;
+
+    if(ligada)
+    {
+        indicadores->tempoLigada += intervalo;
+    }
+    if(ligada != indicadores->ligadaAnterior)
+    {
+        indicadores->comutacoes++;
+        indicadores->ligadaAnterior = ligada;
+    }
+    if(temperatura >= alvo - INDICADORES_FAIXA_C && temperatura <= alvo + INDICADORES_FAIXA_C)
+    {
+        indicadores->tempoNaFaixa += intervalo;
+    }
+
+    if(indicadores->tempoAteAlvo < 0)
+    {
+        if(temperatura < alvo)
+        {
+            return;
+        }
+        /* A primeira amostra no alvo só marca o início do regime */
+        indicadores->tempoAteAlvo = instante - indicadores->inicio;
+        indicadores->temperaturaMaxima = temperatura;
+        return;
+    }
+    if(temperatura > indicadores->temperaturaMaxima)
+    {
+        indicadores->temperaturaMaxima = temperatura;
+    }
+
+    /* Welford ponderado: o peso é o intervalo em s */
+    peso = (float)intervalo / 1e6f;
+    if(peso <= 0)
+    {
+        return;
+    }
+    indicadores->peso += peso;
+    desvio = temperatura - indicadores->media;
+    indicadores->media += desvio * peso / indicadores->peso;
+    indicadores->somaQuadrados += peso * desvio * (temperatura - indicadores->media);
+}
+
+/* Preenche registro com os indicadores do cozimento em andamento até agora.
+ * Retorna false se não houver nenhum. */
+bool indicadores_parcial(const indicadores_t *indicadores, int64_t agora, registroIndicadores_t *registro)
+{
+    float alvo = (float)indicadores->atual.temperaturaAlvo;
+
+    if(!indicadores->ativo)
+    {
+        return false;
+    }
+    *registro = indicadores->atual;
+    registro->duracaoMs = (uint32_t)((agora - indicadores->inicio) / 1000);
+    registro->tempoAteAlvoMs = (indicadores->tempoAteAlvo < 0) ? -1 : (int32_t)(indicadores->tempoAteAlvo / 1000);
+    registro->tempoNaFaixaMs = (uint32_t)(indicadores->tempoNaFaixa / 1000);
+    registro->sobressinal = (indicadores->tempoAteAlvo >= 0 && indicadores->temperaturaMaxima > alvo) ?
+                            indicadores->temperaturaMaxima - alvo : 0;
+    registro->comutacoes = indicadores->comutacoes;
+    registro->energiaWh = (float)indicadores->tempoLigada * POTENCIA_RESISTENCIA_W / 3.6e9f;
+    registro->media = indicadores->media;
+    registro->variancia = (indicadores->peso > 0) ? indicadores->somaQuadrados / indicadores->peso : 0;
+    registro->amostras = indicadores->amostras;
+    return true;
+}
+
+/* Encerra o cozimento em andamento e guarda o seu registro no histórico,
+ * sobre o mais antigo se ele estiver cheio. Retorna o registro guardado, ou
+ * NULL se não houver cozimento em andamento. */
+const registroIndicadores_t *indicadores_finaliza(indicadores_t *indicadores, int64_t agora, uint32_t lote)
+{
+    registroIndicadores_t *registro = &indicadores->historico[indicadores->cozimentos % INDICADORES_HISTORICO];
+
+    if(!indicadores_parcial(indicadores, agora, registro))
+    {
+        return NULL;
+    }
+    registro->lote = lote;
+    indicadores->cozimentos++;
+    indicadores->ativo = false;
+    return registro;
+}
+
+/* Copia o registro de um cozimento concluído, do mais recente (indice 0) ao
+ * mais antigo ainda no histórico. Retorna false se ele não existir. */
+bool indicadores_consulta(const indicadores_t *indicadores, uint32_t indice, registroIndicadores_t *registro)
+{
+    if(indice >= indicadores->cozimentos || indice >= INDICADORES_HISTORICO)
+    {
+        return false;
+    }
+    *registro = indicadores->historico[(indicadores->cozimentos - 1 - indice) % INDICADORES_HISTORICO];
+    return true;
+}
@@ -1,9 +1,24 @@
+#include <stdio.h>
 #include "boardconfig.h"
 #include "controleForno.h"
+#include "perfilBoot.h"
+
+/* Task de baixa prioridade que imprime o tempo gasto em cada fase da
+ * inicialização. Ela só executa depois que o forno já está pronto, então
+ * a impressão pela serial não atrasa a inicialização. */
+static void relatorioBoot(void *pvParameter)
+{
+    static char relatorio[PERFIL_BOOT_MAX_FASES * 48 + 48];
+
+    perfilBoot_relatorio(relatorio, sizeof(relatorio));
+    printf("Tempo de inicialização (us):\n%s", relatorio);
+    vTaskDelete(NULL);
+}
 
 void app_main()
 {
-    printf("Inicializando a aplicação... \n");
+    perfilBoot_marca("inicio da app_main");
+    BOOT_BANNER("Inicializando a aplicação... \n");
 
     /* Abaixo são feitas as chamadas para as funções que executarão
      * todo o processo necessário na inicialização do sistema, como
@@ -11,4 +26,8 @@ void app_main()
      * interrupções externas e inicialização das tasks de controle */
     board_init();
     controle_init();
+
+    /* A partir deste ponto o forno já aceita o pressionamento de botões */
+    perfilBoot_marca("pronto");
+    xTaskCreate(&relatorioBoot, "Relatorio boot", 2048, NULL, 0, NULL);
 }
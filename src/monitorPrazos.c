@@ -0,0 +1,137 @@
+#include <stddef.h>
+#include "monitorPrazos.h"
+
+/* Este arquivo acompanha os prazos das tasks periódicas do controle de
+ * temperatura. Cada task chama monitor_cumpre ao terminar um ciclo, o que
+ * registra se o ciclo terminou dentro do prazo e marca o prazo do próximo.
+ * Independente disso, monitor_verifica é chamada periodicamente por um timer
+ * de prioridade maior que a das tasks, e aciona o corte da resistência assim
+ * que algum prazo passa da tolerância sem ser cumprido, mesmo que a task
+ * esteja travada e nunca mais chegue a chamar monitor_cumpre.
+ *
+ * O corte dura até que todas as tasks atrasadas voltem a cumprir um ciclo.
+ * O tempo entre o prazo perdido e o corte é no máximo a tolerância mais o
+ * período de chamada de monitor_verifica. */
+
+void monitor_init(monitorPrazos_t *monitor)
+{
+    monitor->numeroDePrazos = 0;
+    monitor->ativo = false;
+    monitor->corte = false;
+    monitor->cortes = 0;
+    monitor->instanteCorte = 0;
+}
+
+prazo_t *monitor_adiciona(monitorPrazos_t *monitor, const char *nome, int64_t periodo, int64_t tolerancia)
+{
+    prazo_t *prazo = NULL;
+
+    if(monitor->numeroDePrazos >= MONITOR_MAX_PRAZOS)
+    {
+        return NULL;
+    }
+    prazo = &monitor->prazos[monitor->numeroDePrazos++];
+    prazo->nome = nome;
+    prazo->periodo = periodo;
+    prazo->tolerancia = tolerancia;
+    prazo->proximoPrazo = 0;
+    prazo->piorAtraso = 0;
+    prazo->cumpridos = 0;
+    prazo->perdidos = 0;
+    prazo->atrasado = false;
+    return prazo;
+}
+
+/* Passa a cobrar os prazos a partir de agora. As tasks acompanhadas ficam
+ * paradas entre um cozimento e outro, então o monitor só fica ativo durante
+ * o cozimento. O primeiro ciclo de cada task ganha um período extra, pois
+ * ela pode ainda estar esperando o primeiro dado. */
+void monitor_ativa(monitorPrazos_t *monitor, int64_t agora)
+{
+    uint32_t i = 0;
+
+    for(i = 0 ; i < monitor->numeroDePrazos ; i++)
+    {
+        monitor->prazos[i].proximoPrazo = agora + 2 * monitor->prazos[i].periodo;
+        monitor->prazos[i].atrasado = false;
+    }
+    monitor->corte = false;
+    monitor->ativo = true;
+}
+
+void monitor_desativa(monitorPrazos_t *monitor)
+{
+    monitor->ativo = false;
+    monitor->corte = false;
+}
+
+static bool algumAtrasado(const monitorPrazos_t *monitor)
+{
+    uint32_t i = 0;
+
+    for(i = 0 ; i < monitor->numeroDePrazos ; i++)
+    {
+        if(monitor->prazos[i].atrasado)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Registra o fim de um ciclo da task dona do prazo */
+void monitor_cumpre(monitorPrazos_t *monitor, prazo_t *prazo, int64_t agora)
+{
+    int64_t atraso = agora - prazo->proximoPrazo;
+
+    if(!monitor->ativo)
+    {
+        return;
+    }
+    if(atraso > 0)
+    {
+        prazo->perdidos++;
+        if(atraso > prazo->piorAtraso)
+        {
+            prazo->piorAtraso = atraso;
+        }
+    }
+    else
+    {
+        prazo->cumpridos++;
+    }
+    prazo->proximoPrazo = agora + prazo->periodo;
+    prazo->atrasado = false;
+    monitor->corte = algumAtrasado(monitor);
+}
+
+/* Verifica todos os prazos e retorna true se a resistência deve ser desligada */
+bool monitor_verifica(monitorPrazos_t *monitor, int64_t agora)
+{
+    uint32_t i = 0;
+    int64_t atraso = 0;
+
+    if(!monitor->ativo)
+    {
+        return false;
+    }
+    for(i = 0 ; i < monitor->numeroDePrazos ; i++)
+    {
+        atraso = agora - monitor->prazos[i].proximoPrazo;
+        if(atraso > monitor->prazos[i].tolerancia)
+        {
+            monitor->prazos[i].atrasado = true;
+            if(atraso > monitor->prazos[i].piorAtraso)
+            {
+                monitor->prazos[i].piorAtraso = atraso;
+            }
+        }
+    }
+    if(algumAtrasado(monitor) && !monitor->corte)
+    {
+        monitor->corte = true;
+        monitor->cortes++;
+        monitor->instanteCorte = agora;
+    }
+    return monitor->corte;
+}
@@ -0,0 +1,70 @@
+#include "parametrosCozimento.h"
+
+/* Este arquivo reúne as funções que traduzem a escolha do operador e as
+ * leituras do sensor em grandezas usadas no controle do forno. Elas não
+ * dependem do ESP-IDF, então também são compiladas no ambiente native. */
+
+/* O forno deverá atingir uma temperatura de acordo com o modo de funcionamento
+ * escolhido pelo operador (definições de valores no arquivo definitions.h),
+ * desta forma, a função auxiliar getTemperaturaAlvoDoModo foi criada para retornar
+ * o valor definido de temperatura em função do modo passado para ela como parâmetro,
+ * ou seja, ela recebe o modo e retorna um valor de temperatura em graus Celsius. */
+uint32_t getTemperaturaAlvoDoModo(modo_t modo)
+{
+    switch (modo)
+    {
+    case ASSAR:
+        return TEMPERATURA_ASSAR;
+        break;
+    case GRATINAR:
+        return TEMPERATURA_GRATINAR;
+        break;
+    case GRELHAR:
+        return TEMPERATURA_GRELHAR;
+        break;
+    default:
+        return -1;
+        break;
+    }
+}
+
+/* O forno deverá fazer a contagem do tempo de cozimento para controlar o ponto
+ * do alimento que está sendo preparado. Ou seja, o tempo de um cozimento é função
+ * do ponto escolhido pelo operador (definições de valores no arquivo definitions.h),
+ * desta forma, a função auxiliar getTempoDeFuncionamentoDoPonto foi criada para
+ * retornar o valor definido de tempo em função do ponto passado para ela como
+ * parâmetro, ou seja, ela recebe o ponto e retorna um valor de tempo em
+ * mili segundos. */
+uint32_t getTempoDeFuncionamentoDoPonto(ponto_t ponto)
+{
+    switch (ponto)
+    {
+    case MAL_PASSADO:
+        return TEMPO_MAL_PASSADO;
+        break;
+    case AO_PONTO:
+        return TEMPO_AO_PONTO;
+        break;
+    case BEM_PASSADO:
+        return TEMPO_BEM_PASSADO;
+        break;
+    default:
+        return -1;
+        break;
+    }
+}
+
+/* A função converteTemperaturaLm35 faz a conversão do valor digital para graus Celsius.
+ * O sensor apresenta uma tensão saída de 10mV/°C, desta forma descobre-se
+ * o valor de temperatura equivalente da seguinte forma:
+ * 1 - Divida o valor da escala total de tensão (0 a 3.3) pelo 
+ *     número total de níveis possíveis na saída do decimador (2^16) = 3.3/65535
+ * 2 - Multiplique o valor de divisão anterior pelo número da leitura digital
+ *     contido em leitura e terá o valor da tensão lida = (lm35*3.3/65535)
+ * 3 - Para descobrir o valor em grauas celsius, divida o resultado do passo 2
+ *     pelo valor de 10mV, que é a relação entre tensão e temperatura do
+ *     sensor = (lm35*3.3/65535)/0.010 */
+float converteTemperaturaLm35(uint32_t leitura)
+{
+    return ((leitura * 3.3f) / 65535) / 0.010f;
+}
@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include "perfilBoot.h"
+
+/* Este arquivo registra o instante em que cada fase da inicialização termina,
+ * para que se possa medir quanto tempo o forno leva desde o reset até estar
+ * pronto para aceitar o primeiro botão. O registro é só uma escrita em um
+ * vetor estático, e a formatação do relatório fica para depois que o sistema
+ * estiver pronto. Como esse vetor só é escrito pela app_main durante a
+ * inicialização, não é necessária nenhuma proteção de acesso. */
+
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+
+static int64_t perfilBoot_agora()
+{
+    return esp_timer_get_time();
+}
+#else
+#include <time.h>
+
+/* No build para host o relógio é o monotônico do sistema, e o "reset" é o
+ * instante da primeira leitura, a menos que um instante seja simulado */
+static int64_t instanteSimulado = -1;
+
+void perfilBoot_simulaInstante(int64_t instante)
+{
+    instanteSimulado = instante;
+}
+
+static int64_t perfilBoot_agora()
+{
+    static int64_t inicio = -1;
+    struct timespec ts;
+    int64_t agora = 0;
+
+    if(instanteSimulado >= 0)
+    {
+        return instanteSimulado;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    agora = (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    if(inicio < 0)
+    {
+        inicio = agora;
+    }
+    return agora - inicio;
+}
+#endif
+
+static marcaBoot_t marcas[PERFIL_BOOT_MAX_FASES];
+static uint32_t numeroDeMarcas = 0;
+
+void perfilBoot_marca(const char *fase)
+{
+    if(numeroDeMarcas < PERFIL_BOOT_MAX_FASES)
+    {
+        marcas[numeroDeMarcas].fase = fase;
+        marcas[numeroDeMarcas].instante = perfilBoot_agora();
+        numeroDeMarcas++;
+    }
+}
+
+uint32_t perfilBoot_marcas(const marcaBoot_t **vetor)
+{
+    *vetor = marcas;
+    return numeroDeMarcas;
+}
+
+void perfilBoot_limpa()
+{
+    numeroDeMarcas = 0;
+}
+
+/* Escreve em buffer uma tabela com a duração de cada fase e o instante do seu
+ * fim, ambos em microssegundos. A primeira fase é medida a partir do reset.
+ * Retorna o número de caracteres escritos, sem contar o terminador. */
+size_t perfilBoot_relatorio(char *buffer, size_t tamanho)
+{
+    size_t escrito = 0;
+    int64_t anterior = 0;
+    uint32_t i = 0;
+    int n = 0;
+
+    if(tamanho == 0)
+    {
+        return 0;
+    }
+    buffer[0] = '\0';
+
+    n = snprintf(buffer, tamanho, "%-24s %10s %10s\n", "Fase", "Duracao", "Instante");
+    for(i = 0 ; i < numeroDeMarcas && n >= 0 && escrito + n < tamanho ; i++)
+    {
+        escrito += n;
+        n = snprintf(buffer + escrito, tamanho - escrito, "%-24.24s %10lld %10lld\n",
+                     marcas[i].fase,
+                     (long long)(marcas[i].instante - anterior),
+                     (long long)marcas[i].instante);
+        anterior = marcas[i].instante;
+    }
+    if(n >= 0 && escrito + n < tamanho)
+    {
+        escrito += n;
+    }
+    return escrito;
+}
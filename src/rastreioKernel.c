@@ -0,0 +1,183 @@
+#include "rastreioTarefas.h"
+
+/* Este arquivo liga o rastreio das tasks (rastreioTarefas.c) ao FreeRTOS no
+ * ESP32. As funções rastreio_hook* são chamadas pelas macros de rastreio do
+ * kernel (rastreioHooks.h), nas duas CPUs e também de dentro de interrupções,
+ * então os eventos são registrados em uma seção crítica curta e sem nenhuma
+ * formatação. Uma task de baixa prioridade retira os eventos a cada
+ * RASTREIO_PERIODO_MS e os transmite em JSON pela RASTREIO_UART, e o que for
+ * recebido do outro lado pode ser aberto diretamente em chrome://tracing ou
+ * no Perfetto, mesmo sem o "]" final.
+ *
+ * Somente existe no ambiente rastreio do platformio.ini, que define
+ * RASTREIO_TAREFAS. */
+#ifdef RASTREIO_TAREFAS
+
+#include "definitions.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/uart.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#ifdef DEBUG
+#include "esp_log.h"
+#endif
+
+static eventoRastreio_t eventos[RASTREIO_EVENTOS];
+static rastreio_t rastreio;
+static portMUX_TYPE rastreioMux = portMUX_INITIALIZER_UNLOCKED;
+/* As macros executam desde o boot, mas só registram depois de rastreio_inicia */
+static volatile bool rastreioAtivo = false;
+
+static IRAM_ATTR int64_t rastreioAgora()
+{
+    return esp_timer_get_time() * 1000;
+}
+
+IRAM_ATTR void rastreio_hookTroca(void *tarefa, int entra)
+{
+    int64_t instante = 0;
+    uint8_t indice = 0;
+
+    if(!rastreioAtivo)
+    {
+        return;
+    }
+    instante = rastreioAgora();
+    portENTER_CRITICAL_ISR(&rastreioMux);
+    indice = rastreio_tarefa(&rastreio, tarefa, pcTaskGetTaskName(tarefa), instante);
+    rastreio_registra(&rastreio, instante, entra ? RASTREIO_ENTRA : RASTREIO_SAI, xPortGetCoreID(), indice, 0);
+    portEXIT_CRITICAL_ISR(&rastreioMux);
+}
+
+/* Somente as filas nomeadas por rastreio_nomeiaObjeto são registradas */
+IRAM_ATTR void rastreio_hookFila(void *fila, int envia)
+{
+    TaskHandle_t atual = NULL;
+    int64_t instante = 0;
+    uint8_t objeto = 0;
+    uint8_t indice = 0;
+
+    if(!rastreioAtivo)
+    {
+        return;
+    }
+    instante = rastreioAgora();
+    atual = xTaskGetCurrentTaskHandle();
+    portENTER_CRITICAL_ISR(&rastreioMux);
+    objeto = rastreio_procuraObjeto(&rastreio, fila);
+    if(objeto != RASTREIO_SEM_NOME)
+    {
+        indice = rastreio_tarefa(&rastreio, atual, pcTaskGetTaskName(atual), instante);
+        rastreio_registra(&rastreio, instante, envia ? RASTREIO_FILA_ENVIA : RASTREIO_FILA_RECEBE,
+                          xPortGetCoreID(), indice, objeto);
+    }
+    portEXIT_CRITICAL_ISR(&rastreioMux);
+}
+
+IRAM_ATTR void rastreio_hookNotifica(void *tarefa)
+{
+    TaskHandle_t atual = NULL;
+    int64_t instante = 0;
+    uint8_t destino = 0;
+    uint8_t indice = 0;
+
+    if(!rastreioAtivo)
+    {
+        return;
+    }
+    instante = rastreioAgora();
+    atual = xTaskGetCurrentTaskHandle();
+    portENTER_CRITICAL_ISR(&rastreioMux);
+    destino = rastreio_tarefa(&rastreio, tarefa, pcTaskGetTaskName(tarefa), instante);
+    indice = rastreio_tarefa(&rastreio, atual, pcTaskGetTaskName(atual), instante);
+    rastreio_registra(&rastreio, instante, RASTREIO_NOTIFICA, xPortGetCoreID(), indice, destino);
+    portEXIT_CRITICAL_ISR(&rastreioMux);
+}
+
+/* Os timers do forno são do esp_timer, e não do FreeRTOS, então o disparo é
+ * registrado pelos próprios callbacks (controleForno.c) */
+void rastreio_timer(const void *timer)
+{
+    TaskHandle_t atual = xTaskGetCurrentTaskHandle();
+    int64_t instante = rastreioAgora();
+    uint8_t objeto = 0;
+    uint8_t indice = 0;
+
+    portENTER_CRITICAL(&rastreioMux);
+    objeto = rastreio_procuraObjeto(&rastreio, timer);
+    if(rastreioAtivo && objeto != RASTREIO_SEM_NOME)
+    {
+        indice = rastreio_tarefa(&rastreio, atual, pcTaskGetTaskName(atual), instante);
+        rastreio_registra(&rastreio, instante, RASTREIO_TIMER, xPortGetCoreID(), indice, objeto);
+    }
+    portEXIT_CRITICAL(&rastreioMux);
+}
+
+void rastreio_nomeiaObjeto(const void *identificador, const char *nome)
+{
+    portENTER_CRITICAL(&rastreioMux);
+    rastreio_objeto(&rastreio, identificador, nome);
+    portEXIT_CRITICAL(&rastreioMux);
+}
+
+static void transmiteRastreio(void *pvParameter)
+{
+    char texto[RASTREIO_TAMANHO_TEXTO];
+    eventoRastreio_t evento;
+    uint32_t perdidos = 0;
+    bool retirado = false;
+
+    uart_write_bytes(RASTREIO_UART, texto, rastreio_formataCabecalho(texto, sizeof(texto)));
+    while(1)
+    {
+        vTaskDelay(pdMS_TO_TICKS(RASTREIO_PERIODO_MS));
+        do
+        {
+            portENTER_CRITICAL(&rastreioMux);
+            retirado = rastreio_retira(&rastreio, &evento);
+            portEXIT_CRITICAL(&rastreioMux);
+            if(retirado)
+            {
+                uart_write_bytes(RASTREIO_UART, texto, rastreio_formata(&rastreio, &evento, texto, sizeof(texto)));
+            }
+        } while(retirado);
+
+        if(rastreio.perdidos != perdidos)
+        {
+            perdidos = rastreio.perdidos;
+            #ifdef DEBUG
+                ESP_LOGW("rastreio", "%u eventos perdidos", perdidos);
+            #endif
+        }
+    }
+}
+
+/* Configura a UART do rastreio e começa a registrar. Deve ser chamada antes
+ * da criação das tasks, para que todas apareçam desde o início. */
+void rastreio_inicia()
+{
+    const uart_config_t configuracao = {
+        .baud_rate = RASTREIO_BAUDS,
+        .data_bits = UART_DATA_8_BITS,
+        .parity = UART_PARITY_DISABLE,
+        .stop_bits = UART_STOP_BITS_1,
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+    };
+
+    rastreio_init(&rastreio, eventos, RASTREIO_EVENTOS);
+    if(uart_param_config(RASTREIO_UART, &configuracao) != ESP_OK ||
+       uart_set_pin(RASTREIO_UART, RASTREIO_PINO_TX, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE,
+                    UART_PIN_NO_CHANGE) != ESP_OK ||
+       uart_driver_install(RASTREIO_UART, 256, RASTREIO_BUFFER_UART, 0, NULL, 0) != ESP_OK)
+    {
+        #ifdef DEBUG
+            ESP_LOGE("rastreio", "Erro na configuração da UART do rastreio");
+        #endif
+        return;
+    }
+    xTaskCreate(&transmiteRastreio, "Rastreio", 3072, NULL, 0, NULL);
+    rastreioAtivo = true;
+}
+
+#endif /* RASTREIO_TAREFAS */
@@ -0,0 +1,205 @@
+#include <stddef.h>
+#include "rastreioTarefas.h"
+
+/* Este arquivo guarda um rastreio da execução das tasks: quando cada task
+ * entra e sai do processador, os elementos enviados e recebidos pelas filas,
+ * as notificações e os disparos dos timers. No ESP32 os eventos vêm das macros
+ * de rastreio do próprio FreeRTOS (rastreioHooks.h e rastreioKernel.c), e no
+ * host do forno simulado. O rastreio é exportado no formato de eventos do
+ * Chrome (Trace Event Format, em JSON), que pode ser aberto em
+ * chrome://tracing ou no Perfetto, com uma linha do tempo para cada task.
+ *
+ * As funções não fazem nenhuma exclusão mútua, que fica a cargo de quem as
+ * chama. As que são chamadas pelas macros do kernel ficam na IRAM. */
+
+#ifdef ESP_PLATFORM
+#include "esp_attr.h"
+#else
+#define IRAM_ATTR
+#endif
+
+void rastreio_init(rastreio_t *rastreio, eventoRastreio_t *eventos, uint32_t capacidade)
+{
+    rastreio->eventos = eventos;
+    rastreio->capacidade = capacidade;
+    rastreio->inicio = 0;
+    rastreio->tamanho = 0;
+    rastreio->perdidos = 0;
+    rastreio->numeroDeTarefas = 0;
+    rastreio->numeroDeObjetos = 0;
+}
+
+static IRAM_ATTR uint8_t procura(const nomeRastreio_t *nomes, uint32_t numeroDeNomes, const void *identificador)
+{
+    uint32_t i = 0;
+
+    for(i = 0 ; i < numeroDeNomes ; i++)
+    {
+        if(nomes[i].identificador == identificador)
+        {
+            return (uint8_t)i;
+        }
+    }
+    return RASTREIO_SEM_NOME;
+}
+
+/* Retorna o índice de uma task, registrando-a na primeira vez que ela
+ * aparece. O nome da task vai para o rastreio em um evento
+ * RASTREIO_NOME_TAREFA, para que um rastreio transmitido aos poucos
+ * também contenha os nomes. */
+IRAM_ATTR uint8_t rastreio_tarefa(rastreio_t *rastreio, const void *identificador, const char *nome,
+                                  int64_t instante)
+{
+    uint8_t tarefa = procura(rastreio->tarefas, rastreio->numeroDeTarefas, identificador);
+
+    if(tarefa != RASTREIO_SEM_NOME || rastreio->numeroDeTarefas == RASTREIO_MAX_NOMES)
+    {
+        return tarefa;
+    }
+    tarefa = (uint8_t)rastreio->numeroDeTarefas;
+    rastreio->tarefas[tarefa].identificador = identificador;
+    rastreio->tarefas[tarefa].nome = nome;
+    rastreio->numeroDeTarefas++;
+    rastreio_registra(rastreio, instante, RASTREIO_NOME_TAREFA, 0, tarefa, 0);
+    return tarefa;
+}
+
+/* Dá nome a uma fila ou timer. Somente os objetos com nome são rastreados,
+ * já que o próprio ESP-IDF usa filas e semáforos internamente. */
+uint8_t rastreio_objeto(rastreio_t *rastreio, const void *identificador, const char *nome)
+{
+    uint8_t objeto = procura(rastreio->objetos, rastreio->numeroDeObjetos, identificador);
+
+    if(objeto != RASTREIO_SEM_NOME || rastreio->numeroDeObjetos == RASTREIO_MAX_NOMES)
+    {
+        return objeto;
+    }
+    objeto = (uint8_t)rastreio->numeroDeObjetos;
+    rastreio->objetos[objeto].identificador = identificador;
+    rastreio->objetos[objeto].nome = nome;
+    rastreio->numeroDeObjetos++;
+    return objeto;
+}
+
+IRAM_ATTR uint8_t rastreio_procuraObjeto(const rastreio_t *rastreio, const void *identificador)
+{
+    return procura(rastreio->objetos, rastreio->numeroDeObjetos, identificador);
+}
+
+IRAM_ATTR void rastreio_registra(rastreio_t *rastreio, int64_t instante, tipoRastreio_t tipo, uint8_t nucleo,
+                                 uint8_t tarefa, uint8_t objeto)
+{
+    eventoRastreio_t *evento = NULL;
+
+    if(rastreio->tamanho == rastreio->capacidade)
+    {
+        rastreio->perdidos++;
+        return;
+    }
+    evento = &rastreio->eventos[(rastreio->inicio + rastreio->tamanho) % rastreio->capacidade];
+    evento->instante = instante;
+    evento->tipo = (uint8_t)tipo;
+    evento->nucleo = nucleo;
+    evento->tarefa = tarefa;
+    evento->objeto = objeto;
+    rastreio->tamanho++;
+}
+
+/* Retira o evento mais antigo. Retorna false se não houver nenhum. */
+bool rastreio_retira(rastreio_t *rastreio, eventoRastreio_t *evento)
+{
+    if(rastreio->tamanho == 0)
+    {
+        return false;
+    }
+    *evento = rastreio->eventos[rastreio->inicio];
+    rastreio->inicio = (rastreio->inicio + 1) % rastreio->capacidade;
+    rastreio->tamanho--;
+    return true;
+}
+
+static const char *nomeDe(const nomeRastreio_t *nomes, uint32_t numeroDeNomes, uint8_t indice)
+{
+    return (indice < numeroDeNomes && nomes[indice].nome != NULL) ? nomes[indice].nome : "?";
+}
+
+/* Início do JSON: um vetor de eventos que começa com o nome do processo. Os
+ * eventos formatados por rastreio_formata começam com uma vírgula, e o "]" do
+ * fim pode faltar, como em um rastreio transmitido que foi interrompido. */
+uint32_t rastreio_formataCabecalho(char *texto, uint32_t tamanho)
+{
+    int n = snprintf(texto, tamanho, "[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"forno\"}}");
+
+    return (n < 0) ? 0 : ((uint32_t)n < tamanho ? (uint32_t)n : tamanho - 1);
+}
+
+/* Formata um evento em JSON. Cada task é uma thread do processo 1, e o tempo
+ * é dado em us com três casas decimais. Retorna o número de caracteres. */
+uint32_t rastreio_formata(const rastreio_t *rastreio, const eventoRastreio_t *evento, char *texto,
+                          uint32_t tamanho)
+{
+    const char *tarefa = nomeDe(rastreio->tarefas, rastreio->numeroDeTarefas, evento->tarefa);
+    const char *objeto = nomeDe(rastreio->objetos, rastreio->numeroDeObjetos, evento->objeto);
+    long long us = (long long)(evento->instante / 1000);
+    int fracao = (int)(evento->instante % 1000);
+    int n = 0;
+
+    switch (evento->tipo)
+    {
+    case RASTREIO_NOME_TAREFA:
+        n = snprintf(texto, tamanho, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                     "\"args\":{\"name\":\"%s\"}}", evento->tarefa, tarefa);
+        break;
+    case RASTREIO_ENTRA:
+        n = snprintf(texto, tamanho, ",\n{\"name\":\"%s\",\"ph\":\"B\",\"ts\":%lld.%03d,\"pid\":1,\"tid\":%u,"
+                     "\"args\":{\"nucleo\":%u}}", tarefa, us, fracao, evento->tarefa, evento->nucleo);
+        break;
+    case RASTREIO_SAI:
+        n = snprintf(texto, tamanho, ",\n{\"ph\":\"E\",\"ts\":%lld.%03d,\"pid\":1,\"tid\":%u}",
+                     us, fracao, evento->tarefa);
+        break;
+    case RASTREIO_FILA_ENVIA:
+    case RASTREIO_FILA_RECEBE:
+        n = snprintf(texto, tamanho, ",\n{\"name\":\"%s %s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%lld.%03d,"
+                     "\"pid\":1,\"tid\":%u}", (evento->tipo == RASTREIO_FILA_ENVIA) ? "envia" : "recebe",
+                     objeto, us, fracao, evento->tarefa);
+        break;
+    case RASTREIO_NOTIFICA:
+        n = snprintf(texto, tamanho, ",\n{\"name\":\"notifica %s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%lld.%03d,"
+                     "\"pid\":1,\"tid\":%u}", nomeDe(rastreio->tarefas, rastreio->numeroDeTarefas, evento->objeto),
+                     us, fracao, evento->tarefa);
+        break;
+    case RASTREIO_TIMER:
+        n = snprintf(texto, tamanho, ",\n{\"name\":\"timer %s\",\"ph\":\"i\",\"s\":\"p\",\"ts\":%lld.%03d,"
+                     "\"pid\":1,\"tid\":%u}", objeto, us, fracao, evento->tarefa);
+        break;
+    default:
+        n = 0;
+        break;
+    }
+    return (n < 0) ? 0 : ((uint32_t)n < tamanho ? (uint32_t)n : tamanho - 1);
+}
+
+/* Retira todos os eventos do rastreio e grava um JSON completo em arquivo.
+ * Retorna false se houver um erro de escrita. */
+bool rastreio_exporta(rastreio_t *rastreio, FILE *arquivo)
+{
+    char texto[RASTREIO_TAMANHO_TEXTO];
+    eventoRastreio_t evento;
+    uint32_t n = 0;
+
+    n = rastreio_formataCabecalho(texto, sizeof(texto));
+    if(fwrite(texto, 1, n, arquivo) != n)
+    {
+        return false;
+    }
+    while(rastreio_retira(rastreio, &evento))
+    {
+        n = rastreio_formata(rastreio, &evento, texto, sizeof(texto));
+        if(fwrite(texto, 1, n, arquivo) != n)
+        {
+            return false;
+        }
+    }
+    return fputs("\n]\n", arquivo) >= 0;
+}
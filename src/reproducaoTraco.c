@@ -0,0 +1,379 @@
+#include <stdlib.h>
+#include "reproducaoTraco.h"
+
+/* Este arquivo reproduz um traço gravado (gravacaoTraco.c) através de uma
+ * versão do controlador, tão rápido quanto o host permitir, e compara o
+ * resultado de duas versões sobre a mesma entrada.
+ *
+ * A reprodução usa um forno_t (forno.c), como o firmware (controleForno.c):
+ * os botões, a porta, os lotes da serial e o fim de cada cozimento são
+ * aplicados ao forno na ordem do traço, então a temperatura alvo, o
+ * preaquecimento entre lotes e as pausas são os mesmos da gravação. As
+ * leituras dos sensores vêm dos eventos do traço pelo halForno_t, e cada uma
+ * espera, como na adc_queue, pela decisão gravada pela task OutputControl. É
+ * nesse momento que a versão a reproduz, com o corte do monitor de prazos
+ * gravado, e o escalonador de potência decide o nível aplicado. Assim as
+ * decisões de versões diferentes ficam alinhadas uma a uma, e cada uma pode
+ * ser comparada com a gravada. */
+
+static int64_t reproduzidoAgora(void *contexto)
+{
+    return ((fornoReproduzido_t *)contexto)->agora;
+}
+
+/* A rajada do traço tem NUMBER_OF_SAMPLES amostras, a menos que tenha sido
+ * gravada com outra decimação, e nesse caso a última é repetida */
+static void reproduzidoLeAdc(void *contexto, uint16_t *amostras, uint32_t n)
+{
+    const eventoTraco_t *rajada = ((fornoReproduzido_t *)contexto)->amostras;
+    uint32_t i = 0;
+
+    for(i = 0 ; i < n ; i++)
+    {
+        if(i < rajada->numeroDeAmostras)
+        {
+            amostras[i] = rajada->amostras[i];
+        }
+        else
+        {
+            amostras[i] = (i > 0) ? amostras[i - 1] : 0;
+        }
+    }
+}
+
+/* Sem o quadro no traço, por exemplo perdido com o buffer cheio, o termopar
+ * é tratado como inválido */
+static bool reproduzidoLeTermopar(void *contexto, uint16_t *quadro)
+{
+    const eventoTraco_t *termopar = ((fornoReproduzido_t *)contexto)->termopar;
+
+    if(termopar == NULL)
+    {
+        *quadro = 0;
+        return false;
+    }
+    *quadro = termopar->quadro;
+    return termopar->quadroValido;
+}
+
+static void reproduzidoResistencia(void *contexto, bool nivel)
+{
+    fornoReproduzido_t *reproduzido = (fornoReproduzido_t *)contexto;
+
+    escalonador_pede(&reproduzido->escalonador, reproduzido->saidaResistencia, nivel);
+}
+
+static void reproduzidoLedsModo(void *contexto, modo_t modo)
+{
+}
+
+static void reproduzidoLedsPonto(void *contexto, ponto_t ponto)
+{
+}
+
+static void iniciaReproduzido(fornoReproduzido_t *reproduzido)
+{
+    halForno_t hal = {reproduzido, reproduzidoAgora, reproduzidoLeAdc, reproduzidoLeTermopar,
+                      reproduzidoResistencia, reproduzidoLedsModo, reproduzidoLedsPonto};
+
+    escalonador_init(&reproduzido->escalonador, ORCAMENTO_POTENCIA_W, ESCALONADOR_LIGAMENTOS_SLOT,
+                     ESCALONADOR_TEMPO_MINIMO_MS);
+    reproduzido->saidaResistencia = (uint32_t)escalonador_adicionaSaida(&reproduzido->escalonador, "resistencia",
+                                                                        POTENCIA_RESISTENCIA_W);
+    reproduzido->agora = 0;
+    reproduzido->amostras = NULL;
+    reproduzido->termopar = NULL;
+    reproduzido->inicio = 0;
+    reproduzido->pendentes = 0;
+    forno_init(&reproduzido->forno, &hal);
+}
+
+/* Versão atual do controlador: a própria forno_controla do firmware */
+static void atualControla(void *estado, forno_t *forno, const leitura_t *leitura, bool corte)
+{
+    forno_controla(forno, leitura, corte);
+}
+
+void reproducao_versaoAtual(versaoControlador_t *versao)
+{
+    versao->nome = "atual";
+    versao->estado = NULL;
+    versao->inicia = NULL;
+    versao->controla = atualControla;
+}
+
+static bool adicionaDecisao(reproducao_t *resultado, const decisaoReproducao_t *decisao)
+{
+    decisaoReproducao_t *decisoes = NULL;
+
+    if(resultado->numeroDeDecisoes == resultado->capacidade)
+    {
+        decisoes = realloc(resultado->decisoes,
+                           sizeof(decisaoReproducao_t) * (resultado->capacidade ? resultado->capacidade * 2 : 1024));
+        if(decisoes == NULL)
+        {
+            return false;
+        }
+        resultado->decisoes = decisoes;
+        resultado->capacidade = resultado->capacidade ? resultado->capacidade * 2 : 1024;
+    }
+    resultado->decisoes[resultado->numeroDeDecisoes++] = *decisao;
+    return true;
+}
+
+/* Trabalho da task OutputControl para a leitura mais antiga à espera: a
+ * versão decide, o escalonador aplica o pedido e o nível aplicado é
+ * confirmado ao forno. rele é a decisão gravada pelo firmware para esta
+ * leitura, ou NULL se ela não estiver no traço. */
+static bool decide(fornoReproduzido_t *reproduzido, versaoControlador_t *versao, const eventoTraco_t *rele,
+                   reproducao_t *resultado)
+{
+    const leitura_t *leitura = &reproduzido->leituras[reproduzido->inicio];
+    decisaoReproducao_t decisao;
+
+    versao->controla(versao->estado, &reproduzido->forno, leitura, (rele != NULL) && rele->corte);
+    escalonador_executa(&reproduzido->escalonador, forno_periodoLeituraMs(&reproduzido->forno));
+    decisao.rele = escalonador_ligada(&reproduzido->escalonador, reproduzido->saidaResistencia);
+    forno_confirmaResistencia(&reproduzido->forno, decisao.rele);
+
+    decisao.instante = leitura->instante;
+    decisao.temperatura = reproduzido->forno.controle.temperaturaAtual;
+    decisao.releGravado = (rele != NULL) && rele->nivel;
+    decisao.temReleGravado = (rele != NULL);
+    reproduzido->inicio = (reproduzido->inicio + 1) % TAMANHO_FILA_ADC;
+    reproduzido->pendentes--;
+    return adicionaDecisao(resultado, &decisao);
+}
+
+/* O início gravado confirma o cozimento começado pelo botão start ou pela
+ * porta. Se o forno reproduzido não o tiver começado, como com um cozimento
+ * restaurado da flash antes do início do traço, ele começa aqui. */
+static void sincronizaInicio(forno_t *forno, const eventoTraco_t *evento)
+{
+    if(forno->status == ACAO_INICIADA)
+    {
+        return;
+    }
+    if(forno->fila.tamanho == 0)
+    {
+        forno_adicionaLote(forno, evento->modo, evento->ponto);
+    }
+    forno->carregado = true;
+    forno_iniciaProximo(forno);
+}
+
+static void aplicaBotao(forno_t *forno, botaoTraco_t botao)
+{
+    switch (botao)
+    {
+    case BOTAO_MODO:
+        forno_selecionaModo(forno);
+        break;
+    case BOTAO_PONTO:
+        forno_selecionaPonto(forno);
+        break;
+    case BOTAO_START:
+        forno_inicia(forno);
+        break;
+    case BOTAO_PORTA_ABERTA:
+    case BOTAO_PORTA_FECHADA:
+        forno_porta(forno, botao == BOTAO_PORTA_ABERTA);
+        forno_iniciaProximo(forno);
+        break;
+    default:
+        break;
+    }
+}
+
+/* Reproduz o traço contido em arquivo, do início, através da versão dada.
+ * Retorna false se o traço for inválido ou se faltar memória. */
+bool reproducao_executa(FILE *arquivo, versaoControlador_t *versao, reproducao_t *resultado)
+{
+    static eventoTraco_t eventos[2];
+    static fornoReproduzido_t reproduzido;
+    eventoTraco_t *evento = &eventos[0];
+    eventoTraco_t *seguinte = &eventos[1];
+    eventoTraco_t *troca = NULL;
+    leitura_t leitura;
+    traco_t traco;
+    bool temSeguinte = false;
+
+    resultado->decisoes = NULL;
+    resultado->numeroDeDecisoes = 0;
+    resultado->capacidade = 0;
+    resultado->duracaoTraco = 0;
+
+    if(!traco_abre(&traco, arquivo))
+    {
+        return false;
+    }
+    iniciaReproduzido(&reproduzido);
+    if(versao->inicia != NULL)
+    {
+        versao->inicia(versao->estado);
+    }
+
+    while(temSeguinte || traco_leEvento(&traco, evento))
+    {
+        if(temSeguinte)
+        {
+            troca = evento;
+            evento = seguinte;
+            seguinte = troca;
+            temSeguinte = false;
+        }
+        resultado->duracaoTraco = evento->instante;
+        reproduzido.agora = evento->instante;
+
+        switch (evento->tipo)
+        {
+        case TRACO_AMOSTRAS:
+            /* O quadro do termopar é gravado logo depois da rajada que
+             * completou uma saída do decimador, durante forno_leSensores */
+            temSeguinte = traco_leEvento(&traco, seguinte);
+            reproduzido.amostras = evento;
+            reproduzido.termopar = (temSeguinte && seguinte->tipo == TRACO_TERMOPAR) ? seguinte : NULL;
+            if(reproduzido.termopar != NULL)
+            {
+                temSeguinte = false;
+            }
+            if(!forno_leSensores(&reproduzido.forno, &leitura))
+            {
+                break;
+            }
+            /* Com a fila cheia a leitura mais antiga é decidida sem a
+             * decisão gravada, que deve ter sido perdida */
+            if(reproduzido.pendentes == TAMANHO_FILA_ADC && !decide(&reproduzido, versao, NULL, resultado))
+            {
+                return false;
+            }
+            reproduzido.leituras[(reproduzido.inicio + reproduzido.pendentes) % TAMANHO_FILA_ADC] = leitura;
+            reproduzido.pendentes++;
+            break;
+        case TRACO_RELE:
+            if(reproduzido.pendentes > 0 && !decide(&reproduzido, versao, evento, resultado))
+            {
+                return false;
+            }
+            break;
+        case TRACO_BOTAO:
+            aplicaBotao(&reproduzido.forno, evento->botao);
+            break;
+        case TRACO_LOTE:
+            forno_adicionaLote(&reproduzido.forno, evento->modo, evento->ponto);
+            break;
+        case TRACO_INICIO:
+            sincronizaInicio(&reproduzido.forno, evento);
+            break;
+        case TRACO_FIM:
+            /* O fim gravado vale sobre o tempo da sessão reproduzida, que não
+             * conhece as extensões pedidas pela serial */
+            forno_estende(&reproduzido.forno, -forno_restante(&reproduzido.forno));
+            forno_verificaFim(&reproduzido.forno);
+            break;
+        default:
+            break;
+        }
+    }
+
+    /* As leituras que ficaram na fila no fim do traço não têm decisão gravada */
+    while(reproduzido.pendentes > 0)
+    {
+        if(!decide(&reproduzido, versao, NULL, resultado))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void reproducao_libera(reproducao_t *resultado)
+{
+    free(resultado->decisoes);
+    resultado->decisoes = NULL;
+    resultado->numeroDeDecisoes = 0;
+    resultado->capacidade = 0;
+}
+
+static uint32_t contaDiferentesDoGravado(const reproducao_t *resultado)
+{
+    uint32_t diferentes = 0;
+    uint32_t i = 0;
+
+    for(i = 0 ; i < resultado->numeroDeDecisoes ; i++)
+    {
+        if(resultado->decisoes[i].temReleGravado &&
+           resultado->decisoes[i].rele != resultado->decisoes[i].releGravado)
+        {
+            diferentes++;
+        }
+    }
+    return diferentes;
+}
+
+static uint32_t contaChaveamentos(const reproducao_t *resultado)
+{
+    uint32_t chaveamentos = 0;
+    uint32_t i = 0;
+
+    for(i = 1 ; i < resultado->numeroDeDecisoes ; i++)
+    {
+        if(resultado->decisoes[i].rele != resultado->decisoes[i - 1].rele)
+        {
+            chaveamentos++;
+        }
+    }
+    return chaveamentos;
+}
+
+/* Compara as decisões de duas reproduções do mesmo traço */
+void reproducao_compara(const reproducao_t *a, const reproducao_t *b, diferencaReproducao_t *diferenca)
+{
+    float delta = 0;
+    float soma = 0;
+    uint32_t i = 0;
+
+    diferenca->leituras = (a->numeroDeDecisoes < b->numeroDeDecisoes) ? a->numeroDeDecisoes : b->numeroDeDecisoes;
+    diferenca->releDiferente = 0;
+    diferenca->primeiraDiferenca = -1;
+    diferenca->maiorDiferencaTemperatura = 0;
+
+    for(i = 0 ; i < diferenca->leituras ; i++)
+    {
+        if(a->decisoes[i].rele != b->decisoes[i].rele)
+        {
+            if(diferenca->releDiferente == 0)
+            {
+                diferenca->primeiraDiferenca = a->decisoes[i].instante;
+            }
+            diferenca->releDiferente++;
+        }
+        delta = a->decisoes[i].temperatura - b->decisoes[i].temperatura;
+        delta = (delta < 0) ? -delta : delta;
+        soma += delta;
+        if(delta > diferenca->maiorDiferencaTemperatura)
+        {
+            diferenca->maiorDiferencaTemperatura = delta;
+        }
+    }
+    diferenca->mediaDiferencaTemperatura = diferenca->leituras ? soma / diferenca->leituras : 0;
+    diferenca->chaveamentos[0] = contaChaveamentos(a);
+    diferenca->chaveamentos[1] = contaChaveamentos(b);
+    diferenca->diferentesDoGravado[0] = contaDiferentesDoGravado(a);
+    diferenca->diferentesDoGravado[1] = contaDiferentesDoGravado(b);
+}
+
+void reproducao_relatorio(FILE *saida, const char *nomeA, const char *nomeB,
+                          const diferencaReproducao_t *diferenca)
+{
+    fprintf(saida, "Comparacao %s x %s\n", nomeA, nomeB);
+    fprintf(saida, "  leituras comparadas:            %u\n", diferenca->leituras);
+    fprintf(saida, "  decisoes do rele diferentes:    %u\n", diferenca->releDiferente);
+    fprintf(saida, "  primeira diferenca (us):        %lld\n", (long long)diferenca->primeiraDiferenca);
+    fprintf(saida, "  maior diferenca de temperatura: %.3f C\n", diferenca->maiorDiferencaTemperatura);
+    fprintf(saida, "  media da diferenca:             %.3f C\n", diferenca->mediaDiferencaTemperatura);
+    fprintf(saida, "  chaveamentos do rele:           %u x %u\n",
+            diferenca->chaveamentos[0], diferenca->chaveamentos[1]);
+    fprintf(saida, "  diferentes do gravado:          %u x %u\n",
+            diferenca->diferentesDoGravado[0], diferenca->diferentesDoGravado[1]);
+}
@@ -0,0 +1,355 @@
+#include <stddef.h>
+#include <string.h>
+#include "salvamentoCozimento.h"
+#include "sessaoCozimento.h"
+
+/* Este arquivo salva o estado do cozimento em andamento para que ele seja
+ * retomado depois de uma queda de energia ou de um reset (controle_init).
+ *
+ * O registro é gravado a cada SALVAMENTO_PERIODO_MS na memória RTC, que não é
+ * apagada por resets nem por quedas rápidas de tensão, e custa apenas uma
+ * cópia de memória. As gravações alternam entre duas cópias, então uma
+ * gravação interrompida no meio estraga somente a cópia que estava sendo
+ * gravada, o que o crc detecta, e a outra continua válida.
+ *
+ * Uma queda mais longa apaga a memória RTC, então o registro também é gravado
+ * na flash, mas somente quando o estado do forno muda (status, modo, ponto,
+ * fila, sessão) e, enquanto um lote está sendo cozido, a cada
+ * SALVAMENTO_PERIODO_FLASH_MS. Parado, pausado ou entre lotes, o tempo
+ * decorrido não muda, e nada é gravado. Na flash há um único registro, em uma
+ * chave da NVS: a NVS já distribui o desgaste pelas suas páginas, e uma
+ * gravação interrompida mantém o valor anterior da chave.
+ *
+ * Na recuperação vale o registro válido de maior sequência entre as duas
+ * memórias. O tempo em que o forno ficou desligado é desconhecido, então o
+ * cozimento continua do tempo decorrido no último registro: no máximo um
+ * intervalo entre gravações é cozido duas vezes, e nada é perdido. */
+
+#ifdef ESP_PLATFORM
+
+#include <stdio.h>
+#include "esp_attr.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+
+/* Memória RTC lenta, que o ESP-IDF não inicializa no boot */
+static RTC_NOINIT_ATTR registroCozimento_t rtc[SALVAMENTO_COPIAS_RTC];
+static nvs_handle flash;
+static bool flashAberta;
+
+/* A flash é acessada pela NVS, no namespace "salvamento", na chave
+ * "registro" */
+static void iniciaMemorias()
+{
+    esp_err_t erro = nvs_flash_init();
+
+    if(erro == ESP_ERR_NVS_NO_FREE_PAGES)
+    {
+        nvs_flash_erase();
+        erro = nvs_flash_init();
+    }
+    flashAberta = (erro == ESP_OK && nvs_open("salvamento", NVS_READWRITE, &flash) == ESP_OK);
+}
+
+static void leRtc(uint32_t copia, registroCozimento_t *registro)
+{
+    *registro = rtc[copia];
+}
+
+static void gravaRtc(uint32_t copia, const registroCozimento_t *registro)
+{
+    rtc[copia] = *registro;
+}
+
+static bool leFlash(registroCozimento_t *registro)
+{
+    size_t tamanho = sizeof(*registro);
+
+    return flashAberta && nvs_get_blob(flash, "registro", registro, &tamanho) == ESP_OK &&
+           tamanho == sizeof(*registro);
+}
+
+static bool gravaFlash(const registroCozimento_t *registro)
+{
+    return flashAberta && nvs_set_blob(flash, "registro", registro, sizeof(*registro)) == ESP_OK &&
+           nvs_commit(flash) == ESP_OK;
+}
+
+#else
+
+/* No host as duas memórias são vetores que sobrevivem aos resets simulados */
+static registroCozimento_t rtc[SALVAMENTO_COPIAS_RTC];
+static registroCozimento_t flash;
+static uint32_t gravacoesFlash;
+static registroCozimento_t *ultimaGravacao;
+
+static void iniciaMemorias()
+{
+}
+
+static void leRtc(uint32_t copia, registroCozimento_t *registro)
+{
+    *registro = rtc[copia];
+}
+
+static void gravaRtc(uint32_t copia, const registroCozimento_t *registro)
+{
+    rtc[copia] = *registro;
+    ultimaGravacao = &rtc[copia];
+}
+
+static bool leFlash(registroCozimento_t *registro)
+{
+    *registro = flash;
+    return true;
+}
+
+static bool gravaFlash(const registroCozimento_t *registro)
+{
+    flash = *registro;
+    gravacoesFlash++;
+    return true;
+}
+
+/* Apaga as duas memórias, como em uma placa nova */
+void salvamento_simulaApaga()
+{
+    memset(rtc, 0, sizeof(rtc));
+    memset(&flash, 0, sizeof(flash));
+    gravacoesFlash = 0;
+    ultimaGravacao = NULL;
+}
+
+/* Simula uma queda de energia. Uma queda longa apaga a memória RTC, que passa
+ * a conter lixo, e com interrompeGravacao a queda acontece no meio da última
+ * gravação na RTC, que fica pela metade. */
+void salvamento_simulaQueda(bool perdeRtc, bool interrompeGravacao)
+{
+    uint8_t *bytes = NULL;
+    uint32_t i = 0;
+
+    if(interrompeGravacao && ultimaGravacao != NULL)
+    {
+        bytes = (uint8_t *)ultimaGravacao;
+        for(i = sizeof(*ultimaGravacao) / 2 ; i < sizeof(*ultimaGravacao) ; i++)
+        {
+            bytes[i] = (uint8_t)~bytes[i];
+        }
+    }
+    if(perdeRtc)
+    {
+        bytes = (uint8_t *)rtc;
+        for(i = 0 ; i < sizeof(rtc) ; i++)
+        {
+            bytes[i] = (uint8_t)(i * 37 + 11);
+        }
+    }
+    ultimaGravacao = NULL;
+}
+
+uint32_t salvamento_simulaGravacoesFlash()
+{
+    return gravacoesFlash;
+}
+
+#endif
+
+/* CRC-32 (polinômio 0xEDB88320), calculado bit a bit: o registro é pequeno,
+ * e uma tabela ocuparia 1kB */
+uint32_t salvamento_crc(const void *dados, uint32_t tamanho)
+{
+    const uint8_t *bytes = (const uint8_t *)dados;
+    uint32_t crc = 0xFFFFFFFFu;
+    uint32_t i = 0;
+    uint32_t bit = 0;
+
+    for(i = 0 ; i < tamanho ; i++)
+    {
+        crc ^= bytes[i];
+        for(bit = 0 ; bit < 8 ; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+bool salvamento_valido(const registroCozimento_t *registro)
+{
+    return registro->magico == SALVAMENTO_MAGICO &&
+           registro->crc == salvamento_crc(registro, offsetof(registroCozimento_t, crc));
+}
+
+/* Retorna o índice do registro válido de maior sequência, ou -1 se nenhum
+ * for válido. A comparação continua correta quando a sequência dá a volta. */
+static int32_t maisRecente(const registroCozimento_t *registros, uint32_t n)
+{
+    int32_t escolhido = -1;
+    uint32_t i = 0;
+
+    for(i = 0 ; i < n ; i++)
+    {
+        if(salvamento_valido(&registros[i]) &&
+           (escolhido < 0 || (int32_t)(registros[i].sequencia - registros[escolhido].sequencia) > 0))
+        {
+            escolhido = (int32_t)i;
+        }
+    }
+    return escolhido;
+}
+
+/* Inicializa as memórias e procura o registro mais recente. Retorna true se
+ * houver um, que é copiado para registro. As próximas gravações continuam a
+ * sequência e a alternância da RTC de onde elas pararam. */
+bool salvamento_init(salvamento_t *salvamento, registroCozimento_t *registro)
+{
+    registroCozimento_t copias[SALVAMENTO_COPIAS_RTC];
+    registroCozimento_t gravadoFlash;
+    int32_t copia = -1;
+    bool flashValida = false;
+    uint32_t i = 0;
+
+    iniciaMemorias();
+    memset(salvamento, 0, sizeof(*salvamento));
+    salvamento->copiaRtc = SALVAMENTO_COPIAS_RTC - 1;
+
+    for(i = 0 ; i < SALVAMENTO_COPIAS_RTC ; i++)
+    {
+        leRtc(i, &copias[i]);
+    }
+    copia = maisRecente(copias, SALVAMENTO_COPIAS_RTC);
+    flashValida = leFlash(&gravadoFlash) && salvamento_valido(&gravadoFlash);
+
+    if(flashValida)
+    {
+        salvamento->ultimoFlash = gravadoFlash;
+        salvamento->sequencia = gravadoFlash.sequencia;
+        *registro = gravadoFlash;
+    }
+    if(copia >= 0)
+    {
+        salvamento->copiaRtc = (uint32_t)copia;
+        if(!flashValida || (int32_t)(copias[copia].sequencia - gravadoFlash.sequencia) > 0)
+        {
+            salvamento->sequencia = copias[copia].sequencia;
+            *registro = copias[copia];
+        }
+    }
+    return copia >= 0 || flashValida;
+}
+
+/* Copia o estado do forno para um registro. Deve ser chamada com o forno
+ * protegido, como as demais funções de forno.c. */
+void salvamento_captura(const forno_t *forno, registroCozimento_t *registro)
+{
+    int64_t restante = forno_restante(forno);
+    uint32_t i = 0;
+    const lote_t *lote = NULL;
+
+    memset(registro, 0, sizeof(*registro));
+    registro->status = (uint8_t)forno->status;
+    registro->modo = (uint8_t)forno->modo;
+    registro->ponto = (uint8_t)forno->ponto;
+    registro->estadoSessao = (uint8_t)forno->sessao.estado;
+    registro->carregado = forno->carregado;
+    registro->tamanhoFila = (uint8_t)forno->fila.tamanho;
+    registro->divergenciaMs = (uint16_t)forno->controle.fusao.divergenteMs;
+    for(i = 0 ; i < forno->fila.tamanho ; i++)
+    {
+        lote = &forno->fila.lotes[(forno->fila.inicio + i) % FILA_LOTES_MAX];
+        registro->lotes[i] = (uint8_t)((lote->modo << 4) | lote->ponto);
+    }
+    if(forno->sessao.estado != SESSAO_INATIVA)
+    {
+        registro->duracaoMs = (uint32_t)(forno->sessao.duracao / 1000);
+        registro->decorridoMs = (uint32_t)((forno->sessao.duracao - restante) / 1000);
+    }
+    registro->estimativa = forno->controle.fusao.estimativa;
+}
+
+/* Restaura em um forno recém inicializado o estado de um registro. Um
+ * cozimento em andamento volta pausado, e deve ser retomado pelo chamador com
+ * forno_porta, de acordo com o estado atual da porta. A estimativa de
+ * temperatura é mantida, mas com a variância de uma primeira leitura, já que
+ * o forno pode ter esfriado enquanto estava desligado. */
+void salvamento_restaura(forno_t *forno, const registroCozimento_t *registro)
+{
+    lote_t lote;
+    int64_t agora = 0;
+    uint32_t i = 0;
+
+    forno->status = (status_t)registro->status;
+    forno->modo = (modo_t)registro->modo;
+    forno->ponto = (ponto_t)registro->ponto;
+    forno->carregado = registro->carregado;
+    filaLotes_init(&forno->fila);
+    for(i = 0 ; i < registro->tamanhoFila && i < FILA_LOTES_MAX ; i++)
+    {
+        lote.modo = (modo_t)(registro->lotes[i] >> 4);
+        lote.ponto = (ponto_t)(registro->lotes[i] & 0x0F);
+        filaLotes_adiciona(&forno->fila, &lote);
+    }
+
+    sessao_encerra(&forno->sessao);
+    if(forno->status == ACAO_INICIADA)
+    {
+        agora = forno->hal.agora(forno->hal.contexto);
+        sessao_inicia(&forno->sessao, (int64_t)registro->duracaoMs * 1000, agora);
+        sessao_pausa(&forno->sessao, agora);
+        forno->sessao.decorrido = (int64_t)registro->decorridoMs * 1000;
+        /* Os acumuladores dos indicadores não são salvos, então os de um
+         * cozimento retomado cobrem somente o trecho depois da retomada */
+        indicadores_inicia(&forno->indicadores, forno->modo, forno->ponto, forno_temperaturaAlvo(forno), agora,
+                           false);
+    }
+
+    forno->controle.fusao.estimativa = registro->estimativa;
+    forno->controle.fusao.variancia = forno->controle.fusao.ruidoLm35;
+    forno->controle.fusao.divergenteMs = registro->divergenciaMs;
+    forno->controle.fusao.divergencia = (registro->divergenciaMs >= FUSAO_TEMPO_DIVERGENCIA_MS);
+    forno->controle.fusao.inicializado = true;
+    forno->controle.temperaturaAtual = registro->estimativa;
+
+    forno->hal.ledsModo(forno->hal.contexto, forno->modo);
+    forno->hal.ledsPonto(forno->hal.contexto, forno->ponto);
+}
+
+/* Retorna true se o estado do forno mudou entre dois registros. O tempo
+ * decorrido, a estimativa e a contagem de divergência mudam a cada leitura, e
+ * não contam como mudança. */
+static bool mudouEstado(const registroCozimento_t *a, const registroCozimento_t *b)
+{
+    return a->status != b->status || a->modo != b->modo || a->ponto != b->ponto ||
+           a->estadoSessao != b->estadoSessao || a->carregado != b->carregado ||
+           a->tamanhoFila != b->tamanhoFila || a->duracaoMs != b->duracaoMs ||
+           memcmp(a->lotes, b->lotes, sizeof(a->lotes)) != 0;
+}
+
+/* Grava um registro, completando a sua sequência e o seu crc. Retorna false se
+ * a gravação na flash falhar. */
+bool salvamento_grava(salvamento_t *salvamento, registroCozimento_t *registro, int64_t agora)
+{
+    bool mudou = false;
+    bool gravado = true;
+
+    salvamento->sequencia++;
+    registro->magico = SALVAMENTO_MAGICO;
+    registro->sequencia = salvamento->sequencia;
+    registro->crc = salvamento_crc(registro, offsetof(registroCozimento_t, crc));
+
+    salvamento->copiaRtc = (salvamento->copiaRtc + 1) % SALVAMENTO_COPIAS_RTC;
+    gravaRtc(salvamento->copiaRtc, registro);
+    salvamento->gravacoesRtc++;
+
+    /* Fora de um lote em curso a flash só é gravada quando algo muda */
+    mudou = !salvamento_valido(&salvamento->ultimoFlash) || mudouEstado(registro, &salvamento->ultimoFlash);
+    if(mudou || (registro->status == ACAO_INICIADA && registro->estadoSessao == SESSAO_EM_CURSO &&
+                 agora - salvamento->ultimaGravacaoFlash >= (int64_t)SALVAMENTO_PERIODO_FLASH_MS * 1000))
+    {
+        gravado = gravaFlash(registro);
+        salvamento->ultimoFlash = *registro;
+        salvamento->ultimaGravacaoFlash = agora;
+        salvamento->gravacoesFlash++;
+    }
+    return gravado;
+}
@@ -0,0 +1,76 @@
+#include "sessaoCozimento.h"
+
+/* Este arquivo faz a contabilidade do tempo de um cozimento. O tempo cozido
+ * é guardado como o total acumulado até a última retomada mais o tempo desde
+ * então, de forma que pausar, retomar ou consultar o tempo restante custa
+ * apenas algumas somas, sem nenhuma iteração. O disparo do fim do cozimento
+ * fica a cargo de quem usa a sessão (controleForno.c), que deve rearmar o
+ * seu timer com sessao_restante sempre que a sessão for retomada ou estendida. */
+
+void sessao_inicia(sessao_t *sessao, int64_t duracao, int64_t agora)
+{
+    sessao->duracao = duracao;
+    sessao->decorrido = 0;
+    sessao->inicio = agora;
+    sessao->estado = SESSAO_EM_CURSO;
+}
+
+/* Retorna true se a sessão estava em curso e foi pausada */
+bool sessao_pausa(sessao_t *sessao, int64_t agora)
+{
+    if(sessao->estado != SESSAO_EM_CURSO)
+    {
+        return false;
+    }
+    sessao->decorrido += agora - sessao->inicio;
+    sessao->estado = SESSAO_PAUSADA;
+    return true;
+}
+
+/* Retorna true se a sessão estava pausada e foi retomada */
+bool sessao_retoma(sessao_t *sessao, int64_t agora)
+{
+    if(sessao->estado != SESSAO_PAUSADA)
+    {
+        return false;
+    }
+    sessao->inicio = agora;
+    sessao->estado = SESSAO_EM_CURSO;
+    return true;
+}
+
+/* Acrescenta tempo ao cozimento, em curso ou pausado. Uma extensão negativa
+ * encurta o cozimento, mas nunca para antes do tempo já decorrido. */
+void sessao_estende(sessao_t *sessao, int64_t extensao)
+{
+    if(sessao->estado == SESSAO_INATIVA)
+    {
+        return;
+    }
+    sessao->duracao += extensao;
+    if(sessao->duracao < sessao->decorrido)
+    {
+        sessao->duracao = sessao->decorrido;
+    }
+}
+
+void sessao_encerra(sessao_t *sessao)
+{
+    sessao->estado = SESSAO_INATIVA;
+}
+
+/* Retorna o tempo de cozimento restante, ou 0 se não houver sessão ativa */
+int64_t sessao_restante(const sessao_t *sessao, int64_t agora)
+{
+    int64_t decorrido = sessao->decorrido;
+
+    if(sessao->estado == SESSAO_INATIVA)
+    {
+        return 0;
+    }
+    if(sessao->estado == SESSAO_EM_CURSO)
+    {
+        decorrido += agora - sessao->inicio;
+    }
+    return (decorrido >= sessao->duracao) ? 0 : (sessao->duracao - decorrido);
+}
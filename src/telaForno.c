@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include "telaForno.h"
+
+/* Este arquivo desenha a tela do forno no framebuffer (framebuffer.c), que
+ * substitui os seis leds indicativos. A tela tem quatro campos fixos:
+ *
+ *   linha 0      modo à esquerda e ponto à direita
+ *   linhas 16-39 temperatura estimada em escala 3 e a temperatura alvo
+ *   linha 40     lotes à espera na fila
+ *   linhas 48-63 tempo restante ou estado do forno em escala 2
+ *
+ * Cada campo é sempre redesenhado com a mesma largura, preenchida com
+ * espaços, então o texto anterior é apagado pelo próprio desenho, e apenas os
+ * caracteres que mudaram sujam o framebuffer. Com o forno em andamento, a
+ * cada segundo muda somente o último dígito do tempo restante. */
+
+#define LARGURA_MODO        8
+#define LARGURA_PONTO       11
+#define LARGURA_ESTADO      10
+
+static const char *nomeDoModo(modo_t modo)
+{
+    switch (modo)
+    {
+    case ASSAR:
+        return "ASSAR";
+    case GRATINAR:
+        return "GRATINAR";
+    case GRELHAR:
+        return "GRELHAR";
+    default:
+        return "";
+    }
+}
+
+static const char *nomeDoPonto(ponto_t ponto)
+{
+    switch (ponto)
+    {
+    case MAL_PASSADO:
+        return "MAL PASSADO";
+    case AO_PONTO:
+        return "AO PONTO";
+    case BEM_PASSADO:
+        return "BEM PASSADO";
+    default:
+        return "";
+    }
+}
+
+/* Deve ser chamada com o forno protegido da mesma forma que as demais
+ * funções de forno.c */
+void telaForno_captura(telaForno_t *tela, const forno_t *forno)
+{
+    float temperatura = forno->controle.temperaturaAtual;
+    int64_t restante = forno_restante(forno);
+
+    tela->modo = forno->modo;
+    tela->ponto = forno->ponto;
+    tela->status = forno->status;
+    tela->temperatura = (int32_t)((temperatura < 0) ? temperatura - 0.5f : temperatura + 0.5f);
+    tela->temperaturaAlvo = forno_temperaturaAlvo(forno);
+    tela->restante = (uint32_t)((restante + 999999) / 1000000);
+    tela->pausado = forno->portaAberta || forno->sessao.estado == SESSAO_PAUSADA;
+    tela->lotesNaFila = forno->fila.tamanho;
+}
+
+void telaForno_desenha(framebuffer_t *framebuffer, const telaForno_t *tela)
+{
+    char texto[16];
+    int32_t temperatura = tela->temperatura;
+
+    snprintf(texto, sizeof(texto), "%-*s", LARGURA_MODO, nomeDoModo(tela->modo));
+    framebuffer_texto(framebuffer, 0, 0, texto, 1);
+    snprintf(texto, sizeof(texto), "%*s", LARGURA_PONTO, nomeDoPonto(tela->ponto));
+    framebuffer_texto(framebuffer, FRAMEBUFFER_LARGURA - LARGURA_PONTO * FRAMEBUFFER_LARGURA_CARACTERE, 0,
+                      texto, 1);
+
+    temperatura = (temperatura < -99) ? -99 : ((temperatura > 999) ? 999 : temperatura);
+    snprintf(texto, sizeof(texto), "%3d", (int)temperatura);
+    framebuffer_texto(framebuffer, 0, 16, texto, 3);
+    framebuffer_texto(framebuffer, 56, 16, "C", 2);
+    framebuffer_texto(framebuffer, 86, 16, "ALVO", 1);
+    if(tela->temperaturaAlvo > 0)
+    {
+        snprintf(texto, sizeof(texto), "%3u C", (unsigned)tela->temperaturaAlvo);
+    }
+    else
+    {
+        snprintf(texto, sizeof(texto), "  - C");
+    }
+    framebuffer_texto(framebuffer, 86, 28, texto, 1);
+
+    if(tela->lotesNaFila > 0)
+    {
+        snprintf(texto, sizeof(texto), "FILA %-5u", (unsigned)tela->lotesNaFila);
+    }
+    else
+    {
+        snprintf(texto, sizeof(texto), "%10s", "");
+    }
+    framebuffer_texto(framebuffer, 0, 40, texto, 1);
+
+    if(tela->status == ACAO_INICIADA && tela->pausado)
+    {
+        snprintf(texto, sizeof(texto), "%-*s", LARGURA_ESTADO, "PORTA");
+    }
+    else if(tela->status == ACAO_INICIADA)
+    {
+        snprintf(texto, sizeof(texto), "%02u:%02u%*s", (unsigned)(tela->restante / 60) % 100,
+                 (unsigned)(tela->restante % 60), LARGURA_ESTADO - 5, "");
+    }
+    else
+    {
+        snprintf(texto, sizeof(texto), "%-*s", LARGURA_ESTADO,
+                 (tela->status == PREAQUECENDO) ? "PREAQUECE" : "PRONTO");
+    }
+    framebuffer_texto(framebuffer, 0, 48, texto, 2);
+}
@@ -0,0 +1,121 @@
+#include "termopar.h"
+
+/* Este arquivo implementa a leitura do segundo sensor de temperatura do
+ * forno: um termopar tipo K ligado a um amplificador MAX6675, que entrega
+ * a temperatura já convertida através de um barramento SPI somente-leitura.
+ * Cada leitura é um quadro de 16 bits no seguinte formato:
+ *   bit 15     - sempre 0
+ *   bits 14..3 - temperatura em passos de 0.25°C (12 bits)
+ *   bit 2      - 1 quando o termopar está aberto (desconectado)
+ *   bits 1..0  - identificação do dispositivo e estado, ignorados */
+
+#define TERMOPAR_BIT_ABERTO     0x0004
+#define TERMOPAR_RESOLUCAO      0.25f
+
+/* Converte um quadro de 16 bits do MAX6675 em graus Celsius. Retorna false
+ * se o termopar estiver aberto ou se o quadro for inválido. */
+bool termopar_decodificaQuadro(uint16_t quadro, float *temperatura)
+{
+    if((quadro & 0x8000) || (quadro & TERMOPAR_BIT_ABERTO))
+    {
+        return false;
+    }
+    *temperatura = (float)((quadro >> 3) & 0x0FFF) * TERMOPAR_RESOLUCAO;
+    return true;
+}
+
+#ifdef ESP_PLATFORM
+
+#include "definitions.h"
+#include "driver/spi_master.h"
+
+static spi_device_handle_t termopar_spi;
+
+void termopar_init()
+{
+    /* O MAX6675 só possui a linha de saída de dados (SO), então a linha
+     * MOSI não é utilizada. O clock máximo suportado é de 4.3MHz, mas 1MHz
+     * é mais do que suficiente, já que uma conversão leva cerca de 220ms. */
+    spi_bus_config_t buscfg = {
+        .miso_io_num = TERMOPAR_MISO,
+        .mosi_io_num = -1,
+        .sclk_io_num = TERMOPAR_SCLK,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+    };
+    spi_device_interface_config_t devcfg = {
+        .clock_speed_hz = 1000000,
+        .mode = 0,
+        .spics_io_num = TERMOPAR_CS,
+        .queue_size = 1,
+    };
+
+    spi_bus_initialize(HSPI_HOST, &buscfg, 0);
+    spi_bus_add_device(HSPI_HOST, &devcfg, &termopar_spi);
+}
+
+/* Lê o quadro bruto de 16 bits do MAX6675. Retorna false se a transação SPI
+ * falhar. */
+bool termopar_leQuadro(uint16_t *quadro)
+{
+    spi_transaction_t t = {
+        .flags = SPI_TRANS_USE_RXDATA,
+        .length = 16,
+        .rxlength = 16,
+    };
+
+    if(termopar_spi == NULL || spi_device_polling_transmit(termopar_spi, &t) != ESP_OK)
+    {
+        return false;
+    }
+    *quadro = (uint16_t)((t.rx_data[0] << 8) | t.rx_data[1]);
+    return true;
+}
+
+#else
+
+/* Dispositivo simulado usado no build para host. O valor lido é o último
+ * valor configurado através de termopar_simulaTemperatura, quantizado da
+ * mesma forma que o MAX6675 faria. */
+static float temperaturaSimulada = 25.0f;
+static bool sensorAbertoSimulado = false;
+
+void termopar_init()
+{
+}
+
+uint16_t termopar_simulaQuadro(float temperatura, bool sensorAberto)
+{
+    int32_t passos = (int32_t)(temperatura / TERMOPAR_RESOLUCAO + 0.5f);
+
+    if(passos < 0)
+    {
+        passos = 0;
+    }
+    else if(passos > 0x0FFF)
+    {
+        passos = 0x0FFF;
+    }
+    return (uint16_t)((passos << 3) | (sensorAberto ? TERMOPAR_BIT_ABERTO : 0));
+}
+
+void termopar_simulaTemperatura(float temperatura, bool sensorAberto)
+{
+    temperaturaSimulada = temperatura;
+    sensorAbertoSimulado = sensorAberto;
+}
+
+bool termopar_leQuadro(uint16_t *quadro)
+{
+    *quadro = termopar_simulaQuadro(temperaturaSimulada, sensorAbertoSimulado);
+    return true;
+}
+
+#endif
+
+bool termopar_ler(float *temperatura)
+{
+    uint16_t quadro = 0;
+
+    return termopar_leQuadro(&quadro) && termopar_decodificaQuadro(quadro, temperatura);
+}
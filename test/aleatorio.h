@@ -0,0 +1,18 @@
+#ifndef ALEATORIO_H
+#define ALEATORIO_H
+
+#include <stdint.h>
+
+/* Gerador congruente linear usado pelas suítes de teste para variar as
+ * entradas de forma reproduzível. Cada suíte é um programa separado, com a
+ * sua própria semente, e inclui este arquivo pelo caminho relativo
+ * "../aleatorio.h". */
+static uint32_t semente = 12345;
+
+static inline uint32_t aleatorio()
+{
+    semente = semente * 1664525u + 1013904223u;
+    return semente >> 8;
+}
+
+#endif /* ALEATORIO_H */
@@ -0,0 +1,196 @@
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+#include <unity.h>
+#include "definitions.h"
+#include "decimador.h"
+#include "../aleatorio.h"
+
+/* Testes do pipeline de decimação do LM35 (CIC seguido do FIR de
+ * compensação), com a razão de decimação usada pelo forno */
+
+#define R               NUMBER_OF_SAMPLES
+/* Ganho da entrada de 12 bits para a saída de 16 bits */
+#define GANHO_SAIDA     (1 << (DECIMADOR_BITS_SAIDA - DECIMADOR_BITS_ENTRADA))
+/* Atraso de grupo em amostras de entrada: o CIC tem resposta ao impulso
+ * simétrica de CIC_ORDEM * (R - 1) + 1 amostras, e o FIR atrasa uma saída */
+#define ATRASO_GRUPO    (CIC_ORDEM * (R - 1) / 2.0 + (FIR_COMPENSACAO_TAPS - 1) / 2 * R)
+#define SAIDAS_RAMPA    2000
+/* Entradas necessárias para SAIDAS_RAMPA saídas, com as descartadas no início */
+#define ENTRADAS_RAMPA  ((SAIDAS_RAMPA + (CIC_ORDEM - 1) + (FIR_COMPENSACAO_TAPS - 1)) * R)
+/* Repetições da medida do custo, das quais a menor é usada */
+#define REPETICOES      9
+
+static decimador_t decimador;
+static uint16_t amostrasRampa[ENTRADAS_RAMPA];
+
+void setUp()
+{
+    decimador_init(&decimador, ADC_DECIMACAO_LOG2);
+}
+
+void tearDown()
+{
+}
+
+void test_fatoresValidos()
+{
+    TEST_ASSERT_TRUE(DECIMADOR_FATOR_VALIDO(ADC_DECIMACAO_LOG2));
+    TEST_ASSERT_FALSE(DECIMADOR_FATOR_VALIDO(1));
+    TEST_ASSERT_TRUE(DECIMADOR_FATOR_VALIDO(2));
+    TEST_ASSERT_TRUE(DECIMADOR_FATOR_VALIDO(6));
+    TEST_ASSERT_FALSE(DECIMADOR_FATOR_VALIDO(7));
+}
+
+/* As primeiras (CIC_ORDEM - 1) + (FIR_COMPENSACAO_TAPS - 1) saídas ainda
+ * contêm a condição inicial e não são entregues */
+void test_descarteInicial()
+{
+    uint32_t descartadas = (CIC_ORDEM - 1) + (FIR_COMPENSACAO_TAPS - 1);
+    uint16_t saida = 0;
+    uint32_t i = 0;
+
+    TEST_ASSERT_EQUAL_UINT32(4, descartadas);
+    for(i = 1 ; i < (descartadas + 1) * R ; i++)
+    {
+        TEST_ASSERT_FALSE(decimador_adiciona(&decimador, 1000, &saida));
+    }
+    TEST_ASSERT_TRUE(decimador_adiciona(&decimador, 1000, &saida));
+    for(i = 1 ; i < R ; i++)
+    {
+        TEST_ASSERT_FALSE(decimador_adiciona(&decimador, 1000, &saida));
+    }
+    TEST_ASSERT_TRUE(decimador_adiciona(&decimador, 1000, &saida));
+
+    /* Reiniciar volta a descartar */
+    decimador_init(&decimador, ADC_DECIMACAO_LOG2);
+    for(i = 1 ; i < (descartadas + 1) * R ; i++)
+    {
+        TEST_ASSERT_FALSE(decimador_adiciona(&decimador, 1000, &saida));
+    }
+}
+
+/* Em DC o ganho do CIC e do FIR juntos é exatamente o da mudança de escala de
+ * 12 para 16 bits, inclusive nos extremos */
+void test_ganhoDc()
+{
+    const uint32_t entradas[] = {0, 1, 1000, 2048, 4095};
+    uint16_t saida = 0;
+    uint32_t e = 0;
+    uint32_t i = 0;
+
+    for(e = 0 ; e < sizeof(entradas) / sizeof(entradas[0]) ; e++)
+    {
+        decimador_init(&decimador, ADC_DECIMACAO_LOG2);
+        for(i = 0 ; i < 10 * R ; i++)
+        {
+            if(decimador_adiciona(&decimador, entradas[e], &saida))
+            {
+                TEST_ASSERT_EQUAL_UINT32(entradas[e] * GANHO_SAIDA, saida);
+            }
+        }
+    }
+}
+
+/* Bits efetivos de um erro de desvio médio quadrático em LSBs de 16 bits:
+ * a resolução de um quantizador ideal com o mesmo erro */
+static double bitsEfetivos(double erro)
+{
+    return DECIMADOR_BITS_SAIDA - log2(erro * sqrt(12.0));
+}
+
+static double agoraNs()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* Custo em ns de cada saída decimada, com as n amostras de amostrasRampa, o
+ * menor de REPETICOES medidas */
+static double custoPorSaida(uint32_t n)
+{
+    volatile uint32_t sumidouro = 0;
+    uint16_t saida = 0;
+    uint32_t saidas = 0;
+    double inicio = 0;
+    double tempo = 0;
+    double melhor = 0;
+    uint32_t r = 0;
+    uint32_t i = 0;
+
+    for(r = 0 ; r < REPETICOES ; r++)
+    {
+        decimador_init(&decimador, ADC_DECIMACAO_LOG2);
+        saidas = 0;
+        inicio = agoraNs();
+        for(i = 0 ; i < n ; i++)
+        {
+            if(decimador_adiciona(&decimador, amostrasRampa[i], &saida))
+            {
+                sumidouro += saida;
+                saidas++;
+            }
+        }
+        tempo = agoraNs() - inicio;
+        if(r == 0 || tempo < melhor)
+        {
+            melhor = tempo;
+        }
+    }
+    return melhor / saidas;
+}
+
+/* Uma rampa lenta com ruído de ±3 LSBs na entrada de 12 bits. Um filtro de
+ * fase linear e ganho unitário em DC reproduz a rampa atrasada do seu atraso
+ * de grupo, então o erro da saída em relação a ela é só o ruído que sobrou */
+void test_bitsEfetivosEmRampa()
+{
+    double inclinacao = 0.02;
+    double erroEntrada = 0;
+    double erroSaida = 0;
+    double ideal = 0;
+    double custo = 0;
+    uint32_t saidas = 0;
+    uint32_t amostra = 0;
+    uint16_t saida = 0;
+    uint32_t n = 0;
+
+    for(n = 0 ; saidas < SAIDAS_RAMPA ; n++)
+    {
+        amostra = (uint32_t)(1000 + inclinacao * n + 0.5) + aleatorio() % 7 - 3;
+        amostrasRampa[n] = (uint16_t)amostra;
+        erroEntrada += ((double)amostra - (1000 + inclinacao * n)) * ((double)amostra - (1000 + inclinacao * n));
+        if(decimador_adiciona(&decimador, amostra, &saida))
+        {
+            ideal = (1000 + inclinacao * (n - ATRASO_GRUPO)) * GANHO_SAIDA;
+            erroSaida += (saida - ideal) * (saida - ideal);
+            saidas++;
+        }
+    }
+    erroEntrada = sqrt(erroEntrada / n) * GANHO_SAIDA;
+    erroSaida = sqrt(erroSaida / saidas);
+    /* O custo é o de cada saída decimada, que consome R amostras de entrada */
+    custo = custoPorSaida(n);
+    printf("Entrada: %.2f bits efetivos, saida do decimador: %.2f bits efetivos, "
+           "%.1f ns por saida (R = %u, %.2f ns por amostra de entrada)\n",
+           bitsEfetivos(erroEntrada), bitsEfetivos(erroSaida), custo, (unsigned)R, custo / R);
+
+    /* A janela do CIC cobre CIC_ORDEM * (R - 1) + 1 amostras, e nenhuma janela
+     * desse tamanho tira mais ruído que a média simples delas */
+    TEST_ASSERT_TRUE(bitsEfetivos(erroSaida) > bitsEfetivos(erroEntrada) + 2.0);
+    TEST_ASSERT_TRUE(bitsEfetivos(erroSaida) < bitsEfetivos(erroEntrada) + log2(CIC_ORDEM * (R - 1) + 1) / 2);
+    TEST_ASSERT_TRUE(n == ENTRADAS_RAMPA);
+    TEST_ASSERT_TRUE(custo > 0);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_fatoresValidos);
+    RUN_TEST(test_descarteInicial);
+    RUN_TEST(test_ganhoDc);
+    RUN_TEST(test_bitsEfetivosEmRampa);
+    return UNITY_END();
+}
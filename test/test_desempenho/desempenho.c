@@ -0,0 +1,267 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "desempenho.h"
+
+/* Este arquivo mede o tempo por operação de cada benchmark e compara o
+ * resultado com a referência versionada em DESEMPENHO_REFERENCIA. Os
+ * resultados são gravados em DESEMPENHO_DIR/resultado.json. A referência
+ * nunca é criada implicitamente: sem ela os benchmarks falham, e ela só é
+ * gravada, com os resultados da execução, quando o teste é compilado com
+ * DESEMPENHO_ATUALIZA_REFERENCIA.
+ *
+ * Os tempos absolutos dependem da máquina e da sua carga, então o que é
+ * comparado é o custo relativo: o tempo por operação dividido pelo de uma
+ * operação de um laço de calibração fixo, medido na mesma execução e
+ * intercalado com cada repetição do benchmark. Uma máquina mais lenta, ou
+ * com a frequência reduzida durante a medida, torna os dois mais lentos na
+ * mesma proporção. A referência só precisa ser regenerada ao aceitar uma
+ * mudança de desempenho, ou ao mudar de arquitetura ou de compilador. */
+
+#define ARQUIVO_RESULTADO       DESEMPENHO_DIR "/resultado.json"
+#define ARQUIVO_REFERENCIA      DESEMPENHO_REFERENCIA
+
+/* Cada medida, do benchmark ou do laço de calibração, dura cerca de
+ * TEMPO_MEDIDA_NS, e o menor de REPETICOES tempos é usado, o que descarta as
+ * interrupções do sistema operacional. Medidas curtas e numerosas aumentam a
+ * chance de que pelo menos uma de cada não seja interrompida. */
+#define TEMPO_MEDIDA_NS         2000000.0
+#define REPETICOES              31
+/* Um benchmark acima do limite é medido de novo até TENTATIVAS vezes, e o
+ * menor custo relativo é usado, para que uma rajada de carga da máquina não
+ * seja tomada como uma regressão */
+#define TENTATIVAS              3
+
+static resultadoBenchmark_t resultados[DESEMPENHO_MAX_RESULTADOS];
+static uint32_t numeroDeResultados = 0;
+static char *referencia = NULL;
+
+/* Tempo de CPU da thread, que não conta o tempo em que ela esperou por um
+ * núcleo enquanto outros processos executavam */
+static double agoraNs()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static double executa(funcaoBenchmark_t funcao, uint32_t n)
+{
+    double inicio = agoraNs();
+
+    funcao(n);
+    return agoraNs() - inicio;
+}
+
+/* Laço de calibração: um gerador congruencial, uma conta em ponto flutuante
+ * e um acesso a uma pequena tabela por operação, dependentes entre si, como
+ * o trabalho dos benchmarks */
+static volatile uint32_t sumidouroCalibracao;
+
+static void calibracao(uint32_t n)
+{
+    uint32_t tabela[64];
+    uint32_t x = 12345;
+    float soma = 0;
+    uint32_t i = 0;
+
+    memset(tabela, 0, sizeof(tabela));
+    for(i = 0 ; i < n ; i++)
+    {
+        x = x * 1664525u + 1013904223u + tabela[x >> 26];
+        soma = soma * 0.5f + (float)(x >> 16);
+        tabela[x & 63] += (uint32_t)soma;
+    }
+    sumidouroCalibracao = x + tabela[0];
+}
+
+/* Procura o valor de relativo do benchmark nome no arquivo de referência. O
+ * arquivo é sempre gravado por desempenho_finaliza, então basta procurar o
+ * nome e o primeiro campo relativo depois dele. */
+static double buscaReferencia(const char *nome)
+{
+    char chave[128];
+    char *posicao = NULL;
+
+    if(referencia == NULL)
+    {
+        return 0;
+    }
+    snprintf(chave, sizeof(chave), "\"nome\": \"%s\"", nome);
+    posicao = strstr(referencia, chave);
+    if(posicao == NULL)
+    {
+        return 0;
+    }
+    posicao = strstr(posicao, "\"relativo\":");
+    if(posicao == NULL)
+    {
+        return 0;
+    }
+    return strtod(posicao + strlen("\"relativo\":"), NULL);
+}
+
+static void criaDiretorio(const char *caminho)
+{
+    char parcial[256];
+    size_t i = 0;
+
+    for(i = 0 ; caminho[i] != '\0' && i < sizeof(parcial) - 1 ; i++)
+    {
+        if(caminho[i] == '/' && i > 0)
+        {
+            parcial[i] = '\0';
+            mkdir(parcial, 0755);
+        }
+        parcial[i] = caminho[i];
+    }
+    parcial[i] = '\0';
+    mkdir(parcial, 0755);
+}
+
+/* Carrega a referência. Retorna false se ela não existir, caso em que todo
+ * benchmark fica sem referência. */
+bool desempenho_init()
+{
+    FILE *arquivo = NULL;
+    long tamanho = 0;
+
+    numeroDeResultados = 0;
+    criaDiretorio(DESEMPENHO_DIR);
+
+#ifdef DESEMPENHO_ATUALIZA_REFERENCIA
+    /* A referência vai ser regravada, então não há com o que comparar */
+    return true;
+#endif
+    arquivo = fopen(ARQUIVO_REFERENCIA, "r");
+    if(arquivo == NULL)
+    {
+        return false;
+    }
+    fseek(arquivo, 0, SEEK_END);
+    tamanho = ftell(arquivo);
+    fseek(arquivo, 0, SEEK_SET);
+    referencia = calloc(1, tamanho + 1);
+    if(referencia != NULL && fread(referencia, 1, tamanho, arquivo) != (size_t)tamanho)
+    {
+        free(referencia);
+        referencia = NULL;
+    }
+    fclose(arquivo);
+    return referencia != NULL;
+}
+
+/* Número de operações de funcao por medida: ele é dobrado até que uma medida
+ * leve pelo menos metade de TEMPO_MEDIDA_NS, e então é ajustado para que cada
+ * uma leve cerca de TEMPO_MEDIDA_NS */
+static uint32_t operacoesPorMedida(funcaoBenchmark_t funcao)
+{
+    uint32_t n = 1;
+    double tempo = 0;
+
+    while((tempo = executa(funcao, n)) < TEMPO_MEDIDA_NS / 2 && n < (1u << 30))
+    {
+        n *= 2;
+    }
+    return (uint32_t)(n * (TEMPO_MEDIDA_NS / tempo)) + 1;
+}
+
+/* Mede funcao, preenchendo nsPorOperacao e relativo de resultado. Antes de
+ * cada repetição o laço de calibração também é medido, e o menor tempo de
+ * cada um é usado. */
+static void mede(funcaoBenchmark_t funcao, resultadoBenchmark_t *resultado)
+{
+    uint32_t n = 0;
+    uint32_t nCalibracao = 0;
+    double tempo = 0;
+    double melhor = 0;
+    double melhorCalibracao = 0;
+    int i = 0;
+
+    n = operacoesPorMedida(funcao);
+    nCalibracao = operacoesPorMedida(calibracao);
+    for(i = 0 ; i < REPETICOES ; i++)
+    {
+        tempo = executa(calibracao, nCalibracao);
+        if(i == 0 || tempo < melhorCalibracao)
+        {
+            melhorCalibracao = tempo;
+        }
+        tempo = executa(funcao, n);
+        if(i == 0 || tempo < melhor)
+        {
+            melhor = tempo;
+        }
+    }
+
+    resultado->nsPorOperacao = melhor / n;
+    resultado->relativo = resultado->nsPorOperacao / (melhorCalibracao / nCalibracao);
+}
+
+/* Mede funcao e registra o resultado com o nome dado */
+const resultadoBenchmark_t *desempenho_mede(const char *nome, funcaoBenchmark_t funcao)
+{
+    resultadoBenchmark_t *resultado = NULL;
+    resultadoBenchmark_t tentativa;
+    int i = 0;
+
+    if(numeroDeResultados >= DESEMPENHO_MAX_RESULTADOS)
+    {
+        return NULL;
+    }
+
+    resultado = &resultados[numeroDeResultados++];
+    resultado->nome = nome;
+    resultado->referencia = buscaReferencia(nome);
+    for(i = 0 ; i < TENTATIVAS ; i++)
+    {
+        mede(funcao, &tentativa);
+        if(i == 0 || tentativa.relativo < resultado->relativo)
+        {
+            resultado->nsPorOperacao = tentativa.nsPorOperacao;
+            resultado->relativo = tentativa.relativo;
+        }
+        resultado->regressao = (resultado->referencia > 0) &&
+                               (resultado->relativo > resultado->referencia * (1.0 + DESEMPENHO_LIMITE_REGRESSAO));
+        if(!resultado->regressao)
+        {
+            break;
+        }
+    }
+    return resultado;
+}
+
+static void gravaResultados(const char *caminho)
+{
+    FILE *arquivo = fopen(caminho, "w");
+    uint32_t i = 0;
+
+    if(arquivo == NULL)
+    {
+        return;
+    }
+    fprintf(arquivo, "{\n  \"limiteRegressao\": %.2f,\n  \"resultados\": [\n", DESEMPENHO_LIMITE_REGRESSAO);
+    for(i = 0 ; i < numeroDeResultados ; i++)
+    {
+        fprintf(arquivo, "    {\"nome\": \"%s\", \"nsPorOperacao\": %.3f, \"relativo\": %.4f, \"referencia\": %.4f, "
+                "\"regressao\": %s}%s\n",
+                resultados[i].nome, resultados[i].nsPorOperacao, resultados[i].relativo, resultados[i].referencia,
+                resultados[i].regressao ? "true" : "false",
+                (i + 1 < numeroDeResultados) ? "," : "");
+    }
+    fprintf(arquivo, "  ]\n}\n");
+    fclose(arquivo);
+}
+
+void desempenho_finaliza()
+{
+    gravaResultados(ARQUIVO_RESULTADO);
+#ifdef DESEMPENHO_ATUALIZA_REFERENCIA
+    gravaResultados(ARQUIVO_REFERENCIA);
+#endif
+    free(referencia);
+    referencia = NULL;
+}
@@ -0,0 +1,40 @@
+#ifndef DESEMPENHO_H
+#define DESEMPENHO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Diretório onde os resultados são gravados e arquivo da referência, ambos
+ * relativos ao diretório do projeto, e aumento máximo aceito do custo
+ * relativo ao laço de calibração, em relação à referência, antes que um
+ * benchmark seja considerado uma regressão. Compilado com
+ * DESEMPENHO_ATUALIZA_REFERENCIA, nada é comparado e os resultados são
+ * gravados como a nova referência. */
+#ifndef DESEMPENHO_DIR
+#define DESEMPENHO_DIR                  ".pio/desempenho"
+#endif
+#ifndef DESEMPENHO_REFERENCIA
+#define DESEMPENHO_REFERENCIA           "test/test_desempenho/referencia.json"
+#endif
+#ifndef DESEMPENHO_LIMITE_REGRESSAO
+#define DESEMPENHO_LIMITE_REGRESSAO     0.30
+#endif
+
+#define DESEMPENHO_MAX_RESULTADOS       32
+
+/* Função medida pelo benchmark. Cada chamada executa n operações. */
+typedef void (*funcaoBenchmark_t)(uint32_t n);
+
+typedef struct _resultadoBenchmark {
+    const char *nome;
+    double nsPorOperacao;
+    double relativo;        /* Custo em operações do laço de calibração      */
+    double referencia;      /* relativo da referência, ou 0 se não houver    */
+    bool regressao;
+} resultadoBenchmark_t;
+
+extern bool desempenho_init();
+extern const resultadoBenchmark_t *desempenho_mede(const char *nome, funcaoBenchmark_t funcao);
+extern void desempenho_finaliza();
+
+#endif /* DESEMPENHO_H */
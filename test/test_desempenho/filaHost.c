@@ -0,0 +1,55 @@
+#include <stdlib.h>
+#include <string.h>
+#include "filaHost.h"
+
+bool filaHost_cria(filaHost_t *fila, uint32_t capacidade, uint32_t tamanhoItem)
+{
+    fila->armazenamento = malloc((size_t)capacidade * tamanhoItem);
+    fila->tamanhoItem = tamanhoItem;
+    fila->capacidade = capacidade;
+    fila->inicio = 0;
+    fila->ocupados = 0;
+    pthread_mutex_init(&fila->mutex, NULL);
+    return fila->armazenamento != NULL;
+}
+
+void filaHost_destroi(filaHost_t *fila)
+{
+    free(fila->armazenamento);
+    fila->armazenamento = NULL;
+    pthread_mutex_destroy(&fila->mutex);
+}
+
+/* Retorna false se a fila estiver cheia */
+bool filaHost_envia(filaHost_t *fila, const void *item)
+{
+    uint32_t posicao = 0;
+
+    pthread_mutex_lock(&fila->mutex);
+    if(fila->ocupados == fila->capacidade)
+    {
+        pthread_mutex_unlock(&fila->mutex);
+        return false;
+    }
+    posicao = (fila->inicio + fila->ocupados) % fila->capacidade;
+    memcpy(fila->armazenamento + (size_t)posicao * fila->tamanhoItem, item, fila->tamanhoItem);
+    fila->ocupados++;
+    pthread_mutex_unlock(&fila->mutex);
+    return true;
+}
+
+/* Retorna false se a fila estiver vazia */
+bool filaHost_recebe(filaHost_t *fila, void *item)
+{
+    pthread_mutex_lock(&fila->mutex);
+    if(fila->ocupados == 0)
+    {
+        pthread_mutex_unlock(&fila->mutex);
+        return false;
+    }
+    memcpy(item, fila->armazenamento + (size_t)fila->inicio * fila->tamanhoItem, fila->tamanhoItem);
+    fila->inicio = (fila->inicio + 1) % fila->capacidade;
+    fila->ocupados--;
+    pthread_mutex_unlock(&fila->mutex);
+    return true;
+}
@@ -0,0 +1,25 @@
+#ifndef FILAHOST_H
+#define FILAHOST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+/* Fila usada no lugar da fila do FreeRTOS no ambiente native. Assim como
+ * xQueueSend e xQueueReceive, os itens são copiados por valor para dentro e
+ * para fora de um buffer circular, dentro de uma seção crítica. */
+typedef struct _filaHost {
+    uint8_t *armazenamento;
+    uint32_t tamanhoItem;
+    uint32_t capacidade;
+    uint32_t inicio;
+    uint32_t ocupados;
+    pthread_mutex_t mutex;
+} filaHost_t;
+
+extern bool filaHost_cria(filaHost_t *fila, uint32_t capacidade, uint32_t tamanhoItem);
+extern void filaHost_destroi(filaHost_t *fila);
+extern bool filaHost_envia(filaHost_t *fila, const void *item);
+extern bool filaHost_recebe(filaHost_t *fila, void *item);
+
+#endif /* FILAHOST_H */
@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <unity.h>
+#include "desempenho.h"
+#include "../aleatorio.h"
+#include "filaHost.h"
+#include "definitions.h"
+#include "decimador.h"
+#include "controleTemperatura.h"
+#include "parametrosCozimento.h"
+#include "indicadoresCozimento.h"
+
+/* Benchmarks dos caminhos executados a cada período de controle do forno.
+ * Cada teste falha se o custo por operação, relativo ao laço de calibração,
+ * ficar mais de DESEMPENHO_LIMITE_REGRESSAO acima do da referência, ou se não
+ * houver referência para ele (desempenho.c). */
+
+/* Os resultados são acumulados em variáveis voláteis para que o compilador
+ * não elimine as chamadas medidas */
+static volatile uint32_t sumidouro;
+static volatile float sumidouroFloat;
+
+static decimador_t decimador;
+static controleTemperatura_t controle;
+static filaHost_t fila;
+static indicadores_t indicadores;
+static int64_t instanteIndicadores;
+
+/* Trabalho feito pela task adcRead por leitura enviada: NUMBER_OF_SAMPLES
+ * amostras de 12 bits passando pelo decimador. Cada operação é uma saída
+ * decimada. */
+static void benchAdcReadDecimacao(uint32_t n)
+{
+    uint16_t saida = 0;
+    uint32_t i = 0;
+    uint32_t j = 0;
+
+    for(i = 0 ; i < n ; i++)
+    {
+        for(j = 0 ; j < NUMBER_OF_SAMPLES ; j++)
+        {
+            decimador_adiciona(&decimador, 2000 + (aleatorio() & 0x0F), &saida);
+        }
+        sumidouro += saida;
+    }
+}
+
+static void benchConverteTemperaturaLm35(uint32_t n)
+{
+    uint32_t i = 0;
+
+    for(i = 0 ; i < n ; i++)
+    {
+        sumidouroFloat += converteTemperaturaLm35(aleatorio() & 0xFFFF);
+    }
+}
+
+/* Trabalho feito pela task OutputControl por leitura recebida: conversão do
+ * LM35, atualização do estimador e decisão da saída */
+static void benchOutputControlEstimativa(uint32_t n)
+{
+    leitura_t leitura = {0, 0, true, 0};
+    uint32_t i = 0;
+
+    for(i = 0 ; i < n ; i++)
+    {
+        leitura.lm35 = 9000 + (aleatorio() & 0xFF);
+        leitura.termopar = converteTemperaturaLm35(leitura.lm35) + 0.5f;
+        sumidouro += controleTemperatura_atualiza(&controle, &leitura, TEMPERATURA_ASSAR, false);
+    }
+}
+
+static void benchGetTemperaturaAlvoDoModo(uint32_t n)
+{
+    uint32_t i = 0;
+
+    for(i = 0 ; i < n ; i++)
+    {
+        sumidouro += getTemperaturaAlvoDoModo((modo_t)(aleatorio() % 3));
+    }
+}
+
+static void benchGetTempoDeFuncionamentoDoPonto(uint32_t n)
+{
+    uint32_t i = 0;
+
+    for(i = 0 ; i < n ; i++)
+    {
+        sumidouro += getTempoDeFuncionamentoDoPonto((ponto_t)(aleatorio() % 3));
+    }
+}
+
+/* Passagem de uma leitura de adcRead para OutputControl pela fila */
+static void benchFilaLeitura(uint32_t n)
+{
+    leitura_t enviada = {0, 0, true, 0};
+    leitura_t recebida;
+    uint32_t i = 0;
+
+    for(i = 0 ; i < n ; i++)
+    {
+        enviada.lm35 = i;
+        filaHost_envia(&fila, &enviada);
+        filaHost_recebe(&fila, &recebida);
+        sumidouro += recebida.lm35;
+    }
+}
+
+/* Atualização dos indicadores do cozimento por leitura recebida pela task
+ * OutputControl, com a temperatura oscilando em torno do alvo */
+static void amostraIndicadores(uint32_t n)
+{
+    uint32_t i = 0;
+
+    for(i = 0 ; i < n ; i++)
+    {
+        instanteIndicadores += 100000;
+        indicadores_amostra(&indicadores, instanteIndicadores,
+                            TEMPERATURA_ASSAR - 4.0f + (float)(aleatorio() & 0xFF) / 32.0f, (aleatorio() & 1) != 0);
+    }
+}
+
+/* Cozimentos curtos, de INDICADORES_AMOSTRAS_CURTO leituras cada */
+#define INDICADORES_AMOSTRAS_CURTO  256
+static void benchIndicadoresCurto(uint32_t n)
+{
+    uint32_t i = 0;
+
+    for(i = 0 ; i < n ; i += INDICADORES_AMOSTRAS_CURTO)
+    {
+        indicadores_inicia(&indicadores, ASSAR, AO_PONTO, TEMPERATURA_ASSAR, instanteIndicadores, false);
+        amostraIndicadores((n - i < INDICADORES_AMOSTRAS_CURTO) ? n - i : INDICADORES_AMOSTRAS_CURTO);
+        sumidouro += indicadores.comutacoes;
+    }
+}
+
+/* Um único cozimento que nunca termina, com milhões de leituras acumuladas */
+static void benchIndicadoresLongo(uint32_t n)
+{
+    amostraIndicadores(n);
+    sumidouro += indicadores.comutacoes;
+}
+
+static const resultadoBenchmark_t *verifica(const char *nome, funcaoBenchmark_t funcao)
+{
+    const resultadoBenchmark_t *resultado = desempenho_mede(nome, funcao);
+
+    TEST_ASSERT_NOT_NULL(resultado);
+    printf("%-36s %10.3f ns/op, relativo %.4f (referencia %.4f)\n", nome, resultado->nsPorOperacao,
+           resultado->relativo, resultado->referencia);
+#ifndef DESEMPENHO_ATUALIZA_REFERENCIA
+    TEST_ASSERT_TRUE_MESSAGE(resultado->referencia > 0, nome);
+#endif
+    TEST_ASSERT_FALSE_MESSAGE(resultado->regressao, nome);
+    return resultado;
+}
+
+void setUp()
+{
+    decimador_init(&decimador, ADC_DECIMACAO_LOG2);
+    controleTemperatura_init(&controle);
+}
+
+void tearDown()
+{
+}
+
+void test_adcRead_decimacao()
+{
+    const resultadoBenchmark_t *resultado = verifica("adcRead_decimacao", benchAdcReadDecimacao);
+
+    printf("%-36s %10.3f ns por saida decimada, %.3f ns por amostra de entrada (R = %u)\n", "",
+           resultado->nsPorOperacao, resultado->nsPorOperacao / NUMBER_OF_SAMPLES, (unsigned)NUMBER_OF_SAMPLES);
+}
+
+void test_converteTemperaturaLm35()
+{
+    verifica("converteTemperaturaLm35", benchConverteTemperaturaLm35);
+}
+
+void test_OutputControl_estimativa()
+{
+    verifica("OutputControl_estimativa", benchOutputControlEstimativa);
+}
+
+void test_getTemperaturaAlvoDoModo()
+{
+    verifica("getTemperaturaAlvoDoModo", benchGetTemperaturaAlvoDoModo);
+}
+
+void test_getTempoDeFuncionamentoDoPonto()
+{
+    verifica("getTempoDeFuncionamentoDoPonto", benchGetTempoDeFuncionamentoDoPonto);
+}
+
+/* O custo por leitura dos indicadores não cresce com o número de leituras
+ * já acumuladas no cozimento */
+void test_indicadores_custoConstante()
+{
+    registroIndicadores_t registro;
+    const resultadoBenchmark_t *curto = NULL;
+    const resultadoBenchmark_t *longo = NULL;
+
+    curto = verifica("indicadores_amostra_curto", benchIndicadoresCurto);
+
+    indicadores_inicia(&indicadores, ASSAR, AO_PONTO, TEMPERATURA_ASSAR, instanteIndicadores, false);
+    amostraIndicadores(10000000);
+    longo = verifica("indicadores_amostra_longo", benchIndicadoresLongo);
+
+    TEST_ASSERT_TRUE(indicadores_parcial(&indicadores, instanteIndicadores, &registro));
+    printf("%u leituras no cozimento longo, %.3f ns/leitura contra %.3f no curto\n", registro.amostras,
+           longo->nsPorOperacao, curto->nsPorOperacao);
+    TEST_ASSERT_TRUE(registro.amostras > 10000000);
+    TEST_ASSERT_TRUE(longo->nsPorOperacao < 1.5 * curto->nsPorOperacao);
+}
+
+void test_fila_leitura()
+{
+    TEST_ASSERT_TRUE(filaHost_cria(&fila, 20, sizeof(leitura_t)));
+    verifica("fila_leitura", benchFilaLeitura);
+    filaHost_destroi(&fila);
+}
+
+int main(int argc, char **argv)
+{
+    if(!desempenho_init())
+    {
+        printf("Referencia %s nao encontrada: gere-a compilando com -D DESEMPENHO_ATUALIZA_REFERENCIA\n",
+               DESEMPENHO_REFERENCIA);
+    }
+
+    UNITY_BEGIN();
+    RUN_TEST(test_adcRead_decimacao);
+    RUN_TEST(test_converteTemperaturaLm35);
+    RUN_TEST(test_OutputControl_estimativa);
+    RUN_TEST(test_getTemperaturaAlvoDoModo);
+    RUN_TEST(test_getTempoDeFuncionamentoDoPonto);
+    RUN_TEST(test_fila_leitura);
+    RUN_TEST(test_indicadores_custoConstante);
+
+    desempenho_finaliza();
+    return UNITY_END();
+}
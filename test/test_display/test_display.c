@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <unity.h>
+#include "definitions.h"
+#include "framebuffer.h"
+#include "display.h"
+#include "telaForno.h"
+
+/* Testes do framebuffer, do display simulado e da tela do forno. O teste das
+ * atualizações típicas mede os bytes transferidos e o tempo de cada quadro, e
+ * grava as telas em DIRETORIO_DISPLAY. */
+
+#define DIRETORIO_DISPLAY       ".pio/display"
+#define REPETICOES              2000
+
+static framebuffer_t framebuffer;
+
+void setUp()
+{
+    framebuffer_init(&framebuffer);
+    display_init();
+}
+
+void tearDown()
+{
+}
+
+static void limpa()
+{
+    regiaoFramebuffer_t regiao;
+
+    while(framebuffer_proximaRegiao(&framebuffer, &regiao))
+    {
+    }
+}
+
+static void verificaDisplayIgual()
+{
+    TEST_ASSERT_EQUAL(0, memcmp(display_simulaMemoria(), framebuffer.pixels, sizeof(framebuffer.pixels)));
+}
+
+static void telaInicial(telaForno_t *tela)
+{
+    tela->modo = GRATINAR;
+    tela->ponto = AO_PONTO;
+    tela->status = ACAO_INICIADA;
+    tela->temperatura = 268;
+    tela->temperaturaAlvo = TEMPERATURA_GRATINAR;
+    tela->restante = 25;
+    tela->pausado = false;
+    tela->lotesNaFila = 2;
+}
+
+void test_pixelSoSujaQuandoMuda()
+{
+    regiaoFramebuffer_t regiao;
+
+    limpa();
+    framebuffer_pixel(&framebuffer, 10, 3, false);
+    TEST_ASSERT_FALSE(framebuffer_sujo(&framebuffer));
+
+    /* Dois pixels da mesma página formam um único retângulo */
+    framebuffer_pixel(&framebuffer, 100, 3, true);
+    framebuffer_pixel(&framebuffer, 10, 5, true);
+    framebuffer_pixel(&framebuffer, 5, FRAMEBUFFER_ALTURA, true);
+    TEST_ASSERT_TRUE(framebuffer_proximaRegiao(&framebuffer, &regiao));
+    TEST_ASSERT_EQUAL(0, regiao.pagina);
+    TEST_ASSERT_EQUAL(10, regiao.inicio);
+    TEST_ASSERT_EQUAL(101, regiao.fim);
+    TEST_ASSERT_EQUAL(0x20, regiao.dados[0]);
+    TEST_ASSERT_EQUAL(0x08, regiao.dados[90]);
+    TEST_ASSERT_FALSE(framebuffer_proximaRegiao(&framebuffer, &regiao));
+
+    framebuffer_pixel(&framebuffer, 0, 0, true);
+    framebuffer_pixel(&framebuffer, 127, 63, true);
+    TEST_ASSERT_TRUE(framebuffer_proximaRegiao(&framebuffer, &regiao));
+    TEST_ASSERT_EQUAL(0, regiao.pagina);
+    TEST_ASSERT_TRUE(framebuffer_proximaRegiao(&framebuffer, &regiao));
+    TEST_ASSERT_EQUAL(7, regiao.pagina);
+    TEST_ASSERT_EQUAL(127, regiao.inicio);
+    TEST_ASSERT_FALSE(framebuffer_proximaRegiao(&framebuffer, &regiao));
+}
+
+void test_textoIgualNaoSuja()
+{
+    TEST_ASSERT_EQUAL(5 * 2 * FRAMEBUFFER_LARGURA_CARACTERE, framebuffer_texto(&framebuffer, 0, 48, "12:34", 2));
+    limpa();
+    framebuffer_texto(&framebuffer, 0, 48, "12:34", 2);
+    TEST_ASSERT_FALSE(framebuffer_sujo(&framebuffer));
+    /* Minúsculas são desenhadas como maiúsculas */
+    framebuffer_texto(&framebuffer, 0, 0, "Assar", 1);
+    limpa();
+    framebuffer_texto(&framebuffer, 0, 0, "ASSAR", 1);
+    TEST_ASSERT_FALSE(framebuffer_sujo(&framebuffer));
+}
+
+void test_envioSincronizaDisplay()
+{
+    telaForno_t tela;
+
+    /* O primeiro envio transfere a tela inteira, uma região por página */
+    telaInicial(&tela);
+    telaForno_desenha(&framebuffer, &tela);
+    TEST_ASSERT_EQUAL(FRAMEBUFFER_PAGINAS * (DISPLAY_BYTES_COMANDO + FRAMEBUFFER_LARGURA),
+                      display_envia(&framebuffer));
+    verificaDisplayIgual();
+    TEST_ASSERT_EQUAL(0, display_envia(&framebuffer));
+
+    tela.restante = 24;
+    tela.temperatura = 271;
+    telaForno_desenha(&framebuffer, &tela);
+    TEST_ASSERT_TRUE(display_envia(&framebuffer) > 0);
+    verificaDisplayIgual();
+}
+
+typedef struct _atualizacao {
+    const char *nome;
+    uint32_t bytes;
+    double nsPorQuadro;
+} atualizacao_t;
+
+/* Mede uma atualização alternando a tela entre os estados a e b, que são
+ * desenhados e enviados REPETICOES vezes cada */
+static void mede(const char *nome, const telaForno_t *a, const telaForno_t *b, atualizacao_t *atualizacao)
+{
+    struct timespec inicio;
+    struct timespec fim;
+    uint32_t i = 0;
+
+    telaForno_desenha(&framebuffer, a);
+    display_envia(&framebuffer);
+    telaForno_desenha(&framebuffer, b);
+    atualizacao->nome = nome;
+    atualizacao->bytes = display_envia(&framebuffer);
+    verificaDisplayIgual();
+
+    clock_gettime(CLOCK_MONOTONIC, &inicio);
+    for(i = 0 ; i < REPETICOES ; i++)
+    {
+        telaForno_desenha(&framebuffer, (i % 2) ? b : a);
+        display_envia(&framebuffer);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &fim);
+    atualizacao->nsPorQuadro = ((double)(fim.tv_sec - inicio.tv_sec) * 1e9 +
+                                (double)(fim.tv_nsec - inicio.tv_nsec)) / REPETICOES;
+}
+
+static void gravaTela(const char *nome, const telaForno_t *tela)
+{
+    char caminho[64];
+    FILE *arquivo = NULL;
+
+    telaForno_desenha(&framebuffer, tela);
+    display_envia(&framebuffer);
+    snprintf(caminho, sizeof(caminho), DIRETORIO_DISPLAY "/%s.pbm", nome);
+    arquivo = fopen(caminho, "wb");
+    TEST_ASSERT_NOT_NULL(arquivo);
+    TEST_ASSERT_TRUE(display_gravaImagem(arquivo));
+    fclose(arquivo);
+}
+
+void test_atualizacoesTipicas()
+{
+    atualizacao_t atualizacoes[5];
+    telaForno_t vazia;
+    telaForno_t a;
+    telaForno_t b;
+    uint32_t i = 0;
+
+    memset(&vazia, 0, sizeof(vazia));
+    vazia.status = AGUARDANDO_ACAO;
+    telaInicial(&a);
+
+    /* Tela inteira: do forno parado ao forno em andamento */
+    mede("tela inteira", &vazia, &a, &atualizacoes[0]);
+    /* Contagem regressiva: muda só o último dígito */
+    b = a;
+    b.restante--;
+    mede("segundo restante", &a, &b, &atualizacoes[1]);
+    /* Temperatura: muda um dígito grande */
+    b = a;
+    b.temperatura++;
+    mede("temperatura", &a, &b, &atualizacoes[2]);
+    /* Segundo e temperatura juntos, o caso mais comum em andamento */
+    b.restante--;
+    mede("segundo e temperatura", &a, &b, &atualizacoes[3]);
+    /* Porta aberta */
+    b = a;
+    b.pausado = true;
+    mede("porta aberta", &a, &b, &atualizacoes[4]);
+
+    printf("%-24s %8s %14s %16s\n", "atualizacao", "bytes", "quadro (us)", "spi (us)");
+    for(i = 0 ; i < sizeof(atualizacoes) / sizeof(atualizacoes[0]) ; i++)
+    {
+        printf("%-24s %8u %14.2f %16.1f\n", atualizacoes[i].nome, atualizacoes[i].bytes,
+               atualizacoes[i].nsPorQuadro / 1000, atualizacoes[i].bytes * 8 * 1e6 / DISPLAY_SPI_HZ);
+    }
+
+    /* Mesmo a troca da tela inteira não envia as colunas que não mudaram */
+    TEST_ASSERT_TRUE(atualizacoes[0].bytes < FRAMEBUFFER_PAGINAS * (DISPLAY_BYTES_COMANDO + FRAMEBUFFER_LARGURA));
+    /* O dígito das unidades dos segundos ocupa no máximo 12 colunas em 2 páginas */
+    TEST_ASSERT_TRUE(atualizacoes[1].bytes <= 2 * (DISPLAY_BYTES_COMANDO + 12));
+    /* Um dígito da temperatura ocupa no máximo 18 colunas em 3 páginas */
+    TEST_ASSERT_TRUE(atualizacoes[2].bytes <= 3 * (DISPLAY_BYTES_COMANDO + 18));
+    /* Uma atualização comum durante o cozimento envia menos de 10% da tela */
+    TEST_ASSERT_TRUE(atualizacoes[3].bytes < FRAMEBUFFER_PAGINAS * (DISPLAY_BYTES_COMANDO + FRAMEBUFFER_LARGURA) / 10);
+
+    mkdir(".pio", 0755);
+    mkdir(DIRETORIO_DISPLAY, 0755);
+    gravaTela("parado", &vazia);
+    gravaTela("cozimento", &a);
+    gravaTela("porta", &b);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_pixelSoSujaQuandoMuda);
+    RUN_TEST(test_textoIgualNaoSuja);
+    RUN_TEST(test_envioSincronizaDisplay);
+    RUN_TEST(test_atualizacoesTipicas);
+    return UNITY_END();
+}
@@ -0,0 +1,192 @@
+#include <unity.h>
+#include "escalonadorPotencia.h"
+#include "../aleatorio.h"
+
+/* Testes do escalonador de potência das resistências */
+
+/* Duração de cada slot em ms, quando fixa */
+#define SLOT_MS     100
+
+static escalonador_t escalonador;
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_orcamentoNuncaExcedido()
+{
+    float potencia = 0;
+    uint32_t slot = 0;
+    uint32_t i = 0;
+
+    escalonador_init(&escalonador, 5000, 2, 3 * SLOT_MS);
+    for(i = 0 ; i < 12 ; i++)
+    {
+        TEST_ASSERT_EQUAL(i, escalonador_adicionaSaida(&escalonador, "r", 1000 + 250 * (i % 4)));
+    }
+
+    for(slot = 0 ; slot < 10000 ; slot++)
+    {
+        for(i = 0 ; i < escalonador.numeroDeSaidas ; i++)
+        {
+            escalonador_pede(&escalonador, i, (aleatorio() & 3) != 0);
+        }
+        escalonador_executa(&escalonador, SLOT_MS);
+
+        potencia = 0;
+        for(i = 0 ; i < escalonador.numeroDeSaidas ; i++)
+        {
+            /* Só é ligada uma resistência que pediu */
+            TEST_ASSERT_TRUE(!escalonador_ligada(&escalonador, i) || escalonador.saidas[i].pedido);
+            potencia += escalonador_ligada(&escalonador, i) ? escalonador.saidas[i].potencia : 0;
+        }
+        TEST_ASSERT_TRUE(potencia <= 5000);
+        TEST_ASSERT_TRUE(escalonador.potenciaAtual == potencia);
+    }
+    TEST_ASSERT_TRUE(escalonador.picoPotencia <= 5000);
+}
+
+void test_ligamentosEscalonados()
+{
+    uint32_t ligadas = 0;
+    uint32_t slot = 0;
+    uint32_t i = 0;
+
+    /* Sem limite de potência, oito resistências pedidas juntas ligam uma por
+     * slot */
+    escalonador_init(&escalonador, 1e9f, 1, 0);
+    for(i = 0 ; i < 8 ; i++)
+    {
+        escalonador_adicionaSaida(&escalonador, "r", 2000);
+        escalonador_pede(&escalonador, i, true);
+    }
+    for(slot = 1 ; slot <= 8 ; slot++)
+    {
+        escalonador_executa(&escalonador, SLOT_MS);
+        ligadas = 0;
+        for(i = 0 ; i < 8 ; i++)
+        {
+            ligadas += escalonador_ligada(&escalonador, i);
+        }
+        TEST_ASSERT_EQUAL(slot, ligadas);
+    }
+}
+
+void test_revezamentoJusto()
+{
+    uint32_t slotsLigada[3] = {0, 0, 0};
+    uint32_t slot = 0;
+    uint32_t i = 0;
+
+    /* Três resistências pedindo sempre, com potência para apenas uma */
+    escalonador_init(&escalonador, 2000, 1, 5 * SLOT_MS);
+    for(i = 0 ; i < 3 ; i++)
+    {
+        escalonador_adicionaSaida(&escalonador, "r", 2000);
+        escalonador_pede(&escalonador, i, true);
+    }
+    for(slot = 0 ; slot < 3000 ; slot++)
+    {
+        escalonador_executa(&escalonador, SLOT_MS);
+        for(i = 0 ; i < 3 ; i++)
+        {
+            slotsLigada[i] += escalonador_ligada(&escalonador, i);
+            /* Nenhuma espera mais que os turnos das outras duas */
+            TEST_ASSERT_TRUE(escalonador.saidas[i].espera <= 2 * 5 + 1);
+        }
+    }
+    for(i = 0 ; i < 3 ; i++)
+    {
+        TEST_ASSERT_UINT32_WITHIN(10, 1000, slotsLigada[i]);
+    }
+}
+
+void test_desligamentoImediato()
+{
+    escalonador_init(&escalonador, 4000, 1, 5 * SLOT_MS);
+    escalonador_adicionaSaida(&escalonador, "a", 2000);
+    escalonador_adicionaSaida(&escalonador, "b", 2000);
+    escalonador_pede(&escalonador, 0, true);
+    escalonador_executa(&escalonador, SLOT_MS);
+    TEST_ASSERT_TRUE(escalonador_ligada(&escalonador, 0));
+
+    /* O desligamento não espera o próximo slot nem o tempo mínimo */
+    escalonador_pede(&escalonador, 0, false);
+    TEST_ASSERT_FALSE(escalonador_ligada(&escalonador, 0));
+    TEST_ASSERT_TRUE(escalonador.potenciaAtual == 0);
+}
+
+/* Com slots de duração variável, como os da amostragem adaptativa, cada
+ * turno dura o tempo mínimo, e não um número fixo de slots, e a potência
+ * média é ponderada pela duração dos slots */
+void test_tempoMinimoComSlotsVariaveis()
+{
+    const uint32_t duracoes[] = {50, 100, 250, 500};
+    uint32_t tempoLigada[2] = {0, 0};
+    uint32_t turno = 0;
+    uint32_t duracao = 0;
+    uint32_t anterior = 0;
+    uint32_t atual = 0;
+    uint32_t slot = 0;
+    uint32_t i = 0;
+
+    /* Duas resistências pedindo sempre, com potência para apenas uma */
+    escalonador_init(&escalonador, 1000, 1, 500);
+    escalonador_adicionaSaida(&escalonador, "a", 1000);
+    escalonador_adicionaSaida(&escalonador, "b", 1000);
+    escalonador_pede(&escalonador, 0, true);
+    escalonador_pede(&escalonador, 1, true);
+
+    for(i = 0 ; i < 4 ; i++)
+    {
+        for(slot = 0 ; slot < 40 ; slot++)
+        {
+            duracao = duracoes[i];
+            escalonador_executa(&escalonador, duracao);
+            atual = escalonador_ligada(&escalonador, 0) ? 0 : 1;
+            TEST_ASSERT_TRUE(escalonador_ligada(&escalonador, atual));
+            TEST_ASSERT_FALSE(escalonador_ligada(&escalonador, 1 - atual));
+            if(atual != anterior)
+            {
+                /* Um turno encerrado durou pelo menos o tempo mínimo, e no
+                 * máximo um slot a mais que ele */
+                TEST_ASSERT_TRUE(turno >= 500);
+                TEST_ASSERT_TRUE(turno < 500 + duracao);
+                turno = 0;
+                anterior = atual;
+            }
+            turno += duracao;
+            tempoLigada[atual] += duracao;
+        }
+    }
+    TEST_ASSERT_UINT32_WITHIN(500, tempoLigada[0], tempoLigada[1]);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 1000.0f, escalonador_potenciaMedia(&escalonador));
+}
+
+void test_limiteDeSaidas()
+{
+    uint32_t i = 0;
+
+    escalonador_init(&escalonador, 1000, 1, 0);
+    for(i = 0 ; i < ESCALONADOR_MAX_SAIDAS ; i++)
+    {
+        TEST_ASSERT_EQUAL(i, escalonador_adicionaSaida(&escalonador, "r", 10));
+    }
+    TEST_ASSERT_EQUAL(-1, escalonador_adicionaSaida(&escalonador, "r", 10));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_orcamentoNuncaExcedido);
+    RUN_TEST(test_ligamentosEscalonados);
+    RUN_TEST(test_revezamentoJusto);
+    RUN_TEST(test_desligamentoImediato);
+    RUN_TEST(test_tempoMinimoComSlotsVariaveis);
+    RUN_TEST(test_limiteDeSaidas);
+    return UNITY_END();
+}
@@ -0,0 +1,92 @@
+#include <unity.h>
+#include "definitions.h"
+#include "filaLotes.h"
+
+/* Testes da fila de lotes e da interpretação dos comandos da serial */
+
+static filaLotes_t fila;
+
+void setUp()
+{
+    filaLotes_init(&fila);
+}
+
+void tearDown()
+{
+}
+
+void test_ordemDaFila()
+{
+    lote_t lote;
+    uint32_t i = 0;
+
+    TEST_ASSERT_FALSE(filaLotes_retira(&fila, &lote));
+
+    /* A fila dá várias voltas no buffer circular mantendo a ordem */
+    for(i = 0 ; i < 3 * FILA_LOTES_MAX ; i++)
+    {
+        lote.modo = (modo_t)(i % 3);
+        lote.ponto = (ponto_t)((i / 3) % 3);
+        TEST_ASSERT_TRUE(filaLotes_adiciona(&fila, &lote));
+        TEST_ASSERT_TRUE(filaLotes_proximo(&fila, &lote));
+        TEST_ASSERT_TRUE(filaLotes_retira(&fila, &lote));
+        TEST_ASSERT_EQUAL(i % 3, lote.modo);
+        TEST_ASSERT_EQUAL((i / 3) % 3, lote.ponto);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, fila.tamanho);
+}
+
+void test_filaCheia()
+{
+    lote_t lote = {GRELHAR, BEM_PASSADO};
+    uint32_t i = 0;
+
+    for(i = 0 ; i < FILA_LOTES_MAX ; i++)
+    {
+        TEST_ASSERT_TRUE(filaLotes_adiciona(&fila, &lote));
+    }
+    TEST_ASSERT_FALSE(filaLotes_adiciona(&fila, &lote));
+    TEST_ASSERT_EQUAL_UINT32(FILA_LOTES_MAX, fila.tamanho);
+}
+
+void test_comandosValidos()
+{
+    lote_t lote;
+
+    TEST_ASSERT_TRUE(filaLotes_interpretaComando("assar bem_passado", &lote));
+    TEST_ASSERT_EQUAL(ASSAR, lote.modo);
+    TEST_ASSERT_EQUAL(BEM_PASSADO, lote.ponto);
+
+    TEST_ASSERT_TRUE(filaLotes_interpretaComando("  GRELHAR\tAo_Ponto \r", &lote));
+    TEST_ASSERT_EQUAL(GRELHAR, lote.modo);
+    TEST_ASSERT_EQUAL(AO_PONTO, lote.ponto);
+
+    TEST_ASSERT_TRUE(filaLotes_interpretaComando("gratinar mal_passado", &lote));
+    TEST_ASSERT_EQUAL(GRATINAR, lote.modo);
+    TEST_ASSERT_EQUAL(MAL_PASSADO, lote.ponto);
+}
+
+void test_comandosInvalidos()
+{
+    lote_t lote = {ASSAR, AO_PONTO};
+
+    TEST_ASSERT_FALSE(filaLotes_interpretaComando("", &lote));
+    TEST_ASSERT_FALSE(filaLotes_interpretaComando("assar", &lote));
+    TEST_ASSERT_FALSE(filaLotes_interpretaComando("fritar ao_ponto", &lote));
+    TEST_ASSERT_FALSE(filaLotes_interpretaComando("assar ao_ponto agora", &lote));
+    TEST_ASSERT_FALSE(filaLotes_interpretaComando("assar ao_pontooooooooooooooooo", &lote));
+
+    /* Um comando inválido não altera o lote */
+    TEST_ASSERT_EQUAL(ASSAR, lote.modo);
+    TEST_ASSERT_EQUAL(AO_PONTO, lote.ponto);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_ordemDaFila);
+    RUN_TEST(test_filaCheia);
+    RUN_TEST(test_comandosValidos);
+    RUN_TEST(test_comandosInvalidos);
+    return UNITY_END();
+}
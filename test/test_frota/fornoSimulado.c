@@ -0,0 +1,391 @@
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include "fornoSimulado.h"
+#include "termopar.h"
+
+/* Este arquivo simula fornos completos no host: cada fornoSimulado_t liga uma
+ * instância de forno.c a um modelo térmico simples do forno através do
+ * halForno_t, e a frota executa muitas instâncias em paralelo, dividindo-as
+ * entre várias threads. */
+
+/* Tasks, fila e timer do firmware representados no rastreio. Cada string é
+ * também o identificador da task ou do objeto. */
+static const char TAREFA_ADC_READ[] = "adcRead";
+static const char TAREFA_OUTPUT_CONTROL[] = "OutputControl";
+static const char TAREFA_ESP_TIMER[] = "esp_timer";
+static const char TAREFA_FINALIZA[] = "finalizaCozimento";
+static const char FILA_ADC[] = "adc_queue";
+static const char TIMER_TEMPO[] = "tempo de funcionamento";
+
+static double relogioNs(clockid_t relogio)
+{
+    struct timespec ts;
+
+    clock_gettime(relogio, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int64_t simAgora(void *contexto)
+{
+    return ((fornoSimulado_t *)contexto)->agora;
+}
+
+/* LM35: 10mV/°C, escala de 3.3V em 12 bits, com ruído de ±4 LSB */
+static void simLeAdc(void *contexto, uint16_t *amostras, uint32_t n)
+{
+    fornoSimulado_t *simulado = (fornoSimulado_t *)contexto;
+    int32_t base = (int32_t)(simulado->temperatura * 0.010f / 3.3f * 4095);
+    uint32_t i = 0;
+
+    for(i = 0 ; i < n ; i++)
+    {
+        simulado->semente = simulado->semente * 1103515245u + 12345u;
+        amostras[i] = (uint16_t)(base + (int32_t)((simulado->semente >> 16) % 9) - 4);
+    }
+}
+
+static bool simLeTermopar(void *contexto, uint16_t *quadro)
+{
+    *quadro = termopar_simulaQuadro(((fornoSimulado_t *)contexto)->temperatura, false);
+    return true;
+}
+
+static void aplicaResistencia(fornoSimulado_t *simulado, bool nivel)
+{
+    if(nivel != simulado->resistencia)
+    {
+        simulado->chaveamentos++;
+    }
+    simulado->resistencia = nivel;
+}
+
+/* Com um escalonador de potência, como no firmware, o pedido de ligar só é
+ * aplicado por fornoSimulado_aplicaEscalonador, e desligar é imediato */
+static void simResistencia(void *contexto, bool nivel)
+{
+    fornoSimulado_t *simulado = (fornoSimulado_t *)contexto;
+
+    if(simulado->escalonador == NULL)
+    {
+        aplicaResistencia(simulado, nivel);
+        return;
+    }
+    escalonador_pede(simulado->escalonador, simulado->saida, nivel);
+    if(!nivel)
+    {
+        aplicaResistencia(simulado, false);
+    }
+}
+
+static void simLedsModo(void *contexto, modo_t modo)
+{
+}
+
+static void simLedsPonto(void *contexto, ponto_t ponto)
+{
+}
+
+/* Cria um forno parado à temperatura ambiente, seleciona o modo e o ponto
+ * pelos botões e inicia o cozimento */
+void fornoSimulado_init(fornoSimulado_t *simulado, modo_t modo, ponto_t ponto, uint32_t semente)
+{
+    halForno_t hal = {
+        .contexto = simulado,
+        .agora = simAgora,
+        .leAdc = simLeAdc,
+        .leTermopar = simLeTermopar,
+        .resistencia = simResistencia,
+        .ledsModo = simLedsModo,
+        .ledsPonto = simLedsPonto,
+    };
+    uint32_t i = 0;
+
+    simulado->agora = 0;
+    simulado->temperatura = 25.0f;
+    simulado->semente = semente;
+    simulado->taxaAquecimento = 6.0f + (float)(semente % 16) * 0.125f;
+    simulado->resistencia = false;
+    simulado->portaAberta = false;
+    simulado->chaveamentos = 0;
+    simulado->periodos = 0;
+    simulado->temperaturaMaxima = simulado->temperatura;
+    simulado->concluido = false;
+    simulado->escalonador = NULL;
+    simulado->saida = 0;
+    simulado->rastreio = NULL;
+    simulado->instanteRastreio = 0;
+
+    forno_init(&simulado->forno, &hal);
+    /* Os fornos simulados avançam juntos, um período por vez, então o período
+     * é fixo, a não ser com fornoSimulado_usaAmostragemAdaptativa */
+    amostragem_init(&simulado->forno.amostragem, PERIODO_LEITURA_MS, PERIODO_LEITURA_MS);
+
+    /* O primeiro toque de cada botão escolhe o primeiro valor da lista */
+    for(i = 0 ; i <= (uint32_t)modo ; i++)
+    {
+        forno_selecionaModo(&simulado->forno);
+    }
+    for(i = 0 ; i <= (uint32_t)ponto ; i++)
+    {
+        forno_selecionaPonto(&simulado->forno);
+    }
+    forno_inicia(&simulado->forno);
+}
+
+/* Simula um reset do controlador: forno.c volta ao estado inicial, com a
+ * resistência desligada, enquanto o modelo térmico e o relógio continuam */
+void fornoSimulado_reinicia(fornoSimulado_t *simulado)
+{
+    halForno_t hal = simulado->forno.hal;
+    amostragem_t amostragem = simulado->forno.amostragem;
+
+    aplicaResistencia(simulado, false);
+    forno_init(&simulado->forno, &hal);
+    amostragem_init(&simulado->forno.amostragem, amostragem.periodoMinimoMs, amostragem.periodoMaximoMs);
+}
+
+/* Com um rastreio, o forno simulado registra a execução das tasks do
+ * firmware que ele representa. Cada task começa no instante simulado em que o
+ * firmware a executaria e dura o tempo que o host levou para executar o seu
+ * trabalho, então o rastreio mostra onde o tempo de cada período é gasto. */
+static double rastreiaEntrada(fornoSimulado_t *simulado, const char *tarefa)
+{
+    rastreio_t *rastreio = simulado->rastreio;
+
+    if(rastreio == NULL)
+    {
+        return 0;
+    }
+    rastreio_registra(rastreio, simulado->instanteRastreio, RASTREIO_ENTRA, 0,
+                      rastreio_tarefa(rastreio, tarefa, tarefa, simulado->instanteRastreio), 0);
+    return relogioNs(CLOCK_MONOTONIC);
+}
+
+/* O objeto de RASTREIO_NOTIFICA é a task notificada, e dos demais uma fila
+ * ou um timer */
+static void rastreiaEvento(fornoSimulado_t *simulado, const char *tarefa, double entrada, tipoRastreio_t tipo,
+                           const char *objeto)
+{
+    rastreio_t *rastreio = simulado->rastreio;
+    int64_t instante = 0;
+
+    if(rastreio == NULL)
+    {
+        return;
+    }
+    instante = simulado->instanteRastreio + (int64_t)(relogioNs(CLOCK_MONOTONIC) - entrada);
+    rastreio_registra(rastreio, instante, tipo, 0, rastreio_tarefa(rastreio, tarefa, tarefa, instante),
+                      (tipo == RASTREIO_NOTIFICA) ? rastreio_tarefa(rastreio, objeto, objeto, instante) :
+                                                    rastreio_objeto(rastreio, objeto, objeto));
+}
+
+static void rastreiaSaida(fornoSimulado_t *simulado, const char *tarefa, double entrada)
+{
+    rastreio_t *rastreio = simulado->rastreio;
+
+    if(rastreio == NULL)
+    {
+        return;
+    }
+    simulado->instanteRastreio += (int64_t)(relogioNs(CLOCK_MONOTONIC) - entrada);
+    rastreio_registra(rastreio, simulado->instanteRastreio, RASTREIO_SAI, 0,
+                      rastreio_tarefa(rastreio, tarefa, tarefa, simulado->instanteRastreio), 0);
+}
+
+/* Simula um período de leitura, com a duração escolhida pelo forno na
+ * leitura anterior: o modelo térmico avança, e o forno faz o
+ * trabalho das tasks adcRead, OutputControl e finalizaCozimento, que só
+ * executam durante um lote ou entre dois lotes */
+void fornoSimulado_periodo(fornoSimulado_t *simulado)
+{
+    leitura_t leitura;
+    uint32_t periodoMs = forno_periodoLeituraMs(&simulado->forno);
+    float dt = periodoMs / 1000.0f;
+    float perda = simulado->portaAberta ? 0.03f : 0.003f;
+    double entrada = 0;
+    bool pronta = false;
+
+    simulado->agora += (int64_t)periodoMs * 1000;
+    simulado->periodos++;
+    simulado->temperatura += dt * ((simulado->resistencia ? simulado->taxaAquecimento : 0.0f) -
+                                   perda * (simulado->temperatura - 25.0f));
+    if(simulado->temperatura > simulado->temperaturaMaxima)
+    {
+        simulado->temperaturaMaxima = simulado->temperatura;
+    }
+
+    if(simulado->forno.status == AGUARDANDO_ACAO)
+    {
+        return;
+    }
+    simulado->instanteRastreio = simulado->agora * 1000;
+
+    entrada = rastreiaEntrada(simulado, TAREFA_ADC_READ);
+    pronta = forno_leSensores(&simulado->forno, &leitura);
+    if(pronta)
+    {
+        rastreiaEvento(simulado, TAREFA_ADC_READ, entrada, RASTREIO_FILA_ENVIA, FILA_ADC);
+    }
+    rastreiaSaida(simulado, TAREFA_ADC_READ, entrada);
+
+    if(pronta)
+    {
+        entrada = rastreiaEntrada(simulado, TAREFA_OUTPUT_CONTROL);
+        rastreiaEvento(simulado, TAREFA_OUTPUT_CONTROL, entrada, RASTREIO_FILA_RECEBE, FILA_ADC);
+        forno_controla(&simulado->forno, &leitura, false);
+        rastreiaSaida(simulado, TAREFA_OUTPUT_CONTROL, entrada);
+    }
+
+    if(simulado->forno.status == ACAO_INICIADA && forno_restante(&simulado->forno) == 0)
+    {
+        entrada = rastreiaEntrada(simulado, TAREFA_ESP_TIMER);
+        rastreiaEvento(simulado, TAREFA_ESP_TIMER, entrada, RASTREIO_TIMER, TIMER_TEMPO);
+        rastreiaEvento(simulado, TAREFA_ESP_TIMER, entrada, RASTREIO_NOTIFICA, TAREFA_FINALIZA);
+        rastreiaSaida(simulado, TAREFA_ESP_TIMER, entrada);
+
+        entrada = rastreiaEntrada(simulado, TAREFA_FINALIZA);
+        forno_verificaFim(&simulado->forno);
+        simulado->concluido = true;
+        rastreiaSaida(simulado, TAREFA_FINALIZA, entrada);
+    }
+}
+
+/* Passa a acionar a resistência do forno através de uma saída do escalonador */
+void fornoSimulado_usaEscalonador(fornoSimulado_t *simulado, escalonador_t *escalonador, float potencia)
+{
+    simulado->escalonador = escalonador;
+    simulado->saida = (uint32_t)escalonador_adicionaSaida(escalonador, NULL, potencia);
+}
+
+/* Aplica a decisão do escalonador depois de escalonador_executa, como a task
+ * OutputControl */
+void fornoSimulado_aplicaEscalonador(fornoSimulado_t *simulado)
+{
+    bool nivel = escalonador_ligada(simulado->escalonador, simulado->saida);
+
+    aplicaResistencia(simulado, nivel);
+    forno_confirmaResistencia(&simulado->forno, nivel);
+}
+
+/* Passa a escolher o período de cada leitura como o firmware
+ * (amostragemAdaptativa.c). Cada período simulado passa a ter a duração
+ * escolhida pelo forno na leitura anterior. */
+void fornoSimulado_usaAmostragemAdaptativa(fornoSimulado_t *simulado)
+{
+    amostragem_init(&simulado->forno.amostragem, AMOSTRAGEM_PERIODO_MIN_MS, AMOSTRAGEM_PERIODO_MAX_MS);
+}
+
+/* Passa a registrar as tasks simuladas do forno em rastreio */
+void fornoSimulado_rastreia(fornoSimulado_t *simulado, rastreio_t *rastreio)
+{
+    simulado->rastreio = rastreio;
+}
+
+/* Abre ou fecha a porta, como a task porta. Entre dois lotes, fechar a porta
+ * depois de aberta inicia o próximo lote. */
+void fornoSimulado_porta(fornoSimulado_t *simulado, bool aberta)
+{
+    simulado->portaAberta = aberta;
+    forno_porta(&simulado->forno, aberta);
+    forno_iniciaProximo(&simulado->forno);
+}
+
+/* Simula até o fim do cozimento, ou até maximoDePeriodos */
+void fornoSimulado_executa(fornoSimulado_t *simulado, uint32_t maximoDePeriodos)
+{
+    while(!simulado->concluido && simulado->periodos < maximoDePeriodos)
+    {
+        fornoSimulado_periodo(simulado);
+    }
+}
+
+/* A frota inteira é criada em uma única alocação. Os fornos alternam entre
+ * os modos e pontos, e cada um recebe uma semente diferente. */
+bool frota_cria(frota_t *frota, uint32_t numeroDeFornos)
+{
+    uint32_t i = 0;
+
+    frota->fornos = malloc(sizeof(fornoSimulado_t) * numeroDeFornos);
+    frota->numeroDeFornos = (frota->fornos != NULL) ? numeroDeFornos : 0;
+    for(i = 0 ; i < frota->numeroDeFornos ; i++)
+    {
+        fornoSimulado_init(&frota->fornos[i], (modo_t)(i % 3), (ponto_t)((i / 3) % 3), i + 1);
+    }
+    return frota->fornos != NULL;
+}
+
+void frota_destroi(frota_t *frota)
+{
+    free(frota->fornos);
+    frota->fornos = NULL;
+    frota->numeroDeFornos = 0;
+}
+
+typedef struct _trabalhoFrota {
+    fornoSimulado_t *fornos;
+    uint32_t numeroDeFornos;
+    uint32_t maximoDePeriodos;
+    double tempoCpu;
+    uint64_t periodos;
+} trabalhoFrota_t;
+
+/* Cada thread executa um bloco contíguo de fornos, um cozimento inteiro de
+ * cada vez. Como os fornos são independentes, a ordem não altera o resultado
+ * e o estado de cada um fica no cache durante todo o seu cozimento. */
+static void *executaTrabalho(void *parametro)
+{
+    trabalhoFrota_t *trabalho = (trabalhoFrota_t *)parametro;
+    double inicio = relogioNs(CLOCK_THREAD_CPUTIME_ID);
+    uint32_t i = 0;
+
+    trabalho->periodos = 0;
+    for(i = 0 ; i < trabalho->numeroDeFornos ; i++)
+    {
+        fornoSimulado_executa(&trabalho->fornos[i], trabalho->maximoDePeriodos);
+        trabalho->periodos += trabalho->fornos[i].periodos;
+    }
+    trabalho->tempoCpu = relogioNs(CLOCK_THREAD_CPUTIME_ID) - inicio;
+    return NULL;
+}
+
+bool frota_executa(frota_t *frota, uint32_t numeroDeThreads, uint32_t maximoDePeriodos,
+                   resultadoFrota_t *resultado)
+{
+    pthread_t *threads = malloc(sizeof(pthread_t) * numeroDeThreads);
+    trabalhoFrota_t *trabalhos = malloc(sizeof(trabalhoFrota_t) * numeroDeThreads);
+    double inicio = 0;
+    uint32_t primeiro = 0;
+    uint32_t i = 0;
+    bool sucesso = (threads != NULL && trabalhos != NULL);
+
+    resultado->tempoReal = 0;
+    resultado->tempoCpu = 0;
+    resultado->periodos = 0;
+
+    inicio = relogioNs(CLOCK_MONOTONIC);
+    for(i = 0 ; sucesso && i < numeroDeThreads ; i++)
+    {
+        primeiro = (uint32_t)((uint64_t)frota->numeroDeFornos * i / numeroDeThreads);
+        trabalhos[i].fornos = &frota->fornos[primeiro];
+        trabalhos[i].numeroDeFornos = (uint32_t)((uint64_t)frota->numeroDeFornos * (i + 1) / numeroDeThreads) - primeiro;
+        trabalhos[i].maximoDePeriodos = maximoDePeriodos;
+        if(pthread_create(&threads[i], NULL, executaTrabalho, &trabalhos[i]) != 0)
+        {
+            sucesso = false;
+            break;
+        }
+    }
+    numeroDeThreads = i;
+    for(i = 0 ; i < numeroDeThreads ; i++)
+    {
+        pthread_join(threads[i], NULL);
+        resultado->tempoCpu += trabalhos[i].tempoCpu;
+        resultado->periodos += trabalhos[i].periodos;
+    }
+    resultado->tempoReal = relogioNs(CLOCK_MONOTONIC) - inicio;
+
+    free(threads);
+    free(trabalhos);
+    return sucesso;
+}
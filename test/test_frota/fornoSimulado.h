@@ -0,0 +1,59 @@
+#ifndef FORNOSIMULADO_H
+#define FORNOSIMULADO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "forno.h"
+#include "escalonadorPotencia.h"
+#include "rastreioTarefas.h"
+
+/* Um forno simulado: a instância de forno.c e o modelo térmico que faz o
+ * papel do hardware através do halForno_t. Cada instância tem o seu próprio
+ * relógio e gerador de ruído, então instâncias diferentes não compartilham
+ * nenhum estado. */
+typedef struct _fornoSimulado {
+    forno_t forno;
+    int64_t agora;              /* Relógio simulado em us                   */
+    float temperatura;          /* Temperatura real do forno em °C          */
+    float taxaAquecimento;      /* °C/s com a resistência ligada            */
+    bool resistencia;           /* Nível atual da saída da resistência      */
+    bool portaAberta;           /* A porta aberta aumenta a perda de calor  */
+    uint32_t semente;           /* Gerador do ruído do LM35                 */
+    uint32_t chaveamentos;      /* Mudanças da saída da resistência         */
+    uint32_t periodos;          /* Períodos de leitura simulados            */
+    float temperaturaMaxima;
+    bool concluido;             /* O cozimento terminou                     */
+    escalonador_t *escalonador; /* Escalonador de potência, se houver       */
+    uint32_t saida;             /* Saída do forno no escalonador            */
+    rastreio_t *rastreio;       /* Rastreio das tasks simuladas, se houver  */
+    int64_t instanteRastreio;   /* Instante do próximo evento em ns         */
+} fornoSimulado_t;
+
+/* Um conjunto de fornos simulados, executado por várias threads */
+typedef struct _frota {
+    fornoSimulado_t *fornos;
+    uint32_t numeroDeFornos;
+} frota_t;
+
+typedef struct _resultadoFrota {
+    double tempoReal;           /* Duração da execução em ns                */
+    double tempoCpu;            /* Tempo de CPU somado de todas as threads  */
+    uint64_t periodos;          /* Períodos simulados somados               */
+} resultadoFrota_t;
+
+extern void fornoSimulado_init(fornoSimulado_t *simulado, modo_t modo, ponto_t ponto, uint32_t semente);
+extern void fornoSimulado_reinicia(fornoSimulado_t *simulado);
+extern void fornoSimulado_periodo(fornoSimulado_t *simulado);
+extern void fornoSimulado_usaEscalonador(fornoSimulado_t *simulado, escalonador_t *escalonador, float potencia);
+extern void fornoSimulado_aplicaEscalonador(fornoSimulado_t *simulado);
+extern void fornoSimulado_usaAmostragemAdaptativa(fornoSimulado_t *simulado);
+extern void fornoSimulado_rastreia(fornoSimulado_t *simulado, rastreio_t *rastreio);
+extern void fornoSimulado_porta(fornoSimulado_t *simulado, bool aberta);
+extern void fornoSimulado_executa(fornoSimulado_t *simulado, uint32_t maximoDePeriodos);
+
+extern bool frota_cria(frota_t *frota, uint32_t numeroDeFornos);
+extern void frota_destroi(frota_t *frota);
+extern bool frota_executa(frota_t *frota, uint32_t numeroDeThreads, uint32_t maximoDePeriodos,
+                          resultadoFrota_t *resultado);
+
+#endif /* FORNOSIMULADO_H */
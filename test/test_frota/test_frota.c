@@ -0,0 +1,825 @@
+#include <stdio.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <unity.h>
+#include "definitions.h"
+#include "parametrosCozimento.h"
+#include "forno.h"
+#include "fornoSimulado.h"
+#include "salvamentoCozimento.h"
+
+/* Testes das instâncias de forno.c e da simulação de uma frota de fornos.
+ * O teste de escalabilidade grava o seu relatório em ARQUIVO_ESCALABILIDADE,
+ * e o rastreio das tasks de um cozimento é gravado em ARQUIVO_RASTREIO. */
+
+#define DIRETORIO_FROTA             ".pio/frota"
+#define ARQUIVO_ESCALABILIDADE      DIRETORIO_FROTA "/escalabilidade.json"
+#define ARQUIVO_RASTREIO            DIRETORIO_FROTA "/rastreio.json"
+
+/* O cozimento mais longo, BEM_PASSADO, com folga */
+#define MAXIMO_DE_PERIODOS          (TEMPO_BEM_PASSADO / PERIODO_LEITURA_MS + 10)
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+/* Compara o que o cozimento de dois fornos simulados produziu. As
+ * temperaturas devem ser exatamente iguais, e não apenas próximas. */
+static void comparaFornos(const fornoSimulado_t *a, const fornoSimulado_t *b)
+{
+    TEST_ASSERT_EQUAL_UINT32(a->periodos, b->periodos);
+    TEST_ASSERT_EQUAL_UINT32(a->chaveamentos, b->chaveamentos);
+    TEST_ASSERT_TRUE(a->temperatura == b->temperatura);
+    TEST_ASSERT_TRUE(a->forno.controle.temperaturaAtual == b->forno.controle.temperaturaAtual);
+    TEST_ASSERT_EQUAL(a->concluido, b->concluido);
+}
+
+void test_cozimentoCompleto()
+{
+    fornoSimulado_t simulado;
+
+    fornoSimulado_init(&simulado, ASSAR, BEM_PASSADO, 7);
+    TEST_ASSERT_EQUAL(ASSAR, simulado.forno.modo);
+    TEST_ASSERT_EQUAL(BEM_PASSADO, simulado.forno.ponto);
+    TEST_ASSERT_EQUAL(ACAO_INICIADA, simulado.forno.status);
+
+    /* Com um cozimento em andamento os botões de seleção são ignorados */
+    TEST_ASSERT_FALSE(forno_selecionaModo(&simulado.forno));
+    TEST_ASSERT_FALSE(forno_selecionaPonto(&simulado.forno));
+    TEST_ASSERT_EQUAL_INT64(0, forno_inicia(&simulado.forno));
+
+    fornoSimulado_executa(&simulado, MAXIMO_DE_PERIODOS);
+    TEST_ASSERT_TRUE(simulado.concluido);
+    TEST_ASSERT_EQUAL_UINT32(TEMPO_BEM_PASSADO / PERIODO_LEITURA_MS, simulado.periodos);
+    TEST_ASSERT_EQUAL(AGUARDANDO_ACAO, simulado.forno.status);
+    TEST_ASSERT_FALSE(simulado.resistencia);
+
+    /* A temperatura alvo foi atingida e mantida pelo liga/desliga */
+    TEST_ASSERT_TRUE(simulado.chaveamentos > 2);
+    TEST_ASSERT_FLOAT_WITHIN(5.0f, TEMPERATURA_ASSAR, simulado.temperaturaMaxima);
+}
+
+/* Duas instâncias executadas intercaladas devem produzir exatamente o mesmo
+ * que cada uma executada sozinha, o que não aconteceria se forno.c guardasse
+ * algum estado fora do forno_t */
+void test_instanciasIndependentes()
+{
+    fornoSimulado_t sozinhos[2];
+    fornoSimulado_t intercalados[2];
+    uint32_t i = 0;
+
+    fornoSimulado_init(&sozinhos[0], ASSAR, BEM_PASSADO, 11);
+    fornoSimulado_init(&sozinhos[1], GRELHAR, AO_PONTO, 12);
+    fornoSimulado_executa(&sozinhos[0], MAXIMO_DE_PERIODOS);
+    fornoSimulado_executa(&sozinhos[1], MAXIMO_DE_PERIODOS);
+
+    fornoSimulado_init(&intercalados[0], ASSAR, BEM_PASSADO, 11);
+    fornoSimulado_init(&intercalados[1], GRELHAR, AO_PONTO, 12);
+    for(i = 0 ; i < MAXIMO_DE_PERIODOS ; i++)
+    {
+        fornoSimulado_executa(&intercalados[0], i + 1);
+        fornoSimulado_executa(&intercalados[1], i + 1);
+    }
+
+    comparaFornos(&sozinhos[0], &intercalados[0]);
+    comparaFornos(&sozinhos[1], &intercalados[1]);
+    TEST_ASSERT_EQUAL(GRELHAR, intercalados[1].forno.modo);
+    TEST_ASSERT_TRUE(intercalados[0].periodos != intercalados[1].periodos);
+}
+
+/* A mesma frota executada por uma ou várias threads chega ao mesmo estado */
+void test_frotaDeterministica()
+{
+    frota_t umaThread;
+    frota_t variasThreads;
+    resultadoFrota_t resultado;
+    uint32_t i = 0;
+
+    TEST_ASSERT_TRUE(frota_cria(&umaThread, 300));
+    TEST_ASSERT_TRUE(frota_cria(&variasThreads, 300));
+    TEST_ASSERT_TRUE(frota_executa(&umaThread, 1, MAXIMO_DE_PERIODOS, &resultado));
+    TEST_ASSERT_TRUE(frota_executa(&variasThreads, 7, MAXIMO_DE_PERIODOS, &resultado));
+
+    for(i = 0 ; i < umaThread.numeroDeFornos ; i++)
+    {
+        TEST_ASSERT_TRUE(umaThread.fornos[i].concluido);
+        comparaFornos(&umaThread.fornos[i], &variasThreads.fornos[i]);
+    }
+    frota_destroi(&umaThread);
+    frota_destroi(&variasThreads);
+}
+
+/* Resultado de uma hora de produção simulada */
+typedef struct _producao {
+    uint32_t lotes;                 /* Lotes concluídos                         */
+    float deficitMedio;             /* °C·s abaixo do alvo por lote             */
+    float temperaturaInicialMedia;  /* Temperatura no início de cada lote       */
+} producao_t;
+
+#define UMA_HORA_US                 3600000000LL
+#define TEMPO_REACAO_US             15000000LL  /* Do fim do lote até abrir a porta */
+#define TEMPO_CARGA_US              8000000LL   /* Porta aberta para trocar o lote  */
+#define TEMPO_BOTOES_US             3000000LL   /* Selecionar modo e ponto e start  */
+
+/* Simula uma hora de lotes de ASSAR AO_PONTO em sequência. O operador abre a
+ * porta TEMPO_REACAO_US depois do fim de cada lote, troca o alimento em
+ * TEMPO_CARGA_US e fecha a porta.
+ * Com a fila, todos os lotes são enviados de uma vez e o próximo começa ao
+ * fechar a porta. Sem ela, como antes da fila, o forno para ao fim do lote e
+ * o operador precisa selecionar o lote e pressionar start a cada vez. */
+static void simulaProducao(bool comFila, producao_t *producao)
+{
+    fornoSimulado_t simulado;
+    int64_t proximaAcao = 0;
+    int64_t inicioLote = 0;
+    float deficit = 0;
+    float somaTemperaturaInicial = 0;
+    bool emLote = false;
+    bool aguardandoOperador = false;
+    uint32_t i = 0;
+
+    /* O forno começa frio, parado e com o primeiro lote já dentro */
+    fornoSimulado_init(&simulado, ASSAR, AO_PONTO, 3);
+    simulado.forno.status = AGUARDANDO_ACAO;
+    sessao_encerra(&simulado.forno.sessao);
+    filaLotes_init(&simulado.forno.fila);
+    if(comFila)
+    {
+        for(i = 0 ; i < FILA_LOTES_MAX ; i++)
+        {
+            forno_adicionaLote(&simulado.forno, ASSAR, AO_PONTO);
+        }
+        /* O primeiro lote entra quando o forno atinge a temperatura */
+        while(simulado.forno.controle.temperaturaAtual < TEMPERATURA_ASSAR - 5)
+        {
+            fornoSimulado_periodo(&simulado);
+        }
+        fornoSimulado_porta(&simulado, true);
+        fornoSimulado_porta(&simulado, false);
+    }
+    else
+    {
+        forno_inicia(&simulado.forno);
+    }
+    simulado.agora = 0;
+
+    while(simulado.agora < UMA_HORA_US)
+    {
+        if(simulado.forno.status == ACAO_INICIADA)
+        {
+            if(!emLote)
+            {
+                emLote = true;
+                inicioLote = simulado.agora;
+                somaTemperaturaInicial += simulado.temperatura;
+            }
+            if(simulado.temperatura < TEMPERATURA_ASSAR - 5)
+            {
+                deficit += (TEMPERATURA_ASSAR - 5 - simulado.temperatura) * (PERIODO_LEITURA_MS / 1000.0f);
+            }
+        }
+        fornoSimulado_periodo(&simulado);
+
+        /* Fim do lote: o operador vem abrir a porta para a troca */
+        if(emLote && simulado.forno.status != ACAO_INICIADA)
+        {
+            emLote = false;
+            aguardandoOperador = true;
+            TEST_ASSERT_TRUE(simulado.agora - inicioLote >= TEMPO_AO_PONTO * 1000LL);
+            proximaAcao = simulado.agora + TEMPO_REACAO_US;
+
+            /* A fila é reposta para que a produção não acabe dentro da hora */
+            if(comFila)
+            {
+                forno_adicionaLote(&simulado.forno, ASSAR, AO_PONTO);
+            }
+        }
+        else if(aguardandoOperador && simulado.agora >= proximaAcao)
+        {
+            aguardandoOperador = false;
+            fornoSimulado_porta(&simulado, true);
+            proximaAcao = simulado.agora + TEMPO_CARGA_US;
+        }
+        else if(simulado.portaAberta && simulado.agora >= proximaAcao)
+        {
+            fornoSimulado_porta(&simulado, false);
+            proximaAcao = simulado.agora + TEMPO_BOTOES_US;
+        }
+        else if(!comFila && simulado.forno.status == AGUARDANDO_ACAO && !simulado.portaAberta &&
+                simulado.agora >= proximaAcao)
+        {
+            forno_inicia(&simulado.forno);
+        }
+    }
+
+    producao->lotes = simulado.forno.lotesConcluidos;
+    producao->deficitMedio = deficit / (float)producao->lotes;
+    producao->temperaturaInicialMedia = somaTemperaturaInicial / (float)producao->lotes;
+}
+
+void test_lotesPorHora()
+{
+    producao_t manual;
+    producao_t fila;
+
+    simulaProducao(false, &manual);
+    simulaProducao(true, &fila);
+    printf("%-12s %12s %22s %24s\n", "", "lotes/hora", "deficit/lote (C.s)", "temperatura inicial (C)");
+    printf("%-12s %12u %22.0f %24.1f\n", "sem fila", manual.lotes, manual.deficitMedio,
+           manual.temperaturaInicialMedia);
+    printf("%-12s %12u %22.0f %24.1f\n", "com fila", fila.lotes, fila.deficitMedio, fila.temperaturaInicialMedia);
+
+    /* Com a fila não há a seleção manual entre lotes, e a temperatura é
+     * mantida durante a troca, então cada lote começa mais quente e passa
+     * menos tempo abaixo do alvo */
+    TEST_ASSERT_TRUE(fila.lotes > manual.lotes);
+    TEST_ASSERT_TRUE(fila.temperaturaInicialMedia > manual.temperaturaInicialMedia + 5);
+    TEST_ASSERT_TRUE(fila.deficitMedio < manual.deficitMedio / 2);
+}
+
+/* Lotes adicionados durante um cozimento esperam a sua vez, e entre dois
+ * lotes o forno mantém a temperatura do próximo até ele ser carregado */
+void test_filaDeLotes()
+{
+    fornoSimulado_t simulado;
+    uint32_t i = 0;
+
+    fornoSimulado_init(&simulado, ASSAR, MAL_PASSADO, 5);
+    TEST_ASSERT_TRUE(forno_adicionaLote(&simulado.forno, GRELHAR, AO_PONTO));
+    TEST_ASSERT_EQUAL(ACAO_INICIADA, simulado.forno.status);
+    TEST_ASSERT_EQUAL(ASSAR, simulado.forno.modo);
+
+    fornoSimulado_executa(&simulado, MAXIMO_DE_PERIODOS);
+    TEST_ASSERT_TRUE(simulado.concluido);
+    TEST_ASSERT_EQUAL(PREAQUECENDO, simulado.forno.status);
+    TEST_ASSERT_EQUAL_UINT32(1, simulado.forno.lotesConcluidos);
+    TEST_ASSERT_EQUAL_UINT32(TEMPERATURA_GRELHAR, forno_temperaturaAlvo(&simulado.forno));
+
+    /* Sem carga o lote não começa, e a temperatura sobe para a do GRELHAR */
+    for(i = 0 ; i < 600 ; i++)
+    {
+        fornoSimulado_periodo(&simulado);
+    }
+    TEST_ASSERT_EQUAL(PREAQUECENDO, simulado.forno.status);
+    TEST_ASSERT_FLOAT_WITHIN(8.0f, TEMPERATURA_GRELHAR, simulado.forno.controle.temperaturaAtual);
+
+    /* Com a porta aberta a resistência fica desligada */
+    fornoSimulado_porta(&simulado, true);
+    fornoSimulado_periodo(&simulado);
+    TEST_ASSERT_FALSE(simulado.resistencia);
+    TEST_ASSERT_EQUAL(PREAQUECENDO, simulado.forno.status);
+
+    fornoSimulado_porta(&simulado, false);
+    TEST_ASSERT_EQUAL(ACAO_INICIADA, simulado.forno.status);
+    TEST_ASSERT_EQUAL(GRELHAR, simulado.forno.modo);
+    TEST_ASSERT_EQUAL(AO_PONTO, simulado.forno.ponto);
+
+    simulado.concluido = false;
+    fornoSimulado_executa(&simulado, simulado.periodos + MAXIMO_DE_PERIODOS);
+    TEST_ASSERT_EQUAL(AGUARDANDO_ACAO, simulado.forno.status);
+    TEST_ASSERT_EQUAL_UINT32(2, simulado.forno.lotesConcluidos);
+    TEST_ASSERT_FALSE(simulado.resistencia);
+}
+
+/* Resultado de fornos com a alimentação compartilhada */
+typedef struct _potenciaFrota {
+    float pico;                     /* Maior potência somada em W               */
+    float media;                    /* Potência média em W                      */
+    float erroRms;                  /* Erro de temperatura depois do aquecimento*/
+    float tempoAquecimento;         /* Tempo médio até a temperatura alvo em s  */
+} potenciaFrota_t;
+
+#define FORNOS_ALIMENTACAO          8
+#define POTENCIA_FORNO_W            2000.0f
+#define DURACAO_ALIMENTACAO_S       180
+#define INICIO_ERRO_S               90
+
+/* Simula FORNOS_ALIMENTACAO fornos que começam a aquecer juntos, por exemplo
+ * depois de uma falta de energia, todos ligados à mesma alimentação através
+ * do escalonador. O cozimento é estendido para cobrir toda a simulação, e o
+ * erro de temperatura é medido depois de INICIO_ERRO_S. */
+static void simulaAlimentacao(float orcamento, uint32_t ligamentosPorSlot, uint32_t tempoMinimoMs,
+                              potenciaFrota_t *resultado)
+{
+    static fornoSimulado_t fornos[FORNOS_ALIMENTACAO];
+    escalonador_t escalonador;
+    float aquecimento[FORNOS_ALIMENTACAO];
+    double somaErro = 0;
+    uint32_t amostrasErro = 0;
+    float erro = 0;
+    uint32_t periodo = 0;
+    uint32_t i = 0;
+
+    escalonador_init(&escalonador, orcamento, ligamentosPorSlot, tempoMinimoMs);
+    for(i = 0 ; i < FORNOS_ALIMENTACAO ; i++)
+    {
+        fornoSimulado_init(&fornos[i], (modo_t)(i % 3), BEM_PASSADO, i + 1);
+        fornoSimulado_usaEscalonador(&fornos[i], &escalonador, POTENCIA_FORNO_W);
+        forno_estende(&fornos[i].forno, (int64_t)DURACAO_ALIMENTACAO_S * 1000000);
+        aquecimento[i] = -1;
+    }
+
+    for(periodo = 0 ; periodo < DURACAO_ALIMENTACAO_S * 1000 / PERIODO_LEITURA_MS ; periodo++)
+    {
+        for(i = 0 ; i < FORNOS_ALIMENTACAO ; i++)
+        {
+            fornoSimulado_periodo(&fornos[i]);
+        }
+        escalonador_executa(&escalonador, PERIODO_LEITURA_MS);
+        for(i = 0 ; i < FORNOS_ALIMENTACAO ; i++)
+        {
+            fornoSimulado_aplicaEscalonador(&fornos[i]);
+
+            erro = fornos[i].temperatura - (float)getTemperaturaAlvoDoModo(fornos[i].forno.modo);
+            if(aquecimento[i] < 0 && erro >= 0)
+            {
+                aquecimento[i] = (float)periodo * PERIODO_LEITURA_MS / 1000.0f;
+            }
+            if(periodo >= INICIO_ERRO_S * 1000 / PERIODO_LEITURA_MS)
+            {
+                somaErro += (double)erro * erro;
+                amostrasErro++;
+            }
+        }
+    }
+
+    resultado->pico = escalonador.picoPotencia;
+    resultado->media = escalonador_potenciaMedia(&escalonador);
+    resultado->erroRms = (float)sqrt(somaErro / amostrasErro);
+    resultado->tempoAquecimento = 0;
+    for(i = 0 ; i < FORNOS_ALIMENTACAO ; i++)
+    {
+        TEST_ASSERT_TRUE(aquecimento[i] >= 0);
+        TEST_ASSERT_EQUAL(ACAO_INICIADA, fornos[i].forno.status);
+        resultado->tempoAquecimento += aquecimento[i] / FORNOS_ALIMENTACAO;
+    }
+}
+
+void test_orcamentoDePotencia()
+{
+    const float orcamento = FORNOS_ALIMENTACAO * POTENCIA_FORNO_W / 2;
+    potenciaFrota_t livre;
+    potenciaFrota_t limitado;
+
+    simulaAlimentacao(1e9f, UINT32_MAX, 0, &livre);
+    simulaAlimentacao(orcamento, 1, ESCALONADOR_TEMPO_MINIMO_MS, &limitado);
+
+    printf("%-14s %10s %10s %12s %12s %18s\n", "", "pico (W)", "media (W)", "pico/media", "erro rms (C)",
+           "aquecimento (s)");
+    printf("%-14s %10.0f %10.0f %12.2f %12.2f %18.1f\n", "sem limite", livre.pico, livre.media,
+           livre.pico / livre.media, livre.erroRms, livre.tempoAquecimento);
+    printf("%-14s %10.0f %10.0f %12.2f %12.2f %18.1f\n", "orcamento 50%", limitado.pico, limitado.media,
+           limitado.pico / limitado.media, limitado.erroRms, limitado.tempoAquecimento);
+
+    /* Sem limite todos os fornos ligam juntos */
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, FORNOS_ALIMENTACAO * POTENCIA_FORNO_W, livre.pico);
+    /* Com o escalonador o pico nunca passa do orçamento, e depois do
+     * aquecimento a temperatura é mantida tão bem quanto sem ele */
+    TEST_ASSERT_TRUE(limitado.pico <= orcamento);
+    TEST_ASSERT_TRUE(limitado.erroRms < livre.erroRms + 1.0f);
+    TEST_ASSERT_TRUE(limitado.tempoAquecimento < 2.5f * livre.tempoAquecimento);
+}
+
+/* Um cozimento inteiro com as tasks rastreadas, exportado em ARQUIVO_RASTREIO
+ * para ser aberto em chrome://tracing ou no Perfetto */
+void test_rastreioCozimento()
+{
+    static eventoRastreio_t eventos[8 * MAXIMO_DE_PERIODOS];
+    static fornoSimulado_t simulado;
+    rastreio_t rastreio;
+    uint32_t entradas[RASTREIO_MAX_NOMES] = {0};
+    uint32_t saidas[RASTREIO_MAX_NOMES] = {0};
+    uint32_t enviados = 0;
+    uint32_t recebidos = 0;
+    uint32_t timers = 0;
+    uint32_t numeroDeEventos = 0;
+    FILE *arquivo = NULL;
+    uint32_t i = 0;
+
+    rastreio_init(&rastreio, eventos, sizeof(eventos) / sizeof(eventos[0]));
+    fornoSimulado_init(&simulado, GRATINAR, AO_PONTO, 7);
+    fornoSimulado_rastreia(&simulado, &rastreio);
+    fornoSimulado_executa(&simulado, MAXIMO_DE_PERIODOS);
+    TEST_ASSERT_TRUE(simulado.concluido);
+    TEST_ASSERT_EQUAL(0, rastreio.perdidos);
+
+    /* Cada task que entra também sai, cada leitura enviada pela fila é
+     * recebida, e o tempo nunca volta */
+    numeroDeEventos = rastreio.tamanho;
+    for(i = 0 ; i < numeroDeEventos ; i++)
+    {
+        entradas[eventos[i].tarefa] += (eventos[i].tipo == RASTREIO_ENTRA);
+        saidas[eventos[i].tarefa] += (eventos[i].tipo == RASTREIO_SAI);
+        enviados += (eventos[i].tipo == RASTREIO_FILA_ENVIA);
+        recebidos += (eventos[i].tipo == RASTREIO_FILA_RECEBE);
+        timers += (eventos[i].tipo == RASTREIO_TIMER);
+        if(i > 0)
+        {
+            TEST_ASSERT_TRUE(eventos[i].instante >= eventos[i - 1].instante);
+        }
+    }
+    TEST_ASSERT_EQUAL(4, rastreio.numeroDeTarefas);
+    for(i = 0 ; i < rastreio.numeroDeTarefas ; i++)
+    {
+        TEST_ASSERT_EQUAL(entradas[i], saidas[i]);
+    }
+    TEST_ASSERT_EQUAL(simulado.periodos, entradas[0]);
+    TEST_ASSERT_TRUE(enviados > 0);
+    TEST_ASSERT_EQUAL(enviados, recebidos);
+    TEST_ASSERT_EQUAL(1, timers);
+
+    mkdir(".pio", 0755);
+    mkdir(DIRETORIO_FROTA, 0755);
+    arquivo = fopen(ARQUIVO_RASTREIO, "w");
+    TEST_ASSERT_NOT_NULL(arquivo);
+    TEST_ASSERT_TRUE(rastreio_exporta(&rastreio, arquivo));
+    printf("%u eventos de %u periodos gravados em %s (%ld bytes)\n", numeroDeEventos, simulado.periodos,
+           ARQUIVO_RASTREIO, ftell(arquivo));
+    fclose(arquivo);
+    TEST_ASSERT_EQUAL(0, rastreio.tamanho);
+}
+
+typedef struct _quedaEnergia {
+    const char *nome;
+    bool salva;                 /* O estado é salvo e restaurado            */
+    bool perdeRtc;              /* A queda apaga a memória RTC              */
+    bool interrompeGravacao;    /* A queda interrompe uma gravação na RTC   */
+    bool concluido;
+    uint32_t periodosCozidos;   /* Períodos com o cozimento em andamento    */
+    double nsRetomada;          /* Tempo de salvamento_init e restauração   */
+    float temperaturaMaxima;    /* Depois da retomada                       */
+} quedaEnergia_t;
+
+/* Executa um cozimento GRATINAR BEM_PASSADO salvando o estado a cada
+ * SALVAMENTO_PERIODO_MS, como a task salvaCozimento. No período
+ * PERIODO_QUEDA o controlador é resetado e fica desligado por PERIODOS_QUEDA
+ * períodos, enquanto o forno esfria, e depois retoma o cozimento como
+ * controle_init. */
+#define PERIODO_QUEDA       237
+#define PERIODOS_QUEDA      50
+
+static void simulaQueda(quedaEnergia_t *queda)
+{
+    static fornoSimulado_t simulado;
+    salvamento_t salvamento;
+    registroCozimento_t registro;
+    struct timespec inicio;
+    struct timespec fim;
+    uint32_t i = 0;
+
+    salvamento_simulaApaga();
+    salvamento_init(&salvamento, &registro);
+    fornoSimulado_init(&simulado, GRATINAR, BEM_PASSADO, 7);
+    queda->periodosCozidos = 0;
+    queda->temperaturaMaxima = 0;
+    while(!simulado.concluido && simulado.periodos < 2 * MAXIMO_DE_PERIODOS)
+    {
+        if(simulado.periodos == PERIODO_QUEDA)
+        {
+            salvamento_simulaQueda(queda->perdeRtc, queda->interrompeGravacao);
+            fornoSimulado_reinicia(&simulado);
+            for(i = 0 ; i < PERIODOS_QUEDA ; i++)
+            {
+                fornoSimulado_periodo(&simulado);
+            }
+
+            clock_gettime(CLOCK_MONOTONIC, &inicio);
+            if(queda->salva && salvamento_init(&salvamento, &registro) && registro.status != AGUARDANDO_ACAO)
+            {
+                salvamento_restaura(&simulado.forno, &registro);
+                fornoSimulado_porta(&simulado, false);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &fim);
+            queda->nsRetomada = (double)(fim.tv_sec - inicio.tv_sec) * 1e9 + (double)(fim.tv_nsec - inicio.tv_nsec);
+            simulado.temperaturaMaxima = simulado.temperatura;
+        }
+
+        queda->periodosCozidos += (simulado.forno.status == ACAO_INICIADA);
+        fornoSimulado_periodo(&simulado);
+        if(queda->salva && simulado.periodos % (SALVAMENTO_PERIODO_MS / PERIODO_LEITURA_MS) == 0)
+        {
+            salvamento_captura(&simulado.forno, &registro);
+            salvamento_grava(&salvamento, &registro, simulado.agora);
+        }
+    }
+    queda->concluido = simulado.concluido;
+    queda->temperaturaMaxima = simulado.temperaturaMaxima;
+}
+
+/* Um reset no meio de um cozimento: sem o salvamento o forno volta parado e o
+ * lote se perde. Com ele o cozimento é retomado, e o tempo cozido a mais é no
+ * máximo o intervalo entre as gravações da memória usada. */
+void test_quedaDeEnergia()
+{
+    quedaEnergia_t quedas[] = {
+        {"sem salvamento", false, false, false, false, 0, 0, 0},
+        {"reset", true, false, false, false, 0, 0, 0},
+        {"gravacao interrompida", true, false, true, false, 0, 0, 0},
+        {"queda longa", true, true, false, false, 0, 0, 0},
+        {"queda longa interrompida", true, true, true, false, 0, 0, 0},
+    };
+    const uint32_t periodosDoPonto = TEMPO_BEM_PASSADO / PERIODO_LEITURA_MS;
+    const uint32_t periodosRtc = SALVAMENTO_PERIODO_MS / PERIODO_LEITURA_MS;
+    const uint32_t periodosFlash = SALVAMENTO_PERIODO_FLASH_MS / PERIODO_LEITURA_MS;
+    uint32_t i = 0;
+
+    printf("%-26s %10s %14s %14s %14s\n", "queda", "concluido", "repetido (s)", "retomada (us)", "maxima (C)");
+    for(i = 0 ; i < sizeof(quedas) / sizeof(quedas[0]) ; i++)
+    {
+        simulaQueda(&quedas[i]);
+        printf("%-26s %10s %14.1f %14.2f %14.1f\n", quedas[i].nome, quedas[i].concluido ? "sim" : "nao",
+               quedas[i].concluido ? (quedas[i].periodosCozidos - periodosDoPonto) * PERIODO_LEITURA_MS / 1000.0 : 0.0,
+               quedas[i].nsRetomada / 1000, quedas[i].temperaturaMaxima);
+    }
+
+    TEST_ASSERT_FALSE(quedas[0].concluido);
+    TEST_ASSERT_EQUAL_UINT32(PERIODO_QUEDA, quedas[0].periodosCozidos);
+    for(i = 1 ; i < sizeof(quedas) / sizeof(quedas[0]) ; i++)
+    {
+        TEST_ASSERT_TRUE(quedas[i].concluido);
+        TEST_ASSERT_TRUE(quedas[i].periodosCozidos >= periodosDoPonto);
+        /* A retomada leva microssegundos, bem menos que um período */
+        TEST_ASSERT_TRUE(quedas[i].nsRetomada < PERIODO_LEITURA_MS * 1e6);
+        /* A estimativa salva não faz o forno passar da temperatura alvo */
+        TEST_ASSERT_TRUE(quedas[i].temperaturaMaxima < TEMPERATURA_GRATINAR + 5.0f);
+    }
+    TEST_ASSERT_TRUE(quedas[1].periodosCozidos <= periodosDoPonto + periodosRtc);
+    TEST_ASSERT_TRUE(quedas[2].periodosCozidos <= periodosDoPonto + 2 * periodosRtc);
+    TEST_ASSERT_TRUE(quedas[3].periodosCozidos <= periodosDoPonto + periodosFlash);
+    TEST_ASSERT_TRUE(quedas[4].periodosCozidos <= periodosDoPonto + periodosFlash);
+}
+
+typedef struct _qualidadeAmostragem {
+    uint32_t leituras;          /* Rajadas do LM35 e leituras do termopar   */
+    double tempoAquecimento;    /* Até o alvo - 5°C, em s                   */
+    double erroQuadratico;      /* Integral do erro² depois do aquecimento  */
+    double tempoNoAlvo;         /* Tempo depois do aquecimento em s         */
+    float sobressinal;          /* Maior temperatura acima do alvo em °C    */
+    uint32_t periodoMinimo;     /* Menor período escolhido em ms            */
+} qualidadeAmostragem_t;
+
+/* Executa um cozimento BEM_PASSADO com a porta aberta por 3s no meio, com o
+ * período fixo ou adaptativo, e mede as leituras e a qualidade do controle */
+static void simulaAmostragem(modo_t modo, uint32_t semente, bool adaptativa, qualidadeAmostragem_t *qualidade)
+{
+    static fornoSimulado_t simulado;
+    float alvo = (float)getTemperaturaAlvoDoModo(modo);
+    float dt = 0;
+    bool aquecido = false;
+    uint32_t periodoMs = 0;
+
+    memset(qualidade, 0, sizeof(*qualidade));
+    qualidade->periodoMinimo = 0xFFFFFFFF;
+    fornoSimulado_init(&simulado, modo, BEM_PASSADO, semente);
+    if(adaptativa)
+    {
+        fornoSimulado_usaAmostragemAdaptativa(&simulado);
+    }
+    while(!simulado.concluido && simulado.agora < 2 * TEMPO_BEM_PASSADO * 1000LL)
+    {
+        periodoMs = forno_periodoLeituraMs(&simulado.forno);
+        qualidade->periodoMinimo = (periodoMs < qualidade->periodoMinimo) ? periodoMs : qualidade->periodoMinimo;
+        fornoSimulado_porta(&simulado, simulado.agora >= 30000000 && simulado.agora < 33000000);
+        fornoSimulado_periodo(&simulado);
+        qualidade->leituras++;
+
+        dt = periodoMs / 1000.0f;
+        if(!aquecido && simulado.temperatura >= alvo - 5)
+        {
+            aquecido = true;
+            qualidade->tempoAquecimento = simulado.agora / 1e6;
+        }
+        /* A porta aberta não conta para o erro */
+        if(aquecido && !simulado.portaAberta && simulado.agora < 30000000)
+        {
+            qualidade->erroQuadratico += (simulado.temperatura - alvo) * (simulado.temperatura - alvo) * dt;
+            qualidade->tempoNoAlvo += dt;
+        }
+        if(simulado.temperatura - alvo > qualidade->sobressinal)
+        {
+            qualidade->sobressinal = simulado.temperatura - alvo;
+        }
+    }
+    TEST_ASSERT_TRUE(simulado.concluido);
+}
+
+/* Compara a amostragem fixa e a adaptativa nos três modos, com várias
+ * sementes: o número de conversões do ADC e de leituras do termopar por
+ * cozimento, e a qualidade do controle contra o forno simulado */
+void test_amostragemAdaptativa()
+{
+    static const modo_t modos[] = {ASSAR, GRATINAR, GRELHAR};
+    static const char *nomes[] = {"fixa", "adaptativa"};
+    qualidadeAmostragem_t total[2];
+    qualidadeAmostragem_t qualidade[2];
+    uint32_t cozimentos = 0;
+    uint32_t aquecidos = 0;
+    uint32_t i = 0;
+    uint32_t j = 0;
+    uint32_t semente = 0;
+
+    memset(total, 0, sizeof(total));
+    total[0].periodoMinimo = total[1].periodoMinimo = 0xFFFFFFFF;
+    for(i = 0 ; i < sizeof(modos) / sizeof(modos[0]) ; i++)
+    {
+        for(semente = 1 ; semente <= 8 ; semente++)
+        {
+            for(j = 0 ; j < 2 ; j++)
+            {
+                simulaAmostragem(modos[i], semente, j == 1, &qualidade[j]);
+                total[j].leituras += qualidade[j].leituras;
+                total[j].erroQuadratico += qualidade[j].erroQuadratico;
+                total[j].tempoNoAlvo += qualidade[j].tempoNoAlvo;
+                if(qualidade[j].sobressinal > total[j].sobressinal)
+                {
+                    total[j].sobressinal = qualidade[j].sobressinal;
+                }
+                if(qualidade[j].periodoMinimo < total[j].periodoMinimo)
+                {
+                    total[j].periodoMinimo = qualidade[j].periodoMinimo;
+                }
+            }
+            /* O aquecimento só é comparado nos cozimentos em que as duas
+             * amostragens chegaram perto do alvo antes do fim, já que nos
+             * modos mais quentes isso pode acontecer só com uma delas */
+            if(qualidade[0].tempoAquecimento > 0 && qualidade[1].tempoAquecimento > 0)
+            {
+                for(j = 0 ; j < 2 ; j++)
+                {
+                    total[j].tempoAquecimento += qualidade[j].tempoAquecimento;
+                }
+                aquecidos++;
+            }
+            cozimentos++;
+        }
+    }
+
+    printf("%-12s %16s %16s %14s %14s %16s\n", "amostragem", "conversoes/coz", "leituras/coz",
+           "erro rms (C)", "sobressinal", "aquecimento (s)");
+    for(j = 0 ; j < 2 ; j++)
+    {
+        printf("%-12s %16.0f %16.1f %14.2f %14.2f %16.2f\n", nomes[j],
+               (double)total[j].leituras * NUMBER_OF_SAMPLES / cozimentos, (double)total[j].leituras / cozimentos,
+               sqrt(total[j].erroQuadratico / total[j].tempoNoAlvo), total[j].sobressinal,
+               total[j].tempoAquecimento / aquecidos);
+    }
+    printf("Reducao das conversoes: %.1f%%, menor periodo %u ms\n",
+           100.0 * (1.0 - (double)total[1].leituras / total[0].leituras), total[1].periodoMinimo);
+
+    /* Pelo menos metade das conversões é economizada, sem atrasar o
+     * aquecimento e com o erro e o sobressinal próximos dos da amostragem fixa */
+    TEST_ASSERT_TRUE(2 * total[1].leituras < total[0].leituras);
+    TEST_ASSERT_TRUE(total[1].tempoAquecimento <= total[0].tempoAquecimento * 1.02);
+    TEST_ASSERT_TRUE(total[1].erroQuadratico / total[1].tempoNoAlvo <
+                     1.25 * 1.25 * total[0].erroQuadratico / total[0].tempoNoAlvo);
+    TEST_ASSERT_TRUE(total[1].sobressinal < total[0].sobressinal + 1.0f);
+    TEST_ASSERT_EQUAL_UINT32(AMOSTRAGEM_PERIODO_MIN_MS, total[1].periodoMinimo);
+}
+
+/* Os indicadores calculados pelo forno a partir das suas próprias estimativas
+ * conferem com o que o forno simulado de fato fez, com o período fixo e com a
+ * amostragem adaptativa */
+void test_indicadoresCozimento()
+{
+    static fornoSimulado_t simulado;
+    registroIndicadores_t registro;
+    float alvo = (float)TEMPERATURA_ASSAR;
+    double tempoLigada = 0;
+    double tempoAteAlvo = -1;
+    uint32_t periodoMs = 0;
+    uint32_t semente = 0;
+    uint32_t j = 0;
+
+    for(j = 0 ; j < 2 ; j++)
+    {
+        for(semente = 1 ; semente <= 4 ; semente++)
+        {
+            fornoSimulado_init(&simulado, ASSAR, BEM_PASSADO, semente);
+            if(j == 1)
+            {
+                fornoSimulado_usaAmostragemAdaptativa(&simulado);
+            }
+            tempoLigada = 0;
+            tempoAteAlvo = -1;
+            while(!simulado.concluido && simulado.agora < 2 * TEMPO_BEM_PASSADO * 1000LL)
+            {
+                periodoMs = forno_periodoLeituraMs(&simulado.forno);
+                fornoSimulado_porta(&simulado, simulado.agora >= 30000000 && simulado.agora < 33000000);
+                tempoLigada += simulado.resistencia ? periodoMs / 1000.0 : 0;
+                fornoSimulado_periodo(&simulado);
+                if(tempoAteAlvo < 0 && simulado.temperatura >= alvo)
+                {
+                    tempoAteAlvo = simulado.agora / 1e6;
+                }
+            }
+            TEST_ASSERT_TRUE(simulado.concluido);
+            TEST_ASSERT_TRUE(indicadores_consulta(&simulado.forno.indicadores, 0, &registro));
+            printf("%-10s semente %u: alvo em %5d ms, sobressinal %.2f C, %5u ms na faixa, %3u comutacoes, "
+                   "%.2f Wh, variancia %.2f C2, %u leituras\n", (j == 0) ? "fixa" : "adaptativa", semente,
+                   registro.tempoAteAlvoMs, registro.sobressinal, registro.tempoNaFaixaMs, registro.comutacoes,
+                   registro.energiaWh, registro.variancia, registro.amostras);
+
+            TEST_ASSERT_EQUAL_UINT32(1, registro.lote);
+            TEST_ASSERT_EQUAL(ASSAR, registro.modo);
+            /* O cozimento começou no instante 0, e a porta aberta o estendeu */
+            TEST_ASSERT_EQUAL_UINT32((uint32_t)(simulado.agora / 1000), registro.duracaoMs);
+            TEST_ASSERT_TRUE(registro.duracaoMs > TEMPO_BEM_PASSADO);
+            TEST_ASSERT_TRUE(tempoAteAlvo > 0);
+            TEST_ASSERT_FLOAT_WITHIN(1.0f, (float)tempoAteAlvo, registro.tempoAteAlvoMs / 1000.0f);
+            /* O pico pode cair entre duas leituras, em que a temperatura varia
+             * até AMOSTRAGEM_VARIACAO_C */
+            TEST_ASSERT_TRUE(registro.sobressinal <= simulado.temperaturaMaxima - alvo + 0.5f);
+            TEST_ASSERT_TRUE(registro.sobressinal >= simulado.temperaturaMaxima - alvo - AMOSTRAGEM_VARIACAO_C);
+            /* O forno desliga a resistência ao fim do cozimento, depois do
+             * registro */
+            TEST_ASSERT_UINT32_WITHIN(1, simulado.chaveamentos, registro.comutacoes);
+            TEST_ASSERT_FLOAT_WITHIN(0.03f * registro.energiaWh,
+                                     (float)(tempoLigada * POTENCIA_RESISTENCIA_W / 3600.0), registro.energiaWh);
+            TEST_ASSERT_TRUE(registro.tempoNaFaixaMs > 20000);
+            TEST_ASSERT_TRUE(registro.variancia > 0 && registro.variancia < INDICADORES_FAIXA_C * INDICADORES_FAIXA_C);
+        }
+    }
+}
+
+/* Executa frotas de 1 a 10000 fornos com uma thread e com uma thread por
+ * núcleo, e relata o custo de CPU por forno e quantos fornos um núcleo
+ * controlaria em tempo real, ou seja, com um período de leitura a cada
+ * PERIODO_LEITURA_MS */
+void test_escalabilidade()
+{
+    static const uint32_t tamanhos[] = {1, 10, 100, 1000, 10000};
+    uint32_t threads[2] = {1, (uint32_t)sysconf(_SC_NPROCESSORS_ONLN)};
+    uint32_t numeroDeConfiguracoes = (threads[1] > 1) ? 2 : 1;
+    resultadoFrota_t resultado;
+    frota_t frota;
+    double nsPorPeriodo = 0;
+    double fornosPorNucleo = 0;
+    FILE *arquivo = NULL;
+    bool primeiro = true;
+    uint32_t i = 0;
+    uint32_t j = 0;
+
+    mkdir(".pio", 0755);
+    mkdir(DIRETORIO_FROTA, 0755);
+    arquivo = fopen(ARQUIVO_ESCALABILIDADE, "w");
+    TEST_ASSERT_NOT_NULL(arquivo);
+    fprintf(arquivo, "{\n  \"bytesPorForno\": %u,\n  \"bytesPorFornoSimulado\": %u,\n  \"execucoes\": [",
+            (unsigned)sizeof(forno_t), (unsigned)sizeof(fornoSimulado_t));
+
+    printf("Estado por forno: %u bytes (forno_t), %u bytes com o modelo simulado\n",
+           (unsigned)sizeof(forno_t), (unsigned)sizeof(fornoSimulado_t));
+    printf("%8s %8s %12s %12s %14s %16s\n", "fornos", "threads", "real (ms)", "cpu (ms)",
+           "ns/periodo", "fornos/nucleo");
+
+    for(i = 0 ; i < sizeof(tamanhos) / sizeof(tamanhos[0]) ; i++)
+    {
+        for(j = 0 ; j < numeroDeConfiguracoes ; j++)
+        {
+            TEST_ASSERT_TRUE(frota_cria(&frota, tamanhos[i]));
+            TEST_ASSERT_TRUE(frota_executa(&frota, threads[j], MAXIMO_DE_PERIODOS, &resultado));
+            TEST_ASSERT_TRUE(frota.fornos[frota.numeroDeFornos - 1].concluido);
+            frota_destroi(&frota);
+
+            nsPorPeriodo = resultado.tempoCpu / (double)resultado.periodos;
+            fornosPorNucleo = (PERIODO_LEITURA_MS * 1e6) / nsPorPeriodo;
+            printf("%8u %8u %12.2f %12.2f %14.1f %16.0f\n", tamanhos[i], threads[j], resultado.tempoReal / 1e6,
+                   resultado.tempoCpu / 1e6, nsPorPeriodo, fornosPorNucleo);
+            fprintf(arquivo, "%s\n    {\"fornos\": %u, \"threads\": %u, \"tempoRealMs\": %.3f, \"tempoCpuMs\": %.3f, "
+                             "\"periodos\": %llu, \"nsPorPeriodo\": %.1f, \"fornosPorNucleo\": %.0f}",
+                    primeiro ? "" : ",", tamanhos[i], threads[j], resultado.tempoReal / 1e6, resultado.tempoCpu / 1e6,
+                    (unsigned long long)resultado.periodos, nsPorPeriodo, fornosPorNucleo);
+            primeiro = false;
+
+            /* Um núcleo deve dar conta de muito mais fornos do que um ESP32
+             * controla, senão a simulação não serve para teste de carga */
+            TEST_ASSERT_TRUE(fornosPorNucleo > 1000);
+        }
+    }
+    fprintf(arquivo, "\n  ]\n}\n");
+    fclose(arquivo);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_cozimentoCompleto);
+    RUN_TEST(test_instanciasIndependentes);
+    RUN_TEST(test_frotaDeterministica);
+    RUN_TEST(test_filaDeLotes);
+    RUN_TEST(test_lotesPorHora);
+    RUN_TEST(test_orcamentoDePotencia);
+    RUN_TEST(test_rastreioCozimento);
+    RUN_TEST(test_quedaDeEnergia);
+    RUN_TEST(test_amostragemAdaptativa);
+    RUN_TEST(test_indicadoresCozimento);
+    RUN_TEST(test_escalabilidade);
+    return UNITY_END();
+}
@@ -0,0 +1,217 @@
+#include <math.h>
+#include <stdio.h>
+#include <unity.h>
+#include "definitions.h"
+#include "fusaoSensores.h"
+#include "termopar.h"
+#include "../aleatorio.h"
+
+/* Testes da fusão do LM35 com o termopar e da decodificação dos quadros do
+ * MAX6675 */
+
+#define DT              (PERIODO_LEITURA_MS / 1000.0f)
+/* Leituras com a resistência desligada, e em seguida ligada */
+#define PERIODOS_PARADO 300
+#define PERIODOS        600
+/* Leituras descartadas no início de cada trecho, enquanto os filtros se
+ * acomodam */
+#define ACOMODACAO      100
+
+static fusao_t fusao;
+
+/* Ruído aproximadamente normal, de média 0 e desvio padrão 1 */
+static float normal()
+{
+    float soma = 0;
+    uint32_t i = 0;
+
+    for(i = 0 ; i < 12 ; i++)
+    {
+        soma += (float)aleatorio() / 16777216.0f;
+    }
+    return soma - 6.0f;
+}
+
+void setUp()
+{
+    fusao_init(&fusao);
+}
+
+void tearDown()
+{
+}
+
+void test_decodificaQuadro()
+{
+    float temperatura = 0;
+
+    TEST_ASSERT_TRUE(termopar_decodificaQuadro(400 << 3, &temperatura));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 100.0f, temperatura);
+    TEST_ASSERT_TRUE(termopar_decodificaQuadro(0x0FFF << 3, &temperatura));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 1023.75f, temperatura);
+    /* Os bits 1 e 0 não fazem parte da temperatura */
+    TEST_ASSERT_TRUE(termopar_decodificaQuadro((401 << 3) | 0x0003, &temperatura));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 100.25f, temperatura);
+
+    /* Termopar aberto e quadro com o bit 15, que é sempre 0, não mudam a
+     * temperatura */
+    temperatura = -1.0f;
+    TEST_ASSERT_FALSE(termopar_decodificaQuadro((400 << 3) | 0x0004, &temperatura));
+    TEST_ASSERT_FALSE(termopar_decodificaQuadro(0x8000 | (400 << 3), &temperatura));
+    TEST_ASSERT_FALSE(termopar_decodificaQuadro(0xFFFF, &temperatura));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, -1.0f, temperatura);
+
+    TEST_ASSERT_TRUE(termopar_decodificaQuadro(termopar_simulaQuadro(231.3f, false), &temperatura));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 231.25f, temperatura);
+    TEST_ASSERT_FALSE(termopar_decodificaQuadro(termopar_simulaQuadro(231.3f, true), &temperatura));
+}
+
+/* A divergência só é sinalizada depois de FUSAO_TEMPO_DIVERGENCIA_MS de
+ * leituras seguidas, e some na primeira leitura em que os sensores concordam */
+void test_divergencia()
+{
+    float limite = FUSAO_LIMITE_DIVERGENCIA;
+    uint32_t i = 0;
+
+    fusao_atualiza(&fusao, 100.0f, 100.0f + limite, true, false, DT);
+    TEST_ASSERT_EQUAL_UINT32(0, fusao.divergenteMs);
+
+    for(i = 1 ; i < FUSAO_TEMPO_DIVERGENCIA_MS / PERIODO_LEITURA_MS ; i++)
+    {
+        fusao_atualiza(&fusao, 100.0f, 101.0f + limite, true, false, DT);
+        TEST_ASSERT_FALSE(fusao.divergencia);
+    }
+    fusao_atualiza(&fusao, 100.0f, 99.0f - limite, true, false, DT);
+    TEST_ASSERT_TRUE(fusao.divergencia);
+    fusao_atualiza(&fusao, 100.0f, 130.0f, true, false, DT);
+    TEST_ASSERT_TRUE(fusao.divergencia);
+    TEST_ASSERT_EQUAL_UINT32(FUSAO_TEMPO_DIVERGENCIA_MS, fusao.divergenteMs);
+
+    fusao_atualiza(&fusao, 100.0f, 100.0f, true, false, DT);
+    TEST_ASSERT_FALSE(fusao.divergencia);
+    TEST_ASSERT_EQUAL_UINT32(0, fusao.divergenteMs);
+
+    /* Um termopar aberto também conta como divergência */
+    for(i = 0 ; i < FUSAO_TEMPO_DIVERGENCIA_MS / PERIODO_LEITURA_MS ; i++)
+    {
+        TEST_ASSERT_FALSE(fusao.divergencia);
+        fusao_atualiza(&fusao, 100.0f, 0, false, false, DT);
+    }
+    TEST_ASSERT_TRUE(fusao.divergencia);
+}
+
+/* Com leituras mais espaçadas, como as da amostragem adaptativa, o mesmo tempo
+ * de divergência é atingido com menos leituras */
+void test_divergenciaComPeriodoVariavel()
+{
+    float limite = FUSAO_LIMITE_DIVERGENCIA;
+
+    fusao_atualiza(&fusao, 100.0f, 101.0f + limite, true, false, 0.5f);
+    TEST_ASSERT_EQUAL_UINT32(500, fusao.divergenteMs);
+    TEST_ASSERT_FALSE(fusao.divergencia);
+    fusao_atualiza(&fusao, 100.0f, 101.0f + limite, true, false, 0.25f);
+    fusao_atualiza(&fusao, 100.0f, 101.0f + limite, true, false, 0.2f);
+    TEST_ASSERT_EQUAL_UINT32(950, fusao.divergenteMs);
+    TEST_ASSERT_FALSE(fusao.divergencia);
+    fusao_atualiza(&fusao, 100.0f, 101.0f + limite, true, false, 0.05f);
+    TEST_ASSERT_TRUE(fusao.divergencia);
+}
+
+/* Desvio médio quadrático do erro no trecho parado, e atraso médio em s no
+ * trecho de aquecimento, de uma estimativa em relação à temperatura real */
+static void avalia(const float *real, const float *estimativa, float *ruido, float *atraso)
+{
+    double soma = 0;
+    uint32_t k = 0;
+
+    for(k = ACOMODACAO ; k < PERIODOS_PARADO ; k++)
+    {
+        soma += (estimativa[k] - real[k]) * (estimativa[k] - real[k]);
+    }
+    *ruido = (float)sqrt(soma / (PERIODOS_PARADO - ACOMODACAO));
+
+    soma = 0;
+    for(k = PERIODOS_PARADO + ACOMODACAO ; k < PERIODOS ; k++)
+    {
+        soma += (real[k] - estimativa[k]) / ((real[k] - real[k - 1]) / DT);
+    }
+    *atraso = (float)(soma / (PERIODOS - PERIODOS_PARADO - ACOMODACAO));
+}
+
+/* A resistência é ligada com o forno parado na temperatura ambiente. Com o
+ * mesmo ruído na estimativa parada, a fusão acompanha a rampa com um atraso
+ * bem menor que o de uma média móvel das mesmas leituras, porque o seu modelo
+ * sabe que a resistência foi ligada. */
+void test_atrasoDaRampaContraMediaMovel()
+{
+    static float real[PERIODOS];
+    static float estimativa[PERIODOS];
+    static float combinada[PERIODOS];
+    static float media[PERIODOS];
+    float pesoLm35 = 1.0f / FUSAO_RUIDO_LM35;
+    float pesoTermopar = 1.0f / FUSAO_RUIDO_TERMOPAR;
+    float temperatura = FUSAO_TEMPERATURA_AMBIENTE;
+    float lm35 = 0;
+    float termopar = 0;
+    float ruidoFusao = 0;
+    float atrasoFusao = 0;
+    float ruidoMedia = 0;
+    float atrasoMedia = 0;
+    bool ligada = false;
+    uint32_t janela = 0;
+    uint32_t k = 0;
+    uint32_t i = 0;
+
+    for(k = 0 ; k < PERIODOS ; k++)
+    {
+        ligada = (k >= PERIODOS_PARADO);
+        temperatura += DT * ((ligada ? FUSAO_TAXA_AQUECIMENTO : 0.0f) -
+                             FUSAO_COEFICIENTE_PERDA * (temperatura - FUSAO_TEMPERATURA_AMBIENTE));
+        lm35 = temperatura + normal() * sqrtf(FUSAO_RUIDO_LM35);
+        TEST_ASSERT_TRUE(termopar_decodificaQuadro(
+            termopar_simulaQuadro(temperatura + normal() * sqrtf(FUSAO_RUIDO_TERMOPAR), false), &termopar));
+
+        real[k] = temperatura;
+        estimativa[k] = fusao_atualiza(&fusao, lm35, termopar, true, ligada, DT);
+        /* A média móvel recebe as duas leituras já combinadas pelas suas
+         * variâncias, a melhor medida possível de um único período */
+        combinada[k] = (lm35 * pesoLm35 + termopar * pesoTermopar) / (pesoLm35 + pesoTermopar);
+    }
+    avalia(real, estimativa, &ruidoFusao, &atrasoFusao);
+
+    /* A menor janela cujo ruído parado não passa do da fusão */
+    for(janela = 1 ; janela <= ACOMODACAO ; janela++)
+    {
+        for(k = 0 ; k < PERIODOS ; k++)
+        {
+            media[k] = 0;
+            for(i = 0 ; i < janela && i <= k ; i++)
+            {
+                media[k] += combinada[k - i];
+            }
+            media[k] /= (float)((k + 1 < janela) ? k + 1 : janela);
+        }
+        avalia(real, media, &ruidoMedia, &atrasoMedia);
+        if(ruidoMedia <= ruidoFusao)
+        {
+            break;
+        }
+    }
+    printf("Fusao: ruido %.3f C, atraso %.3f s; media movel de %u leituras: ruido %.3f C, atraso %.3f s\n",
+           ruidoFusao, atrasoFusao, (unsigned)janela, ruidoMedia, atrasoMedia);
+
+    TEST_ASSERT_LESS_OR_EQUAL(ACOMODACAO, janela);
+    TEST_ASSERT_GREATER_THAN(1, janela);
+    TEST_ASSERT_TRUE(atrasoMedia >= (janela - 1) * DT / 2 * 0.8f);
+    TEST_ASSERT_TRUE(fabsf(atrasoFusao) < atrasoMedia / 2);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_decodificaQuadro);
+    RUN_TEST(test_divergencia);
+    RUN_TEST(test_divergenciaComPeriodoVariavel);
+    RUN_TEST(test_atrasoDaRampaContraMediaMovel);
+    return UNITY_END();
+}
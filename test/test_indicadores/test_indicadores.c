@@ -0,0 +1,182 @@
+#include <math.h>
+#include <unity.h>
+#include "indicadoresCozimento.h"
+#include "../aleatorio.h"
+
+/* Testes dos indicadores de qualidade de cada cozimento */
+
+static indicadores_t indicadores;
+
+void setUp()
+{
+    indicadores_init(&indicadores);
+}
+
+void tearDown()
+{
+}
+
+/* A média e a variância calculadas amostra a amostra são as mesmas de um
+ * cálculo em duas passadas sobre todas as amostras guardadas, com cada uma
+ * pesando o intervalo desde a anterior */
+void test_welfordPonderado()
+{
+    static float temperaturas[20000];
+    static double pesos[20000];
+    registroIndicadores_t registro;
+    int64_t instante = 0;
+    double soma = 0;
+    double somaPesos = 0;
+    double media = 0;
+    double variancia = 0;
+    uint32_t intervalo = 0;
+    uint32_t i = 0;
+
+    indicadores_inicia(&indicadores, ASSAR, AO_PONTO, TEMPERATURA_ASSAR, 0, false);
+    /* A primeira amostra no alvo só marca o início do regime */
+    instante = 10000000;
+    indicadores_amostra(&indicadores, instante, TEMPERATURA_ASSAR, true);
+    for(i = 0 ; i < 20000 ; i++)
+    {
+        intervalo = 50000 + (aleatorio() % 46) * 10000;
+        instante += intervalo;
+        temperaturas[i] = TEMPERATURA_ASSAR - 3.0f + (float)(aleatorio() % 6000) / 1000.0f;
+        pesos[i] = intervalo / 1e6;
+        indicadores_amostra(&indicadores, instante, temperaturas[i], (i & 1) != 0);
+    }
+
+    for(i = 0 ; i < 20000 ; i++)
+    {
+        soma += pesos[i] * temperaturas[i];
+        somaPesos += pesos[i];
+    }
+    media = soma / somaPesos;
+    for(i = 0 ; i < 20000 ; i++)
+    {
+        variancia += pesos[i] * (temperaturas[i] - media) * (temperaturas[i] - media);
+    }
+    variancia /= somaPesos;
+
+    TEST_ASSERT_TRUE(indicadores_parcial(&indicadores, instante, &registro));
+    TEST_ASSERT_EQUAL_UINT32(20001, registro.amostras);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, (float)media, registro.media);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f * (float)variancia, (float)variancia, registro.variancia);
+}
+
+/* Um aquecimento de 10 °C/s lido a cada 100 ms chega ao alvo, e depois a
+ * temperatura oscila em torno dele de forma conhecida */
+void test_aquecimentoEFaixa()
+{
+    registroIndicadores_t registro;
+    int64_t instante = 0;
+    float temperatura = 25.0f;
+    uint32_t i = 0;
+
+    indicadores_inicia(&indicadores, GRATINAR, BEM_PASSADO, TEMPERATURA_GRATINAR, 0, false);
+    TEST_ASSERT_TRUE(indicadores_parcial(&indicadores, 0, &registro));
+    TEST_ASSERT_EQUAL_INT32(-1, registro.tempoAteAlvoMs);
+
+    /* 25 °C até 275 °C em 25 s */
+    for(i = 1 ; temperatura < TEMPERATURA_GRATINAR ; i++)
+    {
+        instante = (int64_t)i * 100000;
+        temperatura = 25.0f + i * 1.0f;
+        indicadores_amostra(&indicadores, instante, temperatura, true);
+    }
+    TEST_ASSERT_TRUE(indicadores_parcial(&indicadores, instante, &registro));
+    TEST_ASSERT_EQUAL_INT32(25000, registro.tempoAteAlvoMs);
+
+    /* 10 s alternando entre 3 °C acima e 7 °C abaixo do alvo a cada leitura */
+    for(i = 0 ; i < 100 ; i++)
+    {
+        instante += 100000;
+        indicadores_amostra(&indicadores, instante, TEMPERATURA_GRATINAR + ((i & 1) ? 3.0f : -7.0f), false);
+    }
+    TEST_ASSERT_NOT_NULL(indicadores_finaliza(&indicadores, instante, 1));
+    TEST_ASSERT_TRUE(indicadores_consulta(&indicadores, 0, &registro));
+
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)(instante / 1000), registro.duracaoMs);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 3.0f, registro.sobressinal);
+    /* Dentro da faixa: de 270 °C a 275 °C no aquecimento (6 leituras) e as
+     * 50 leituras 3 °C acima do alvo, 100 ms cada */
+    TEST_ASSERT_EQUAL_UINT32(5600, registro.tempoNaFaixaMs);
+    /* Liga no início e desliga depois do aquecimento */
+    TEST_ASSERT_EQUAL_UINT32(2, registro.comutacoes);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, TEMPERATURA_GRATINAR - 2.0f, registro.media);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 25.0f, registro.variancia);
+}
+
+/* A energia vem do tempo com a resistência ligada em cada intervalo, e cada
+ * mudança de nível é uma comutação */
+void test_comutacoesEEnergia()
+{
+    registroIndicadores_t registro;
+    int64_t instante = 0;
+    int64_t tempoLigada = 0;
+    uint32_t intervalo = 0;
+    uint32_t comutacoes = 0;
+    bool nivel = true;
+    bool anterior = true;
+    uint32_t i = 0;
+
+    /* A resistência já estava ligada mantendo a temperatura entre dois lotes,
+     * então continuar ligada não é uma comutação */
+    indicadores_inicia(&indicadores, ASSAR, MAL_PASSADO, TEMPERATURA_ASSAR, 0, true);
+    for(i = 0 ; i < 5000 ; i++)
+    {
+        intervalo = 50000 + (aleatorio() % 46) * 10000;
+        instante += intervalo;
+        nivel = (i < 10) || (aleatorio() % 3) == 0;
+        tempoLigada += nivel ? intervalo : 0;
+        comutacoes += (nivel != anterior);
+        anterior = nivel;
+        indicadores_amostra(&indicadores, instante, TEMPERATURA_ASSAR, nivel);
+    }
+    TEST_ASSERT_TRUE(indicadores_parcial(&indicadores, instante, &registro));
+    TEST_ASSERT_EQUAL_UINT32(comutacoes, registro.comutacoes);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f * registro.energiaWh,
+                             (float)((double)tempoLigada * POTENCIA_RESISTENCIA_W / 3.6e9), registro.energiaWh);
+}
+
+/* O histórico guarda os últimos INDICADORES_HISTORICO cozimentos, do mais
+ * recente ao mais antigo */
+void test_historico()
+{
+    registroIndicadores_t registro;
+    uint32_t lote = 0;
+    uint32_t i = 0;
+
+    TEST_ASSERT_FALSE(indicadores_consulta(&indicadores, 0, &registro));
+    TEST_ASSERT_NULL(indicadores_finaliza(&indicadores, 0, 1));
+
+    for(lote = 1 ; lote <= INDICADORES_HISTORICO + 3 ; lote++)
+    {
+        indicadores_inicia(&indicadores, (modo_t)(lote % 3), AO_PONTO, 100 + lote, (int64_t)lote * 60000000, false);
+        indicadores_amostra(&indicadores, (int64_t)lote * 60000000 + 100000, 25.0f, false);
+        TEST_ASSERT_NOT_NULL(indicadores_finaliza(&indicadores, (int64_t)lote * 60000000 + 30000000, lote));
+        TEST_ASSERT_FALSE(indicadores_parcial(&indicadores, 0, &registro));
+    }
+
+    for(i = 0 ; i < INDICADORES_HISTORICO ; i++)
+    {
+        lote = INDICADORES_HISTORICO + 3 - i;
+        TEST_ASSERT_TRUE(indicadores_consulta(&indicadores, i, &registro));
+        TEST_ASSERT_EQUAL_UINT32(lote, registro.lote);
+        TEST_ASSERT_EQUAL(lote % 3, registro.modo);
+        TEST_ASSERT_EQUAL_UINT32(100 + lote, registro.temperaturaAlvo);
+        TEST_ASSERT_EQUAL_UINT32(30000, registro.duracaoMs);
+        TEST_ASSERT_EQUAL_INT32(-1, registro.tempoAteAlvoMs);
+        TEST_ASSERT_EQUAL_UINT32(1, registro.amostras);
+    }
+    TEST_ASSERT_FALSE(indicadores_consulta(&indicadores, INDICADORES_HISTORICO, &registro));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_welfordPonderado);
+    RUN_TEST(test_aquecimentoEFaixa);
+    RUN_TEST(test_comutacoesEEnergia);
+    RUN_TEST(test_historico);
+    return UNITY_END();
+}
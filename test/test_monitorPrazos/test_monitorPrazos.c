@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <unity.h>
+#include "definitions.h"
+#include "monitorPrazos.h"
+
+/* Testes do monitor de prazos. As tasks adcRead e OutputControl são simuladas
+ * em tempo discreto, com passo de 1 ms: cada uma cumpre um ciclo a cada
+ * PERIODO_LEITURA_MS, e o timer do monitor verifica os prazos a cada
+ * MONITOR_PERIODO_MS, como em controleForno.c. */
+
+#define PASSO_US            1000
+#define PRAZO_US            (MONITOR_PRAZO_MS * 1000)
+#define TOLERANCIA_US       (MONITOR_TOLERANCIA_MS * 1000)
+#define VERIFICACAO_US      (MONITOR_PERIODO_MS * 1000)
+
+static monitorPrazos_t monitor;
+static prazo_t *prazoAdcRead;
+static prazo_t *prazoOutputControl;
+
+/* Resultado de uma simulação */
+typedef struct _simulacao {
+    int64_t primeiroCorte;      /* Instante do primeiro corte, ou -1         */
+    int64_t fimDoCorte;         /* Instante em que o corte foi liberado      */
+    int64_t tempoLigadoEmCorte; /* Tempo com a resistência ligada e em corte */
+} simulacao_t;
+
+/* Simula duracao us de cozimento. Entre inicioTravamento e fimTravamento a
+ * task travada não cumpre nenhum ciclo. A resistência simulada segue o
+ * OutputControl: fica ligada enquanto ele roda, exceto durante o corte, e só
+ * o timer do monitor a desliga enquanto o OutputControl estiver travado. */
+static void simula(int64_t duracao, prazo_t *travada, int64_t inicioTravamento, int64_t fimTravamento,
+                   simulacao_t *resultado)
+{
+    int64_t agora = 0;
+    int64_t ultimoAdcRead = 0;
+    int64_t ultimoOutputControl = 0;
+    bool resistencia = false;
+    bool corteAnterior = false;
+
+    resultado->primeiroCorte = -1;
+    resultado->fimDoCorte = -1;
+    resultado->tempoLigadoEmCorte = 0;
+
+    monitor_ativa(&monitor, 0);
+    for(agora = 0 ; agora <= duracao ; agora += PASSO_US)
+    {
+        bool travadoAgora = (agora >= inicioTravamento && agora < fimTravamento);
+
+        if(agora - ultimoAdcRead >= PERIODO_LEITURA_MS * 1000 && !(travadoAgora && travada == prazoAdcRead))
+        {
+            monitor_cumpre(&monitor, prazoAdcRead, agora);
+            ultimoAdcRead = agora;
+        }
+        if(agora - ultimoOutputControl >= PERIODO_LEITURA_MS * 1000 &&
+           !(travadoAgora && travada == prazoOutputControl))
+        {
+            monitor_cumpre(&monitor, prazoOutputControl, agora);
+            resistencia = !monitor.corte;
+            ultimoOutputControl = agora;
+        }
+        if(agora % VERIFICACAO_US == 0 && monitor_verifica(&monitor, agora))
+        {
+            resistencia = false;
+        }
+
+        if(monitor.corte && resistencia)
+        {
+            resultado->tempoLigadoEmCorte += PASSO_US;
+        }
+        if(monitor.corte && resultado->primeiroCorte < 0)
+        {
+            resultado->primeiroCorte = agora;
+        }
+        if(corteAnterior && !monitor.corte)
+        {
+            resultado->fimDoCorte = agora;
+        }
+        corteAnterior = monitor.corte;
+    }
+    monitor_desativa(&monitor);
+}
+
+void setUp()
+{
+    monitor_init(&monitor);
+    prazoAdcRead = monitor_adiciona(&monitor, "adcRead", PRAZO_US, TOLERANCIA_US);
+    prazoOutputControl = monitor_adiciona(&monitor, "OutputControl", PRAZO_US, TOLERANCIA_US);
+}
+
+void tearDown()
+{
+}
+
+void test_semTravamentoNaoHaCorte()
+{
+    simulacao_t resultado;
+
+    simula(60000000, NULL, 0, 0, &resultado);
+    TEST_ASSERT_EQUAL_INT64(-1, resultado.primeiroCorte);
+    TEST_ASSERT_EQUAL_UINT32(0, monitor.cortes);
+    TEST_ASSERT_EQUAL_UINT32(0, prazoAdcRead->perdidos);
+    TEST_ASSERT_EQUAL_UINT32(0, prazoOutputControl->perdidos);
+    TEST_ASSERT_EQUAL_UINT32(600, prazoOutputControl->cumpridos);
+}
+
+/* Um travamento de 3 s da task indicada a partir de 10 s. O último ciclo antes
+ * do travamento termina em 9,9 s, então o prazo é perdido em 10,05 s e o corte
+ * deve acontecer em até tolerância + período de verificação depois disso. */
+static void verificaTravamento(prazo_t *travada)
+{
+    simulacao_t resultado;
+    const int64_t ultimoCiclo = 9900000;
+    const int64_t prazoPerdido = ultimoCiclo + PRAZO_US;
+    int64_t latencia = 0;
+
+    simula(20000000, travada, 10000000, 13000000, &resultado);
+    latencia = resultado.primeiroCorte - prazoPerdido;
+    printf("%s travada: corte %lld us depois do prazo perdido (limite %d us), liberado em %lld us\n",
+           travada->nome, (long long)latencia, TOLERANCIA_US + VERIFICACAO_US, (long long)resultado.fimDoCorte);
+
+    TEST_ASSERT_EQUAL_UINT32(1, monitor.cortes);
+    TEST_ASSERT_TRUE(latencia > TOLERANCIA_US);
+    TEST_ASSERT_TRUE(latencia <= TOLERANCIA_US + VERIFICACAO_US);
+    TEST_ASSERT_EQUAL_INT64(resultado.primeiroCorte, monitor.instanteCorte);
+
+    /* O corte é liberado no primeiro ciclo cumprido depois do travamento */
+    TEST_ASSERT_EQUAL_INT64(13000000, resultado.fimDoCorte);
+    TEST_ASSERT_FALSE(monitor.corte);
+
+    /* Só a task travada perdeu um prazo, com atraso de 13 s - 10,05 s */
+    TEST_ASSERT_EQUAL_UINT32(1, travada->perdidos);
+    TEST_ASSERT_EQUAL_INT64(13000000 - prazoPerdido, travada->piorAtraso);
+    TEST_ASSERT_EQUAL_UINT32(0, (travada == prazoAdcRead ? prazoOutputControl : prazoAdcRead)->perdidos);
+}
+
+void test_travamentoAdcReadCortaResistencia()
+{
+    verificaTravamento(prazoAdcRead);
+}
+
+void test_travamentoOutputControlCortaResistencia()
+{
+    simulacao_t resultado;
+
+    verificaTravamento(prazoOutputControl);
+
+    /* Com o OutputControl travado a resistência ficaria ligada indefinidamente;
+     * o timer do monitor a desliga no mesmo instante do corte */
+    simula(20000000, prazoOutputControl, 10000000, 13000000, &resultado);
+    TEST_ASSERT_EQUAL_INT64(0, resultado.tempoLigadoEmCorte);
+}
+
+void test_monitorInativoNaoCorta()
+{
+    monitor_ativa(&monitor, 0);
+    monitor_desativa(&monitor);
+    TEST_ASSERT_FALSE(monitor_verifica(&monitor, 10000000));
+    monitor_cumpre(&monitor, prazoAdcRead, 10000000);
+    TEST_ASSERT_EQUAL_UINT32(0, prazoAdcRead->perdidos);
+    TEST_ASSERT_EQUAL_UINT32(0, monitor.cortes);
+}
+
+void test_limiteDePrazos()
+{
+    TEST_ASSERT_NOT_NULL(monitor_adiciona(&monitor, "c", PRAZO_US, TOLERANCIA_US));
+    TEST_ASSERT_NOT_NULL(monitor_adiciona(&monitor, "d", PRAZO_US, TOLERANCIA_US));
+    TEST_ASSERT_NULL(monitor_adiciona(&monitor, "e", PRAZO_US, TOLERANCIA_US));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_semTravamentoNaoHaCorte);
+    RUN_TEST(test_travamentoAdcReadCortaResistencia);
+    RUN_TEST(test_travamentoOutputControlCortaResistencia);
+    RUN_TEST(test_monitorInativoNaoCorta);
+    RUN_TEST(test_limiteDePrazos);
+    return UNITY_END();
+}
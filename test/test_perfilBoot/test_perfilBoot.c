@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "perfilBoot.h"
+
+/* Testes do registro das fases da inicialização, com instantes simulados */
+
+/* Fim de cada fase em us desde o reset, e a duração esperada de cada uma */
+static const char *fases[] = {"inicio da app_main", "configPins", "configAdc", "criacao das tasks", "pronto"};
+static const int64_t instantes[] = {180000, 181200, 181500, 430000, 431000};
+static const int64_t duracoes[] = {180000, 1200, 300, 248500, 1000};
+#define NUMERO_DE_FASES     (sizeof(fases) / sizeof(fases[0]))
+
+static void marcaFases()
+{
+    uint32_t i = 0;
+
+    for(i = 0 ; i < NUMERO_DE_FASES ; i++)
+    {
+        perfilBoot_simulaInstante(instantes[i]);
+        perfilBoot_marca(fases[i]);
+    }
+}
+
+void setUp()
+{
+    perfilBoot_limpa();
+}
+
+void tearDown()
+{
+    perfilBoot_simulaInstante(-1);
+}
+
+void test_marcas()
+{
+    const marcaBoot_t *marcas = NULL;
+    uint32_t i = 0;
+
+    TEST_ASSERT_EQUAL_UINT32(0, perfilBoot_marcas(&marcas));
+    marcaFases();
+    TEST_ASSERT_EQUAL_UINT32(NUMERO_DE_FASES, perfilBoot_marcas(&marcas));
+    for(i = 0 ; i < NUMERO_DE_FASES ; i++)
+    {
+        TEST_ASSERT_TRUE(marcas[i].fase == fases[i]);
+        TEST_ASSERT_EQUAL_INT64(instantes[i], marcas[i].instante);
+    }
+}
+
+/* Cada linha do relatório traz a duração da fase, medida desde o fim da
+ * anterior ou desde o reset, e o instante do seu fim */
+void test_relatorioPorFase()
+{
+    char relatorio[1024];
+    char *linha = NULL;
+    long long duracao = 0;
+    long long instante = 0;
+    size_t tamanho = 0;
+    uint32_t i = 0;
+
+    marcaFases();
+    tamanho = perfilBoot_relatorio(relatorio, sizeof(relatorio));
+    TEST_ASSERT_EQUAL_UINT32(strlen(relatorio), tamanho);
+
+    linha = strchr(relatorio, '\n');
+    TEST_ASSERT_NOT_NULL(linha);
+    for(i = 0 ; i < NUMERO_DE_FASES ; i++)
+    {
+        /* Os nomes podem ter espaços, então a duração e o instante são lidos
+         * a partir da coluna 25 */
+        TEST_ASSERT_EQUAL(0, strncmp(linha + 1, fases[i], strlen(fases[i])));
+        TEST_ASSERT_EQUAL(2, sscanf(linha + 1 + 24, "%lld %lld", &duracao, &instante));
+        TEST_ASSERT_EQUAL_INT64(duracoes[i], duracao);
+        TEST_ASSERT_EQUAL_INT64(instantes[i], instante);
+        linha = strchr(linha + 1, '\n');
+        TEST_ASSERT_NOT_NULL(linha);
+    }
+    TEST_ASSERT_EQUAL('\0', linha[1]);
+}
+
+/* Um buffer pequeno recebe só as linhas que cabem inteiras */
+void test_relatorioTruncado()
+{
+    char completo[1024];
+    char parcial[100];
+    size_t tamanho = 0;
+
+    marcaFases();
+    perfilBoot_relatorio(completo, sizeof(completo));
+    tamanho = perfilBoot_relatorio(parcial, sizeof(parcial));
+    TEST_ASSERT_TRUE(tamanho < sizeof(parcial));
+    TEST_ASSERT_EQUAL('\n', parcial[tamanho - 1]);
+    TEST_ASSERT_EQUAL(0, strncmp(completo, parcial, tamanho));
+    TEST_ASSERT_EQUAL_UINT32(0, perfilBoot_relatorio(parcial, 0));
+}
+
+/* Marcas além de PERFIL_BOOT_MAX_FASES são ignoradas */
+void test_limiteDeFases()
+{
+    const marcaBoot_t *marcas = NULL;
+    uint32_t i = 0;
+
+    for(i = 0 ; i < PERFIL_BOOT_MAX_FASES + 3 ; i++)
+    {
+        perfilBoot_simulaInstante(1000 * i);
+        perfilBoot_marca("fase");
+    }
+    TEST_ASSERT_EQUAL_UINT32(PERFIL_BOOT_MAX_FASES, perfilBoot_marcas(&marcas));
+    TEST_ASSERT_EQUAL_INT64(1000 * (PERFIL_BOOT_MAX_FASES - 1), marcas[PERFIL_BOOT_MAX_FASES - 1].instante);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_marcas);
+    RUN_TEST(test_relatorioPorFase);
+    RUN_TEST(test_relatorioTruncado);
+    RUN_TEST(test_limiteDeFases);
+    return UNITY_END();
+}
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "rastreioTarefas.h"
+
+/* Testes do rastreio das tasks e da sua exportação no formato do Chrome */
+
+#define CAPACIDADE      8
+
+static eventoRastreio_t eventos[CAPACIDADE];
+static rastreio_t rastreio;
+static const char tarefaA[] = "adcRead";
+static const char tarefaB[] = "OutputControl";
+static const char fila[] = "adc_queue";
+
+void setUp()
+{
+    rastreio_init(&rastreio, eventos, CAPACIDADE);
+}
+
+void tearDown()
+{
+}
+
+void test_nomesRegistradosUmaVez()
+{
+    eventoRastreio_t evento;
+
+    TEST_ASSERT_EQUAL(0, rastreio_tarefa(&rastreio, tarefaA, tarefaA, 10));
+    TEST_ASSERT_EQUAL(1, rastreio_tarefa(&rastreio, tarefaB, tarefaB, 20));
+    TEST_ASSERT_EQUAL(0, rastreio_tarefa(&rastreio, tarefaA, tarefaA, 30));
+    TEST_ASSERT_EQUAL(0, rastreio_objeto(&rastreio, fila, fila));
+    TEST_ASSERT_EQUAL(0, rastreio_procuraObjeto(&rastreio, fila));
+    TEST_ASSERT_EQUAL(RASTREIO_SEM_NOME, rastreio_procuraObjeto(&rastreio, tarefaA));
+
+    /* Só a primeira aparição de cada task gera o evento com o nome */
+    TEST_ASSERT_EQUAL(2, rastreio.tamanho);
+    TEST_ASSERT_TRUE(rastreio_retira(&rastreio, &evento));
+    TEST_ASSERT_EQUAL(RASTREIO_NOME_TAREFA, evento.tipo);
+    TEST_ASSERT_EQUAL(0, evento.tarefa);
+    TEST_ASSERT_TRUE(rastreio_retira(&rastreio, &evento));
+    TEST_ASSERT_EQUAL(1, evento.tarefa);
+    TEST_ASSERT_FALSE(rastreio_retira(&rastreio, &evento));
+}
+
+void test_tabelaDeNomesCheia()
+{
+    static char nomes[RASTREIO_MAX_NOMES + 1];
+    uint32_t i = 0;
+
+    for(i = 0 ; i < RASTREIO_MAX_NOMES ; i++)
+    {
+        TEST_ASSERT_EQUAL(i, rastreio_objeto(&rastreio, &nomes[i], "objeto"));
+    }
+    TEST_ASSERT_EQUAL(RASTREIO_SEM_NOME, rastreio_objeto(&rastreio, &nomes[RASTREIO_MAX_NOMES], "objeto"));
+}
+
+void test_bufferCheioDescartaNovos()
+{
+    eventoRastreio_t evento;
+    uint32_t i = 0;
+
+    /* O buffer dá voltas mantendo a ordem */
+    for(i = 0 ; i < 3 * CAPACIDADE ; i++)
+    {
+        rastreio_registra(&rastreio, i, RASTREIO_ENTRA, 0, 0, 0);
+        TEST_ASSERT_TRUE(rastreio_retira(&rastreio, &evento));
+        TEST_ASSERT_EQUAL(i, (uint32_t)evento.instante);
+    }
+
+    for(i = 0 ; i < CAPACIDADE + 3 ; i++)
+    {
+        rastreio_registra(&rastreio, i, RASTREIO_SAI, 1, 0, 0);
+    }
+    TEST_ASSERT_EQUAL(CAPACIDADE, rastreio.tamanho);
+    TEST_ASSERT_EQUAL(3, rastreio.perdidos);
+    for(i = 0 ; i < CAPACIDADE ; i++)
+    {
+        TEST_ASSERT_TRUE(rastreio_retira(&rastreio, &evento));
+        TEST_ASSERT_EQUAL(i, (uint32_t)evento.instante);
+    }
+    TEST_ASSERT_FALSE(rastreio_retira(&rastreio, &evento));
+}
+
+void test_formatoDosEventos()
+{
+    char texto[RASTREIO_TAMANHO_TEXTO];
+    eventoRastreio_t evento = {1234567, RASTREIO_ENTRA, 1, 0, 0};
+
+    rastreio_tarefa(&rastreio, tarefaA, tarefaA, 0);
+    rastreio_tarefa(&rastreio, tarefaB, tarefaB, 0);
+    rastreio_objeto(&rastreio, fila, fila);
+
+    rastreio_formata(&rastreio, &evento, texto, sizeof(texto));
+    TEST_ASSERT_EQUAL_STRING(",\n{\"name\":\"adcRead\",\"ph\":\"B\",\"ts\":1234.567,\"pid\":1,\"tid\":0,"
+                             "\"args\":{\"nucleo\":1}}", texto);
+
+    evento.tipo = RASTREIO_SAI;
+    rastreio_formata(&rastreio, &evento, texto, sizeof(texto));
+    TEST_ASSERT_EQUAL_STRING(",\n{\"ph\":\"E\",\"ts\":1234.567,\"pid\":1,\"tid\":0}", texto);
+
+    evento.tipo = RASTREIO_FILA_RECEBE;
+    evento.tarefa = 1;
+    evento.instante = 5000;
+    rastreio_formata(&rastreio, &evento, texto, sizeof(texto));
+    TEST_ASSERT_EQUAL_STRING(",\n{\"name\":\"recebe adc_queue\",\"ph\":\"i\",\"s\":\"t\",\"ts\":5.000,"
+                             "\"pid\":1,\"tid\":1}", texto);
+
+    evento.tipo = RASTREIO_NOTIFICA;
+    evento.objeto = 0;
+    rastreio_formata(&rastreio, &evento, texto, sizeof(texto));
+    TEST_ASSERT_EQUAL_STRING(",\n{\"name\":\"notifica adcRead\",\"ph\":\"i\",\"s\":\"t\",\"ts\":5.000,"
+                             "\"pid\":1,\"tid\":1}", texto);
+
+    /* Um texto truncado continua terminado em zero */
+    TEST_ASSERT_EQUAL(7, rastreio_formata(&rastreio, &evento, texto, 8));
+    TEST_ASSERT_EQUAL(7, strlen(texto));
+}
+
+void test_exportacaoCompleta()
+{
+    char texto[1024];
+    FILE *arquivo = tmpfile();
+    size_t n = 0;
+
+    TEST_ASSERT_NOT_NULL(arquivo);
+    rastreio_registra(&rastreio, 100000, RASTREIO_ENTRA, 0, rastreio_tarefa(&rastreio, tarefaA, tarefaA, 100000), 0);
+    rastreio_registra(&rastreio, 150000, RASTREIO_SAI, 0, 0, 0);
+    TEST_ASSERT_TRUE(rastreio_exporta(&rastreio, arquivo));
+    TEST_ASSERT_EQUAL(0, rastreio.tamanho);
+
+    rewind(arquivo);
+    n = fread(texto, 1, sizeof(texto) - 1, arquivo);
+    texto[n] = '\0';
+    fclose(arquivo);
+    TEST_ASSERT_EQUAL_STRING("[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"forno\"}},\n"
+                             "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"adcRead\"}},\n"
+                             "{\"name\":\"adcRead\",\"ph\":\"B\",\"ts\":100.000,\"pid\":1,\"tid\":0,\"args\":{\"nucleo\":0}},\n"
+                             "{\"ph\":\"E\",\"ts\":150.000,\"pid\":1,\"tid\":0}\n]\n", texto);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_nomesRegistradosUmaVez);
+    RUN_TEST(test_tabelaDeNomesCheia);
+    RUN_TEST(test_bufferCheioDescartaNovos);
+    RUN_TEST(test_formatoDosEventos);
+    RUN_TEST(test_exportacaoCompleta);
+    return UNITY_END();
+}
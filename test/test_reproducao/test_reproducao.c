@@ -0,0 +1,524 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unity.h>
+#include "definitions.h"
+#include "forno.h"
+#include "escalonadorPotencia.h"
+#include "gravacaoTraco.h"
+#include "reproducaoTraco.h"
+#include "termopar.h"
+
+/* Testes da gravação e reprodução de traços. Dois lotes são cozidos por um
+ * forno_t (forno.c) ligado a um modelo térmico simples, e gravados da mesma
+ * forma que o firmware faz com CAPTURA_TRACO: as leituras pelo halForno_t,
+ * os botões e os lotes depois de aplicados ao forno, e o nível aplicado pelo
+ * escalonador de potência depois de cada forno_controla. */
+
+#define INICIO_US               1000000     /* Botões e start                   */
+#define LOTE_SERIAL_US          5000000     /* Segundo lote, pela serial        */
+#define CORTE_US                8000000     /* Corte do monitor por 1 s         */
+#define PORTA_US                12000000    /* Porta aberta por 1 s no lote 1   */
+#define CARGA_US                3000000     /* Carga do lote 2 após o fim do 1  */
+#define FIM_SIMULACAO_US        120000000
+
+/* Forno simulado que grava o seu traço */
+typedef struct _fornoGravado {
+    forno_t forno;
+    traco_t traco;
+    escalonador_t escalonador;
+    uint32_t saida;
+    int64_t agora;
+    float temperatura;
+    bool resistencia;
+    uint32_t semente;
+} fornoGravado_t;
+
+static FILE *arquivo;
+static uint32_t leiturasGravadas;
+static uint32_t ligadasNoPreaquecimento;
+static uint32_t leiturasComCorte;
+
+static int32_t ruido(fornoGravado_t *gravado)
+{
+    gravado->semente = gravado->semente * 1103515245u + 12345u;
+    return (int32_t)((gravado->semente >> 16) % 9) - 4;
+}
+
+static int64_t gravadoAgora(void *contexto)
+{
+    return ((fornoGravado_t *)contexto)->agora;
+}
+
+/* LM35: 10mV/°C, escala de 3.3V em 12 bits */
+static void gravadoLeAdc(void *contexto, uint16_t *amostras, uint32_t n)
+{
+    fornoGravado_t *gravado = (fornoGravado_t *)contexto;
+    uint32_t i = 0;
+
+    for(i = 0 ; i < n ; i++)
+    {
+        amostras[i] = (uint16_t)(gravado->temperatura * 0.010f / 3.3f * 4095 + ruido(gravado));
+    }
+    traco_gravaAmostras(&gravado->traco, gravado->agora, amostras, n);
+}
+
+static bool gravadoLeTermopar(void *contexto, uint16_t *quadro)
+{
+    fornoGravado_t *gravado = (fornoGravado_t *)contexto;
+
+    *quadro = termopar_simulaQuadro(gravado->temperatura + ruido(gravado) * 0.1f, false);
+    traco_gravaTermopar(&gravado->traco, gravado->agora + 200, *quadro, true);
+    return true;
+}
+
+/* Como no firmware, o pedido de ligar só é aplicado pelo escalonador, e
+ * desligar é imediato */
+static void gravadoResistencia(void *contexto, bool nivel)
+{
+    fornoGravado_t *gravado = (fornoGravado_t *)contexto;
+
+    escalonador_pede(&gravado->escalonador, gravado->saida, nivel);
+    if(!nivel)
+    {
+        gravado->resistencia = false;
+    }
+}
+
+static void gravadoLedsModo(void *contexto, modo_t modo)
+{
+}
+
+static void gravadoLedsPonto(void *contexto, ponto_t ponto)
+{
+}
+
+/* Porta aberta ou fechada, como a task porta */
+static void gravaPorta(fornoGravado_t *gravado, bool aberta)
+{
+    forno_t *forno = &gravado->forno;
+
+    forno_porta(forno, aberta);
+    traco_gravaBotao(&gravado->traco, gravado->agora, aberta ? BOTAO_PORTA_ABERTA : BOTAO_PORTA_FECHADA);
+    if(forno_iniciaProximo(forno) > 0)
+    {
+        traco_gravaInicio(&gravado->traco, gravado->agora, forno->modo, forno->ponto);
+    }
+}
+
+/* Grava em arquivo dois lotes: ASSAR MAL_PASSADO pelos botões e GRATINAR
+ * AO_PONTO pela serial, carregado depois de um preaquecimento. Durante o
+ * primeiro lote o monitor de prazos corta a resistência por 1 s, e a porta
+ * fica aberta por 1 s. */
+static void gravaCozimentoSimulado()
+{
+    static fornoGravado_t gravado;
+    halForno_t hal = {&gravado, gravadoAgora, gravadoLeAdc, gravadoLeTermopar, gravadoResistencia,
+                      gravadoLedsModo, gravadoLedsPonto};
+    forno_t *forno = &gravado.forno;
+    leitura_t leitura;
+    int64_t fimLote1 = -1;
+    int64_t anterior = 0;
+    uint32_t periodoMs = PERIODO_LEITURA_MS;
+    bool iniciado = false;
+    bool loteSerial = false;
+    bool portaAberta = false;
+    bool corte = false;
+    bool nivel = false;
+    float dt = 0;
+
+    arquivo = tmpfile();
+    TEST_ASSERT_NOT_NULL(arquivo);
+    TEST_ASSERT_TRUE(traco_inicia(&gravado.traco, arquivo));
+    escalonador_init(&gravado.escalonador, ORCAMENTO_POTENCIA_W, ESCALONADOR_LIGAMENTOS_SLOT,
+                     ESCALONADOR_TEMPO_MINIMO_MS);
+    gravado.saida = (uint32_t)escalonador_adicionaSaida(&gravado.escalonador, "resistencia", POTENCIA_RESISTENCIA_W);
+    gravado.agora = 0;
+    gravado.temperatura = 25.0f;
+    gravado.resistencia = false;
+    gravado.semente = 1;
+    forno_init(forno, &hal);
+    leiturasGravadas = 0;
+    ligadasNoPreaquecimento = 0;
+    leiturasComCorte = 0;
+
+    while(gravado.agora < FIM_SIMULACAO_US)
+    {
+        /* Botões, serial e porta, gravados depois de aplicados como nas tasks */
+        if(!iniciado && gravado.agora >= INICIO_US)
+        {
+            forno_selecionaModo(forno);
+            traco_gravaBotao(&gravado.traco, gravado.agora, BOTAO_MODO);
+            forno_selecionaPonto(forno);
+            traco_gravaBotao(&gravado.traco, gravado.agora, BOTAO_PONTO);
+            TEST_ASSERT_GREATER_THAN(0, forno_inicia(forno));
+            traco_gravaBotao(&gravado.traco, gravado.agora, BOTAO_START);
+            traco_gravaInicio(&gravado.traco, gravado.agora, forno->modo, forno->ponto);
+            iniciado = true;
+        }
+        if(!loteSerial && gravado.agora >= LOTE_SERIAL_US)
+        {
+            TEST_ASSERT_TRUE(forno_adicionaLote(forno, GRATINAR, AO_PONTO));
+            traco_gravaLote(&gravado.traco, gravado.agora, GRATINAR, AO_PONTO);
+            loteSerial = true;
+        }
+        if(portaAberta != ((gravado.agora >= PORTA_US && gravado.agora < PORTA_US + 1000000) ||
+                           (fimLote1 >= 0 && gravado.agora >= fimLote1 + CARGA_US &&
+                            gravado.agora < fimLote1 + CARGA_US + 1000000)))
+        {
+            portaAberta = !portaAberta;
+            gravaPorta(&gravado, portaAberta);
+        }
+        corte = (gravado.agora >= CORTE_US && gravado.agora < CORTE_US + 1000000);
+
+        /* Modelo térmico: 15°C/s com a resistência ligada e perdas
+         * proporcionais à diferença para o ambiente */
+        dt = (float)(gravado.agora - anterior) / 1e6f;
+        anterior = gravado.agora;
+        gravado.temperatura += dt * ((gravado.resistencia ? 15.0f : 0.0f) - 0.03f * (gravado.temperatura - 25.0f));
+
+        /* adcRead e OutputControl só executam com o controle ativo */
+        if(forno->status != AGUARDANDO_ACAO && forno_leSensores(forno, &leitura))
+        {
+            forno_controla(forno, &leitura, corte);
+            periodoMs = forno_periodoLeituraMs(forno);
+            escalonador_executa(&gravado.escalonador, periodoMs);
+            nivel = escalonador_ligada(&gravado.escalonador, gravado.saida);
+            forno_confirmaResistencia(forno, nivel);
+            gravado.resistencia = nivel;
+            traco_gravaRele(&gravado.traco, gravado.agora + 300, nivel, corte);
+            leiturasGravadas++;
+            ligadasNoPreaquecimento += (nivel && forno->status == PREAQUECENDO) ? 1 : 0;
+            leiturasComCorte += corte ? 1 : 0;
+        }
+
+        /* Timer do tempo de funcionamento, como a task finalizaCozimento */
+        if(forno->status == ACAO_INICIADA && forno_restante(forno) <= 0)
+        {
+            forno_verificaFim(forno);
+            traco_gravaFim(&gravado.traco, gravado.agora + 400);
+            if(fimLote1 < 0)
+            {
+                fimLote1 = gravado.agora;
+            }
+            else
+            {
+                break;
+            }
+        }
+        gravado.agora += (forno->status == AGUARDANDO_ACAO ? PERIODO_LEITURA_MS : forno_periodoLeituraMs(forno)) * 1000;
+    }
+    TEST_ASSERT_EQUAL(2, forno->lotesConcluidos);
+    traco_gravaFim(&gravado.traco, gravado.agora + 1000);
+    fflush(arquivo);
+}
+
+/* Versão alternativa do controlador, com histerese de 2°C em torno do alvo */
+typedef struct _controladorHisterese {
+    bool nivel;
+} controladorHisterese_t;
+
+static versaoControlador_t versaoAtual;
+
+static void histereseInicia(void *estado)
+{
+    ((controladorHisterese_t *)estado)->nivel = false;
+}
+
+static void histereseControla(void *estado, forno_t *forno, const leitura_t *leitura, bool corte)
+{
+    controladorHisterese_t *histerese = (controladorHisterese_t *)estado;
+    float alvo = 0;
+
+    forno_controla(forno, leitura, corte);
+    alvo = (float)forno_temperaturaAlvo(forno);
+    if(corte || forno->portaAberta || forno->status == AGUARDANDO_ACAO ||
+       forno->sessao.estado == SESSAO_PAUSADA || forno->controle.fusao.divergencia)
+    {
+        histerese->nivel = false;
+    }
+    else if(forno->controle.temperaturaAtual > alvo + 2.0f)
+    {
+        histerese->nivel = false;
+    }
+    else if(forno->controle.temperaturaAtual < alvo - 2.0f)
+    {
+        histerese->nivel = true;
+    }
+    forno->hal.resistencia(forno->hal.contexto, histerese->nivel);
+}
+
+void setUp()
+{
+    reproducao_versaoAtual(&versaoAtual);
+    gravaCozimentoSimulado();
+}
+
+void tearDown()
+{
+    fclose(arquivo);
+}
+
+void test_ida_e_volta_dos_eventos()
+{
+    static eventoTraco_t evento;
+    uint16_t amostras[5] = {0, 4095, 1234, 7, 2048};
+    traco_t traco;
+    FILE *temporario = tmpfile();
+    uint32_t i = 0;
+
+    TEST_ASSERT_TRUE(traco_inicia(&traco, temporario));
+    traco_gravaAmostras(&traco, 10, amostras, 5);
+    traco_gravaTermopar(&traco, 300000, 0x1234, true);
+    traco_gravaBotao(&traco, 300000, BOTAO_PORTA_ABERTA);
+    traco_gravaInicio(&traco, 5000000000LL, GRELHAR, AO_PONTO);
+    traco_gravaRele(&traco, 5000000001LL, true, false);
+    traco_gravaRele(&traco, 5000000001LL, false, true);
+    traco_gravaLote(&traco, 5000000002LL, GRATINAR, BEM_PASSADO);
+    traco_gravaFim(&traco, 5000000002LL);
+    rewind(temporario);
+
+    TEST_ASSERT_TRUE(traco_abre(&traco, temporario));
+    TEST_ASSERT_TRUE(traco_leEvento(&traco, &evento));
+    TEST_ASSERT_EQUAL(TRACO_AMOSTRAS, evento.tipo);
+    TEST_ASSERT_EQUAL(10, evento.instante);
+    TEST_ASSERT_EQUAL(5, evento.numeroDeAmostras);
+    for(i = 0 ; i < 5 ; i++)
+    {
+        TEST_ASSERT_EQUAL(amostras[i], evento.amostras[i]);
+    }
+    TEST_ASSERT_TRUE(traco_leEvento(&traco, &evento));
+    TEST_ASSERT_EQUAL(TRACO_TERMOPAR, evento.tipo);
+    TEST_ASSERT_EQUAL(0x1234, evento.quadro);
+    TEST_ASSERT_TRUE(traco_leEvento(&traco, &evento));
+    TEST_ASSERT_EQUAL(BOTAO_PORTA_ABERTA, evento.botao);
+    TEST_ASSERT_EQUAL(300000, evento.instante);
+    TEST_ASSERT_TRUE(traco_leEvento(&traco, &evento));
+    TEST_ASSERT_EQUAL(TRACO_INICIO, evento.tipo);
+    TEST_ASSERT_EQUAL(GRELHAR, evento.modo);
+    TEST_ASSERT_EQUAL(AO_PONTO, evento.ponto);
+    TEST_ASSERT_EQUAL(5000000000LL, evento.instante);
+    TEST_ASSERT_TRUE(traco_leEvento(&traco, &evento));
+    TEST_ASSERT_TRUE(evento.nivel);
+    TEST_ASSERT_FALSE(evento.corte);
+    TEST_ASSERT_TRUE(traco_leEvento(&traco, &evento));
+    TEST_ASSERT_FALSE(evento.nivel);
+    TEST_ASSERT_TRUE(evento.corte);
+    TEST_ASSERT_TRUE(traco_leEvento(&traco, &evento));
+    TEST_ASSERT_EQUAL(TRACO_LOTE, evento.tipo);
+    TEST_ASSERT_EQUAL(GRATINAR, evento.modo);
+    TEST_ASSERT_EQUAL(BEM_PASSADO, evento.ponto);
+    TEST_ASSERT_TRUE(traco_leEvento(&traco, &evento));
+    TEST_ASSERT_EQUAL(TRACO_FIM, evento.tipo);
+    TEST_ASSERT_FALSE(traco_leEvento(&traco, &evento));
+    fclose(temporario);
+}
+
+/* Retira o buffer em blocos pequenos, como a task que o descarrega */
+static void descarregaBuffer(traco_t *traco, FILE *destino)
+{
+    uint8_t bloco[7];
+    uint32_t n = 0;
+
+    while((n = traco_retira(traco, bloco, sizeof(bloco))) > 0)
+    {
+        fwrite(bloco, 1, n, destino);
+    }
+}
+
+/* Grava a mesma sequência de eventos no traço, descarregando o buffer em
+ * descarga a cada leitura se ela não for NULL */
+static void gravaEventos(traco_t *traco, uint32_t n, FILE *descarga)
+{
+    uint16_t amostras[3] = {100, 200, 300};
+    uint32_t i = 0;
+
+    for(i = 0 ; i < n ; i++)
+    {
+        traco_gravaAmostras(traco, i * 1000, amostras, 3);
+        traco_gravaTermopar(traco, i * 1000 + 200, 0x1234, true);
+        traco_gravaRele(traco, i * 1000 + 300, (i % 2) == 0, false);
+        if(descarga != NULL)
+        {
+            descarregaBuffer(traco, descarga);
+        }
+    }
+    traco_gravaFim(traco, n * 1000);
+}
+
+/* Descarregado a tempo, o buffer produz o mesmo arquivo da gravação direta,
+ * mesmo dando várias voltas */
+void test_gravacao_com_buffer()
+{
+    static uint8_t buffer[64];
+    static uint8_t direto[1024];
+    static uint8_t bufferizado[1024];
+    traco_t traco;
+    FILE *a = tmpfile();
+    FILE *b = tmpfile();
+    size_t tamanhoA = 0;
+    size_t tamanhoB = 0;
+
+    TEST_ASSERT_TRUE(traco_inicia(&traco, a));
+    gravaEventos(&traco, 20, NULL);
+    TEST_ASSERT_TRUE(traco_inicia(&traco, b));
+    traco_usaBuffer(&traco, buffer, sizeof(buffer));
+    gravaEventos(&traco, 20, b);
+    descarregaBuffer(&traco, b);
+    TEST_ASSERT_EQUAL(0, traco.perdidos);
+
+    rewind(a);
+    rewind(b);
+    tamanhoA = fread(direto, 1, sizeof(direto), a);
+    tamanhoB = fread(bufferizado, 1, sizeof(bufferizado), b);
+    TEST_ASSERT_GREATER_THAN(sizeof(buffer), tamanhoA);
+    TEST_ASSERT_EQUAL(tamanhoA, tamanhoB);
+    TEST_ASSERT_EQUAL_MEMORY(direto, bufferizado, tamanhoA);
+    fclose(a);
+    fclose(b);
+}
+
+/* Com o buffer cheio os eventos são descartados inteiros, e o traço
+ * continua legível */
+void test_buffer_cheio_descarta_eventos()
+{
+    static eventoTraco_t evento;
+    static uint8_t buffer[40];
+    traco_t traco;
+    FILE *temporario = tmpfile();
+    uint32_t lidos = 0;
+
+    TEST_ASSERT_TRUE(traco_inicia(&traco, temporario));
+    traco_usaBuffer(&traco, buffer, sizeof(buffer));
+    gravaEventos(&traco, 10, NULL);
+    TEST_ASSERT_GREATER_THAN(0, traco.perdidos);
+    TEST_ASSERT_LESS_OR_EQUAL(sizeof(buffer), traco.tamanho);
+    descarregaBuffer(&traco, temporario);
+    TEST_ASSERT_EQUAL(0, traco.tamanho);
+
+    rewind(temporario);
+    TEST_ASSERT_TRUE(traco_abre(&traco, temporario));
+    while(traco_leEvento(&traco, &evento))
+    {
+        TEST_ASSERT_TRUE(evento.tipo == TRACO_AMOSTRAS || evento.tipo == TRACO_TERMOPAR ||
+                         evento.tipo == TRACO_RELE || evento.tipo == TRACO_FIM);
+        lidos++;
+    }
+    TEST_ASSERT_GREATER_THAN(0, lidos);
+    fclose(temporario);
+}
+
+/* Cada novo traço empurra os anteriores uma geração, e só as últimas
+ * geracoes são mantidas */
+void test_rotacao_dos_tracos()
+{
+    const char *caminho = "rotacao_teste.bin";
+    char nome[32];
+    char conteudo[4];
+    FILE *f = NULL;
+    uint32_t i = 0;
+
+    for(i = 1 ; i <= 4 ; i++)
+    {
+        TEST_ASSERT_TRUE(traco_rotaciona(caminho, 3));
+        f = fopen(caminho, "wb");
+        TEST_ASSERT_NOT_NULL(f);
+        fprintf(f, "%u", (unsigned)i);
+        fclose(f);
+    }
+    TEST_ASSERT_TRUE(traco_rotaciona(caminho, 3));
+    TEST_ASSERT_NULL(fopen(caminho, "rb"));
+    for(i = 1 ; i <= 3 ; i++)
+    {
+        snprintf(nome, sizeof(nome), "%s.%u", caminho, (unsigned)i);
+        f = fopen(nome, "rb");
+        TEST_ASSERT_NOT_NULL(f);
+        TEST_ASSERT_NOT_NULL(fgets(conteudo, sizeof(conteudo), f));
+        fclose(f);
+        /* O mais recente é a geração 1, e o primeiro foi apagado */
+        TEST_ASSERT_EQUAL(5 - i, atoi(conteudo));
+        remove(nome);
+    }
+}
+
+void test_traco_invalido()
+{
+    reproducao_t resultado;
+    FILE *temporario = tmpfile();
+
+    fputs("XXXX", temporario);
+    rewind(temporario);
+    TEST_ASSERT_FALSE(reproducao_executa(temporario, &versaoAtual, &resultado));
+    fclose(temporario);
+}
+
+/* A versão atual, reproduzida sobre o seu próprio traço, deve tomar
+ * exatamente as mesmas decisões gravadas, mais rápido que o tempo real. O
+ * traço tem o preaquecimento do segundo lote, a porta aberta e o corte do
+ * monitor, que só são reproduzidos através do forno_t. */
+void test_reproducao_identica_ao_gravado()
+{
+    reproducao_t resultado;
+    diferencaReproducao_t diferenca;
+    clock_t inicio = 0;
+    double segundos = 0;
+    uint32_t i = 0;
+
+    rewind(arquivo);
+    inicio = clock();
+    TEST_ASSERT_TRUE(reproducao_executa(arquivo, &versaoAtual, &resultado));
+    segundos = (double)(clock() - inicio) / CLOCKS_PER_SEC;
+
+    TEST_ASSERT_GREATER_THAN(0, ligadasNoPreaquecimento);
+    TEST_ASSERT_GREATER_THAN(0, leiturasComCorte);
+    TEST_ASSERT_EQUAL(leiturasGravadas, resultado.numeroDeDecisoes);
+    for(i = 0 ; i < resultado.numeroDeDecisoes ; i++)
+    {
+        TEST_ASSERT_TRUE(resultado.decisoes[i].temReleGravado);
+    }
+    reproducao_compara(&resultado, &resultado, &diferenca);
+    TEST_ASSERT_EQUAL(0, diferenca.releDiferente);
+    TEST_ASSERT_EQUAL(0, diferenca.diferentesDoGravado[0]);
+    TEST_ASSERT_GREATER_THAN(0, diferenca.chaveamentos[0]);
+    TEST_ASSERT_LESS_THAN(resultado.duracaoTraco / 1e6 / 100, segundos);
+    printf("Traco de %.1f s reproduzido em %.4f s\n", resultado.duracaoTraco / 1e6, segundos);
+    reproducao_libera(&resultado);
+}
+
+void test_compara_duas_versoes()
+{
+    static controladorHisterese_t estadoHisterese;
+    versaoControlador_t histerese = {"histerese", &estadoHisterese, histereseInicia, histereseControla};
+    reproducao_t a;
+    reproducao_t b;
+    diferencaReproducao_t diferenca;
+
+    rewind(arquivo);
+    TEST_ASSERT_TRUE(reproducao_executa(arquivo, &versaoAtual, &a));
+    rewind(arquivo);
+    TEST_ASSERT_TRUE(reproducao_executa(arquivo, &histerese, &b));
+
+    reproducao_compara(&a, &b, &diferenca);
+    reproducao_relatorio(stdout, versaoAtual.nome, histerese.nome, &diferenca);
+    TEST_ASSERT_EQUAL(leiturasGravadas, diferenca.leituras);
+    TEST_ASSERT_GREATER_THAN(0, diferenca.releDiferente);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, diferenca.primeiraDiferenca);
+    TEST_ASSERT_LESS_THAN(diferenca.chaveamentos[0], diferenca.chaveamentos[1]);
+    TEST_ASSERT_EQUAL(0, diferenca.diferentesDoGravado[0]);
+    TEST_ASSERT_GREATER_THAN(0, diferenca.diferentesDoGravado[1]);
+    reproducao_libera(&a);
+    reproducao_libera(&b);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_ida_e_volta_dos_eventos);
+    RUN_TEST(test_traco_invalido);
+    RUN_TEST(test_gravacao_com_buffer);
+    RUN_TEST(test_buffer_cheio_descarta_eventos);
+    RUN_TEST(test_rotacao_dos_tracos);
+    RUN_TEST(test_reproducao_identica_ao_gravado);
+    RUN_TEST(test_compara_duas_versoes);
+    return UNITY_END();
+}
@@ -0,0 +1,239 @@
+#include <stddef.h>
+#include <string.h>
+#include <unity.h>
+#include "definitions.h"
+#include "forno.h"
+#include "salvamentoCozimento.h"
+#include "sessaoCozimento.h"
+
+/* Testes do salvamento do cozimento, com a memória RTC e a flash simuladas */
+
+static forno_t forno;
+static int64_t relogio;
+
+static int64_t testeAgora(void *contexto)
+{
+    return relogio;
+}
+
+static void testeLeAdc(void *contexto, uint16_t *amostras, uint32_t n)
+{
+}
+
+static bool testeLeTermopar(void *contexto, uint16_t *quadro)
+{
+    return false;
+}
+
+static void testeResistencia(void *contexto, bool nivel)
+{
+}
+
+static void testeLedsModo(void *contexto, modo_t modo)
+{
+}
+
+static void testeLedsPonto(void *contexto, ponto_t ponto)
+{
+}
+
+static const halForno_t hal = {
+    .contexto = NULL,
+    .agora = testeAgora,
+    .leAdc = testeLeAdc,
+    .leTermopar = testeLeTermopar,
+    .resistencia = testeResistencia,
+    .ledsModo = testeLedsModo,
+    .ledsPonto = testeLedsPonto,
+};
+
+void setUp()
+{
+    relogio = 0;
+    salvamento_simulaApaga();
+    forno_init(&forno, &hal);
+}
+
+void tearDown()
+{
+}
+
+/* Grava o estado atual do forno */
+static void grava(salvamento_t *salvamento)
+{
+    registroCozimento_t registro;
+
+    salvamento_captura(&forno, &registro);
+    TEST_ASSERT_TRUE(salvamento_grava(salvamento, &registro, relogio));
+}
+
+void test_registroValido()
+{
+    salvamento_t salvamento;
+    registroCozimento_t registro;
+
+    TEST_ASSERT_FALSE(salvamento_init(&salvamento, &registro));
+    grava(&salvamento);
+    TEST_ASSERT_TRUE(salvamento_init(&salvamento, &registro));
+    TEST_ASSERT_TRUE(salvamento_valido(&registro));
+    TEST_ASSERT_EQUAL_UINT32(1, registro.sequencia);
+
+    /* Qualquer byte alterado invalida o registro */
+    ((uint8_t *)&registro)[offsetof(registroCozimento_t, decorridoMs)] ^= 0x01;
+    TEST_ASSERT_FALSE(salvamento_valido(&registro));
+
+    /* Valor de referência do CRC-32 */
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926u, salvamento_crc("123456789", 9));
+}
+
+void test_restauraCozimento()
+{
+    salvamento_t salvamento;
+    registroCozimento_t registro;
+    forno_t restaurado;
+    lote_t lote;
+
+    /* Um cozimento GRELHAR AO_PONTO 12s depois do início, com dois lotes na
+     * fila e a estimativa de temperatura em 250°C */
+    forno.modo = GRELHAR;
+    forno.ponto = AO_PONTO;
+    TEST_ASSERT_TRUE(forno_inicia(&forno) > 0);
+    TEST_ASSERT_TRUE(forno_adicionaLote(&forno, ASSAR, BEM_PASSADO));
+    TEST_ASSERT_TRUE(forno_adicionaLote(&forno, GRATINAR, MAL_PASSADO));
+    forno.controle.fusao.estimativa = 250.0f;
+    salvamento_init(&salvamento, &registro);
+    relogio = 12000000;
+    grava(&salvamento);
+
+    /* Depois do reset o cozimento volta pausado, e é retomado pela porta */
+    relogio = 3000;
+    forno_init(&restaurado, &hal);
+    TEST_ASSERT_TRUE(salvamento_init(&salvamento, &registro));
+    salvamento_restaura(&restaurado, &registro);
+    TEST_ASSERT_EQUAL(ACAO_INICIADA, restaurado.status);
+    TEST_ASSERT_EQUAL(GRELHAR, restaurado.modo);
+    TEST_ASSERT_EQUAL(AO_PONTO, restaurado.ponto);
+    TEST_ASSERT_EQUAL(SESSAO_PAUSADA, restaurado.sessao.estado);
+    TEST_ASSERT_EQUAL_INT64(TEMPO_AO_PONTO * 1000LL - 12000000, forno_restante(&restaurado));
+    TEST_ASSERT_TRUE(forno_porta(&restaurado, false));
+    TEST_ASSERT_EQUAL(SESSAO_EM_CURSO, restaurado.sessao.estado);
+    TEST_ASSERT_TRUE(restaurado.controle.fusao.estimativa == 250.0f);
+
+    TEST_ASSERT_EQUAL_UINT32(2, restaurado.fila.tamanho);
+    TEST_ASSERT_TRUE(filaLotes_retira(&restaurado.fila, &lote));
+    TEST_ASSERT_EQUAL(ASSAR, lote.modo);
+    TEST_ASSERT_EQUAL(BEM_PASSADO, lote.ponto);
+    TEST_ASSERT_TRUE(filaLotes_retira(&restaurado.fila, &lote));
+    TEST_ASSERT_EQUAL(GRATINAR, lote.modo);
+    TEST_ASSERT_EQUAL(MAL_PASSADO, lote.ponto);
+}
+
+/* Uma queda no meio de uma gravação na RTC estraga só a cópia sendo gravada,
+ * e a recuperação usa a anterior */
+void test_gravacaoInterrompida()
+{
+    salvamento_t salvamento;
+    registroCozimento_t registro;
+
+    forno_inicia(&forno);
+    salvamento_init(&salvamento, &registro);
+    relogio = 1000000;
+    grava(&salvamento);
+    relogio = 2000000;
+    grava(&salvamento);
+    salvamento_simulaQueda(false, true);
+
+    TEST_ASSERT_TRUE(salvamento_init(&salvamento, &registro));
+    TEST_ASSERT_EQUAL_UINT32(1, registro.sequencia);
+    TEST_ASSERT_EQUAL_UINT32(1000, registro.decorridoMs);
+
+    /* A próxima gravação ocupa a cópia estragada */
+    grava(&salvamento);
+    TEST_ASSERT_TRUE(salvamento_init(&salvamento, &registro));
+    TEST_ASSERT_EQUAL_UINT32(2, registro.sequencia);
+    TEST_ASSERT_EQUAL_UINT32(2000, registro.decorridoMs);
+}
+
+/* Sem a memória RTC o registro vem da flash, que é mais antigo */
+void test_rtcPerdida()
+{
+    salvamento_t salvamento;
+    registroCozimento_t registro;
+
+    forno_inicia(&forno);
+    salvamento_init(&salvamento, &registro);
+    for(relogio = 1000000 ; relogio <= 15000000 ; relogio += 1000000)
+    {
+        grava(&salvamento);
+    }
+    TEST_ASSERT_TRUE(salvamento_init(&salvamento, &registro));
+    TEST_ASSERT_EQUAL_UINT32(15000, registro.decorridoMs);
+
+    /* A primeira gravação foi para a flash porque o estado mudou, e a seguinte
+     * SALVAMENTO_PERIODO_FLASH_MS depois */
+    salvamento_simulaQueda(true, false);
+    TEST_ASSERT_TRUE(salvamento_init(&salvamento, &registro));
+    TEST_ASSERT_EQUAL_UINT32(11, registro.sequencia);
+    TEST_ASSERT_EQUAL_UINT32(1000 + SALVAMENTO_PERIODO_FLASH_MS, registro.decorridoMs);
+}
+
+/* Avança n períodos de salvamento e retorna quantas gravações na flash
+ * aconteceram neles */
+static uint32_t gravaPeriodos(salvamento_t *salvamento, uint32_t n)
+{
+    uint32_t antes = salvamento_simulaGravacoesFlash();
+    uint32_t i = 0;
+
+    for(i = 0 ; i < n ; i++)
+    {
+        relogio += SALVAMENTO_PERIODO_MS * 1000;
+        /* O tempo de divergência muda sem que o estado mude */
+        forno.controle.fusao.divergenteMs = (i % 3) * PERIODO_LEITURA_MS;
+        grava(salvamento);
+    }
+    return salvamento_simulaGravacoesFlash() - antes;
+}
+
+/* A flash só é gravada nas mudanças de estado e, com um lote em curso, a cada
+ * SALVAMENTO_PERIODO_FLASH_MS */
+void test_gravacoesDaFlash()
+{
+    salvamento_t salvamento;
+    registroCozimento_t registro;
+
+    salvamento_init(&salvamento, &registro);
+    TEST_ASSERT_EQUAL_UINT32(1, gravaPeriodos(&salvamento, 1000));
+    TEST_ASSERT_EQUAL_UINT32(1000, salvamento.gravacoesRtc);
+
+    /* Em curso: a mudança de status, e depois uma a cada período da flash */
+    forno_inicia(&forno);
+    TEST_ASSERT_EQUAL_UINT32(100 * SALVAMENTO_PERIODO_MS / SALVAMENTO_PERIODO_FLASH_MS,
+                             gravaPeriodos(&salvamento, 100));
+
+    /* Pausado o tempo decorrido não muda, e só a pausa é gravada */
+    forno_porta(&forno, true);
+    TEST_ASSERT_EQUAL_UINT32(1, gravaPeriodos(&salvamento, 100));
+    forno_porta(&forno, false);
+    TEST_ASSERT_EQUAL_UINT32(100 * SALVAMENTO_PERIODO_MS / SALVAMENTO_PERIODO_FLASH_MS,
+                             gravaPeriodos(&salvamento, 100));
+
+    /* Entre dois lotes também não há nada a gravar periodicamente */
+    forno.status = PREAQUECENDO;
+    sessao_encerra(&forno.sessao);
+    TEST_ASSERT_EQUAL_UINT32(1, gravaPeriodos(&salvamento, 100));
+
+    /* A fila é parte do estado */
+    TEST_ASSERT_TRUE(forno_adicionaLote(&forno, ASSAR, BEM_PASSADO));
+    TEST_ASSERT_EQUAL_UINT32(1, gravaPeriodos(&salvamento, 1));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_registroValido);
+    RUN_TEST(test_restauraCozimento);
+    RUN_TEST(test_gravacaoInterrompida);
+    RUN_TEST(test_rtcPerdida);
+    RUN_TEST(test_gravacoesDaFlash);
+    return UNITY_END();
+}
@@ -0,0 +1,97 @@
+#include <unity.h>
+#include "sessaoCozimento.h"
+
+/* Testes da contabilidade do tempo de um cozimento. Os instantes e as durações
+ * estão em us, como os do esp_timer. */
+
+#define S       1000000LL
+
+static sessao_t sessao;
+
+void setUp()
+{
+    sessao_encerra(&sessao);
+}
+
+void tearDown()
+{
+}
+
+void test_sessaoInativa()
+{
+    TEST_ASSERT_EQUAL_INT64(0, sessao_restante(&sessao, 10 * S));
+    TEST_ASSERT_FALSE(sessao_pausa(&sessao, 10 * S));
+    TEST_ASSERT_FALSE(sessao_retoma(&sessao, 10 * S));
+    sessao_estende(&sessao, 30 * S);
+    TEST_ASSERT_EQUAL_INT64(0, sessao_restante(&sessao, 10 * S));
+}
+
+void test_restanteEmCurso()
+{
+    sessao_inicia(&sessao, 60 * S, 100 * S);
+    TEST_ASSERT_EQUAL_INT64(60 * S, sessao_restante(&sessao, 100 * S));
+    TEST_ASSERT_EQUAL_INT64(35 * S, sessao_restante(&sessao, 125 * S));
+    TEST_ASSERT_EQUAL_INT64(0, sessao_restante(&sessao, 160 * S));
+    TEST_ASSERT_EQUAL_INT64(0, sessao_restante(&sessao, 500 * S));
+}
+
+/* O tempo pausado não conta, e pausar ou retomar duas vezes não muda nada */
+void test_pausaERetomada()
+{
+    sessao_inicia(&sessao, 60 * S, 0);
+    TEST_ASSERT_TRUE(sessao_pausa(&sessao, 20 * S));
+    TEST_ASSERT_FALSE(sessao_pausa(&sessao, 25 * S));
+    TEST_ASSERT_EQUAL(SESSAO_PAUSADA, sessao.estado);
+    TEST_ASSERT_EQUAL_INT64(40 * S, sessao_restante(&sessao, 20 * S));
+    TEST_ASSERT_EQUAL_INT64(40 * S, sessao_restante(&sessao, 90 * S));
+
+    TEST_ASSERT_TRUE(sessao_retoma(&sessao, 100 * S));
+    TEST_ASSERT_FALSE(sessao_retoma(&sessao, 105 * S));
+    TEST_ASSERT_EQUAL_INT64(30 * S, sessao_restante(&sessao, 110 * S));
+
+    /* Uma segunda pausa acumula sobre a primeira */
+    TEST_ASSERT_TRUE(sessao_pausa(&sessao, 115 * S));
+    TEST_ASSERT_TRUE(sessao_retoma(&sessao, 200 * S));
+    TEST_ASSERT_EQUAL_INT64(25 * S, sessao_restante(&sessao, 200 * S));
+    TEST_ASSERT_EQUAL_INT64(0, sessao_restante(&sessao, 225 * S));
+}
+
+/* Estender vale em curso ou pausado, e encurtar nunca para antes do tempo
+ * já decorrido */
+void test_extensao()
+{
+    sessao_inicia(&sessao, 60 * S, 0);
+    sessao_estende(&sessao, 30 * S);
+    TEST_ASSERT_EQUAL_INT64(80 * S, sessao_restante(&sessao, 10 * S));
+
+    TEST_ASSERT_TRUE(sessao_pausa(&sessao, 50 * S));
+    sessao_estende(&sessao, 15 * S);
+    TEST_ASSERT_EQUAL_INT64(55 * S, sessao_restante(&sessao, 70 * S));
+    TEST_ASSERT_TRUE(sessao_retoma(&sessao, 70 * S));
+    TEST_ASSERT_EQUAL_INT64(45 * S, sessao_restante(&sessao, 80 * S));
+
+    TEST_ASSERT_TRUE(sessao_pausa(&sessao, 80 * S));
+    sessao_estende(&sessao, -100 * S);
+    TEST_ASSERT_EQUAL_INT64(60 * S, sessao.duracao);
+    TEST_ASSERT_EQUAL_INT64(0, sessao_restante(&sessao, 80 * S));
+}
+
+void test_encerramento()
+{
+    sessao_inicia(&sessao, 60 * S, 0);
+    sessao_encerra(&sessao);
+    TEST_ASSERT_EQUAL(SESSAO_INATIVA, sessao.estado);
+    TEST_ASSERT_EQUAL_INT64(0, sessao_restante(&sessao, 10 * S));
+    TEST_ASSERT_FALSE(sessao_retoma(&sessao, 10 * S));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_sessaoInativa);
+    RUN_TEST(test_restanteEmCurso);
+    RUN_TEST(test_pausaERetomada);
+    RUN_TEST(test_extensao);
+    RUN_TEST(test_encerramento);
+    return UNITY_END();
+}